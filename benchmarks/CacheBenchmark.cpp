@@ -0,0 +1,299 @@
+#include <algorithm> // std::shuffle, std::min
+#include <cstdint>   // std::uint64_t
+#include <memory>    // std::unique_ptr
+#include <mutex>     // std::mutex
+#include <numeric>   // std::iota
+#include <random>    // std::mt19937
+#include <string>    // std::string
+#include <tuple>     // std::tuple
+#include <vector>    // std::vector
+
+#include "benchmark/benchmark.h"
+
+#include "Cache/Cache.h"
+#include "Cache/HashedKey.h"
+#include "Cache/Policy/ARC.h"
+#include "Cache/Policy/FIFO.h"
+#include "Cache/Policy/LFU.h"
+#include "Cache/Policy/LIFO.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Policy/MRU.h"
+#include "Cache/Policy/Random.h"
+#include "Cache/Policy/WTinyLFU.h"
+#include "Cache/detail/tuple_hash.h"
+
+// Benchmarks are named <policy>/<key type>/<lock>/<operation>/<cache size>, so
+// a subset of them can be selected with --benchmark_filter. For instance:
+//   cache_benchmark --benchmark_filter='LRU/int/NullLock/.*'
+//   cache_benchmark --benchmark_filter='.*/string/.*/Hit/1000000'
+
+namespace
+{
+	template<typename Key> struct key_maker;
+
+	template<> struct key_maker<int>
+	{
+		static int make(std::size_t i) { return static_cast<int>(i); }
+	};
+
+	// Long enough to not fit in the small string buffer
+	template<> struct key_maker<std::string>
+	{
+		static std::string make(std::size_t i) { return "benchmark/key/" + std::to_string(i); }
+	};
+
+	template<> struct key_maker<std::tuple<int, int>>
+	{
+		static std::tuple<int, int> make(std::size_t i) { return std::make_tuple(static_cast<int>(i), static_cast<int>(i * 7)); }
+	};
+
+	// 200-byte keys, for which hashing is most of the cost of every lookup.
+	// They differ in their first bytes, so comparing them is cheap.
+	struct long_key_maker
+	{
+		static std::string make(std::size_t i)
+		{
+			std::string key = std::to_string(i) + "/";
+			key.resize(200, 'k');
+			return key;
+		}
+	};
+
+	// The same keys, hashed only once when they are created
+	struct hashed_key_maker
+	{
+		static HashedKey<std::string> make(std::size_t i) { return HashedKey<std::string>(long_key_maker::make(i)); }
+	};
+
+	// Keys [first, first + count), in random order
+	template<typename Key, typename Maker = key_maker<Key>>
+	std::vector<Key> make_keys(std::size_t first, std::size_t count)
+	{
+		std::vector<std::size_t> indices(count);
+		std::iota(indices.begin(), indices.end(), first);
+		std::shuffle(indices.begin(), indices.end(), std::mt19937(42));
+
+		std::vector<Key> keys;
+		keys.reserve(count);
+
+		for(std::size_t i : indices)
+			keys.push_back(Maker::make(i));
+
+		return keys;
+	}
+
+	template<typename CacheType>
+	void fill(CacheType& cache, const std::vector<typename CacheType::key_type>& keys)
+	{
+		for(const auto& key : keys)
+			cache.insert(key, typename CacheType::mapped_type{});
+	}
+
+	// Inserting into an empty cache, until it is full
+	template<typename CacheType, typename Maker = key_maker<typename CacheType::key_type>>
+	void insert(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		const auto keys = make_keys<typename CacheType::key_type, Maker>(0, size);
+
+		for(auto _ : state)
+		{
+			std::unique_ptr<CacheType> cache(new CacheType(size));
+			fill(*cache, keys);
+
+			state.PauseTiming();
+			cache.reset();
+			state.ResumeTiming();
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(size));
+	}
+
+	// Looking up keys that are in the cache
+	template<typename CacheType, typename Maker = key_maker<typename CacheType::key_type>>
+	void hit(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		const auto keys = make_keys<typename CacheType::key_type, Maker>(0, size);
+
+		CacheType cache(size);
+		fill(cache, keys);
+
+		std::size_t i = 0;
+		for(auto _ : state)
+		{
+			benchmark::DoNotOptimize(cache.find(keys[i]));
+			if(++i == size) i = 0;
+		}
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	// Looking up keys that are not in the cache
+	template<typename CacheType, typename Maker = key_maker<typename CacheType::key_type>>
+	void miss(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		const auto missing = make_keys<typename CacheType::key_type, Maker>(size, size);
+
+		CacheType cache(size);
+		fill(cache, make_keys<typename CacheType::key_type, Maker>(0, size));
+
+		std::size_t i = 0;
+		for(auto _ : state)
+		{
+			benchmark::DoNotOptimize(cache.find(missing[i]));
+			if(++i == size) i = 0;
+		}
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	// Erasing random keys from a full cache. Keys are erased in batches and
+	// inserted back (untimed) after each batch, so the cache stays full.
+	template<typename CacheType, typename Maker = key_maker<typename CacheType::key_type>>
+	void erase(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		const auto keys = make_keys<typename CacheType::key_type, Maker>(0, size);
+		const std::size_t batch = std::min<std::size_t>(size, 1024);
+
+		CacheType cache(size);
+		fill(cache, keys);
+
+		std::size_t first = 0;
+		for(auto _ : state)
+		{
+			for(std::size_t i = first; i < first + batch; i++)
+				cache.erase(keys[i]);
+
+			state.PauseTiming();
+			for(std::size_t i = first; i < first + batch; i++)
+				cache.insert(keys[i], typename CacheType::mapped_type{});
+
+			first = (first + batch + batch <= size ? first + batch : 0);
+			state.ResumeTiming();
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(batch));
+	}
+
+	// Erasing half of the entries of a full cache at once with std::erase_if(),
+	// as done when invalidating a whole group of keys
+	template<typename CacheType, typename Maker = key_maker<typename CacheType::key_type>>
+	void erase_if(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		const auto keys = make_keys<typename CacheType::key_type, Maker>(0, size);
+
+		for(auto _ : state)
+		{
+			state.PauseTiming();
+			std::unique_ptr<CacheType> cache(new CacheType(size));
+			for(std::size_t i = 0; i < size; i++)
+				cache->insert(keys[i], typename CacheType::mapped_type(i));
+			state.ResumeTiming();
+
+			std::erase_if(*cache, [](const typename CacheType::value_type& entry) { return entry.second % 2 == 0; });
+
+			state.PauseTiming();
+			cache.reset();
+			state.ResumeTiming();
+		}
+
+		state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(size));
+	}
+
+	// Inserting new keys into a full cache, so that (almost) every insertion
+	// evicts an entry
+	template<typename CacheType, typename Maker = key_maker<typename CacheType::key_type>>
+	void insert_evict(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		const auto keys = make_keys<typename CacheType::key_type, Maker>(0, 2 * size);
+
+		CacheType cache(size);
+
+		std::size_t i = 0;
+		for(; i < size; i++)
+			cache.insert(keys[i], typename CacheType::mapped_type{});
+
+		for(auto _ : state)
+		{
+			cache.insert(keys[i], typename CacheType::mapped_type{});
+			if(++i == keys.size()) i = 0;
+		}
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	template<template<typename> class Policy, typename Key, typename Lock>
+	void register_benchmarks(const std::string& name)
+	{
+		using CacheType = Cache<Key, std::uint64_t, Policy, Lock>;
+
+		const auto sizes = [](benchmark::internal::Benchmark* b) { b->RangeMultiplier(10)->Range(1000, 10000000); };
+
+		sizes(benchmark::RegisterBenchmark((name + "/Insert").c_str(), insert<CacheType>));
+		sizes(benchmark::RegisterBenchmark((name + "/Hit").c_str(), hit<CacheType>));
+		sizes(benchmark::RegisterBenchmark((name + "/Miss").c_str(), miss<CacheType>));
+		sizes(benchmark::RegisterBenchmark((name + "/Erase").c_str(), erase<CacheType>));
+		sizes(benchmark::RegisterBenchmark((name + "/EraseIf").c_str(), erase_if<CacheType>));
+		sizes(benchmark::RegisterBenchmark((name + "/InsertEvict").c_str(), insert_evict<CacheType>));
+	}
+
+	template<template<typename> class Policy, typename Key>
+	void register_benchmarks(const std::string& name)
+	{
+		register_benchmarks<Policy, Key, NullLock>(name + "/NullLock");
+		register_benchmarks<Policy, Key, std::mutex>(name + "/mutex");
+	}
+
+	template<template<typename> class Policy>
+	void register_benchmarks(const std::string& name)
+	{
+		register_benchmarks<Policy, int>(name + "/int");
+		register_benchmarks<Policy, std::string>(name + "/string");
+		register_benchmarks<Policy, std::tuple<int, int>>(name + "/tuple");
+	}
+
+	// Plain and pre-hashed 200-byte string keys, to measure how much hashing
+	// every key only once saves
+	template<template<typename> class Policy>
+	void register_long_key_benchmarks(const std::string& name)
+	{
+		using StringCache = Cache<std::string, std::uint64_t, Policy>;
+		using HashedCache = Cache<HashedKey<std::string>, std::uint64_t, Policy>;
+
+		const auto sizes = [](benchmark::internal::Benchmark* b) { b->RangeMultiplier(10)->Range(1000, 100000); };
+
+		sizes(benchmark::RegisterBenchmark((name + "/string200/NullLock/Hit").c_str(), hit<StringCache, long_key_maker>));
+		sizes(benchmark::RegisterBenchmark((name + "/string200/NullLock/Miss").c_str(), miss<StringCache, long_key_maker>));
+		sizes(benchmark::RegisterBenchmark((name + "/string200/NullLock/InsertEvict").c_str(), insert_evict<StringCache, long_key_maker>));
+
+		sizes(benchmark::RegisterBenchmark((name + "/hashed200/NullLock/Hit").c_str(), hit<HashedCache, hashed_key_maker>));
+		sizes(benchmark::RegisterBenchmark((name + "/hashed200/NullLock/Miss").c_str(), miss<HashedCache, hashed_key_maker>));
+		sizes(benchmark::RegisterBenchmark((name + "/hashed200/NullLock/InsertEvict").c_str(), insert_evict<HashedCache, hashed_key_maker>));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	register_benchmarks<Policy::ARC>("ARC");
+	register_benchmarks<Policy::FIFO>("FIFO");
+	register_benchmarks<Policy::LFU>("LFU");
+	register_benchmarks<Policy::LIFO>("LIFO");
+	register_benchmarks<Policy::LRU>("LRU");
+	register_benchmarks<Policy::MRU>("MRU");
+	register_benchmarks<Policy::Random>("Random");
+	register_benchmarks<Policy::WTinyLFU>("WTinyLFU");
+
+	register_long_key_benchmarks<Policy::LRU>("LRU");
+	register_long_key_benchmarks<Policy::WTinyLFU>("WTinyLFU");
+
+	benchmark::Initialize(&argc, argv);
+	if(benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+}
@@ -1,4 +1,5 @@
 #include <iostream> // std::cout
+#include <list>     // std::list
 #include <string>   // std::string
 
 #include "Cache/Cache.h"      // class Cache
@@ -35,6 +36,25 @@ public:
 	// mentioned methods for it to work properly. For information about each
 	// method, please read the comments over the functions:
 
+	// Optionally, a policy may also provide these methods, which the cache
+	// will call if they exist (see Policy::WTinyLFU for an example):
+	// - void reserve(size_t max_size);
+	//   Called once the cache knows its maximum size.
+	// - bool admit(const Key& candidate, const Key& victim);
+	//   Called when the cache is full, before evicting `victim` to make room
+	//   for `candidate`. Returning false rejects the insertion of `candidate`.
+	// - void insert(const Key& key, size_t weight);
+	//   Called instead of insert(key) with the weight of the new entry, for
+	//   policies that take weights into account (see Policy::GDSF).
+	// - void update_weight(const Key& key, size_t old_weight, size_t new_weight);
+	//   Called when an assignment changes the weight of an entry.
+	// - template<typename Fn> void dump(Fn& fn) const;
+	//   Called by Cache::save(), which expects fn(key, state) for every key,
+	//   in the order they must be restored.
+	// - void restore(const Key& key, std::uint64_t state);
+	//   Called by Cache::load() instead of insert() for every saved key.
+	// All of them are described in Cache/detail/policy_hooks.h
+
 	// clear(): This function is called when the cache is cleared. Thus, all keys
 	// stored by this policy should be freed.
 	// In our case, this is as simple as a call to "keys.clear()"
@@ -32,6 +32,12 @@ std::uint64_t fibonacci(std::uint64_t n)
 
 auto cached_fibonacci = wrap<Policy::LRU, std::mutex>(fibonacci, 16);
 
+// Note that both threads start by calling cached_fibonacci(45) at the same time.
+// Since neither of them finds it in the cache, both compute it. If that is a
+// problem (for instance, because the function is really expensive), use
+// wrap_single_flight() instead of wrap(): the second thread will then wait for
+// the result of the first one instead of computing it again.
+
 // This is the first thread. It will call the cached_fibonacci() function at the
 // same time the thread 2 is calling it.
 void thread1()
@@ -0,0 +1,118 @@
+#include <algorithm> // std::max
+#include <atomic>    // std::atomic
+#include <chrono>    // std::chrono
+#include <cstdint>   // std::uint64_t
+#include <iomanip>   // std::setw
+#include <iostream>  // std::cout
+#include <mutex>     // std::mutex
+#include <random>    // std::mt19937
+#include <thread>    // std::thread
+#include <vector>    // std::vector
+
+#include "Cache/Cache.h"           // class Cache
+#include "Cache/ConcurrentCache.h" // class ConcurrentCache
+#include "Cache/ShardedCache.h"    // class ShardedCache
+#include "Cache/Policy/LRU.h"      // Policy::LRU (LRU replacement policy)
+
+// In multithread_cache.cpp we saw how passing std::mutex as the lock type makes
+// a cache thread-safe. However, every single operation on that cache takes the
+// same mutex, so no matter how many threads we throw at it, only one of them
+// can be using the cache at any given time.
+
+// ShardedCache splits the keys across several independent caches (shards), each
+// one with its own lock. Two threads only contend if they happen to access keys
+// that live in the same shard.
+
+// ConcurrentCache keeps a single replacement policy, but lookups do not lock
+// it: they only lock a segment of the hash map in read mode, and record the key
+// they read in a buffer that is applied to the policy later, in batches. This
+// example measures how many operations per second the three kinds of cache can
+// sustain as we add more threads.
+
+using namespace std::chrono_literals;
+
+constexpr std::size_t CACHE_SIZE = 1 << 16;
+constexpr int KEY_SPACE = 2 * CACHE_SIZE;
+
+// Each worker performs a read-mostly mix: 9 lookups for every insertion, over
+// a key space twice as big as the cache so that we get a mix of hits, misses
+// and evictions.
+template<typename CacheType>
+std::uint64_t worker(CacheType& cache, unsigned seed, const std::atomic<bool>& stop)
+{
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> keys(0, KEY_SPACE - 1);
+	std::uint64_t ops = 0;
+
+	while(!stop.load(std::memory_order_relaxed))
+	{
+		const int key = keys(gen);
+
+		if(ops % 10 == 0)
+			cache.insert(key, key);
+		else
+			cache.contains(key);
+
+		ops++;
+	}
+
+	return ops;
+}
+
+// Runs `threads` workers over the given cache for a fixed amount of time and
+// returns the number of operations per second.
+template<typename CacheType>
+double measure(CacheType& cache, unsigned threads)
+{
+	std::atomic<bool> stop{false};
+	std::vector<std::uint64_t> ops(threads);
+	std::vector<std::thread> workers;
+
+	for(unsigned i = 0; i < threads; i++)
+		workers.emplace_back([&, i]() { ops[i] = worker(cache, i + 1, stop); });
+
+	const auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(250ms);
+	stop = true;
+
+	for(auto& t : workers)
+		t.join();
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::uint64_t total = 0;
+	for(auto n : ops) total += n;
+
+	return static_cast<double>(total) / elapsed.count();
+}
+
+int main()
+{
+	const unsigned max_threads = std::max(2U, 2 * std::thread::hardware_concurrency());
+
+	std::cout << std::setw(8) << "threads"
+		<< std::setw(24) << "Cache (ops/s)"
+		<< std::setw(24) << "ShardedCache (ops/s)"
+		<< std::setw(28) << "ConcurrentCache (ops/s)" << std::endl;
+
+	for(unsigned threads = 1; threads <= max_threads; threads *= 2)
+	{
+		// A single cache guarded by a single std::mutex
+		Cache<int, int, Policy::LRU, std::mutex> cache(CACHE_SIZE);
+
+		// The same capacity split across several shards, each with its own mutex
+		ShardedCache<int, int, Policy::LRU, std::mutex> sharded(CACHE_SIZE);
+
+		// A single LRU policy, which lookups never lock
+		ConcurrentCache<int, int, Policy::LRU> concurrent(CACHE_SIZE);
+
+		const double single = measure(cache, threads);
+		const double multi = measure(sharded, threads);
+		const double buffered = measure(concurrent, threads);
+
+		std::cout << std::setw(8) << threads
+			<< std::setw(24) << static_cast<std::uint64_t>(single)
+			<< std::setw(24) << static_cast<std::uint64_t>(multi)
+			<< std::setw(28) << static_cast<std::uint64_t>(buffered) << std::endl;
+	}
+}
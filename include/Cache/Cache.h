@@ -25,12 +25,29 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
 #include <limits>
 #include <mutex>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <unordered_map>
 
+#include "Serializer.h"
 #include "Policy/Random.h"
 #include "Stats/Basic.h"
+#include "detail/latency.h"
+#include "detail/policy_hooks.h"
+#include "detail/snapshot.h"
+#include "detail/stats_hooks.h"
+#include "detail/storage_hooks.h"
+#include "detail/timing_wheel.h"
 #include "detail/utility.h"
 
 struct NullLock
@@ -40,22 +57,45 @@ struct NullLock
 	void unlock() const noexcept {}
 };
 
+// Default weigher: every entry weighs 1, so the capacity of the cache is its
+// maximum number of entries
+struct UnitWeigher
+{
+	template<typename Key, typename Value>
+	constexpr std::size_t operator()(const Key&, const Value&) const noexcept { return 1; }
+};
+
 template<
-	typename Key,                                            // Key type
-	typename Value,                                          // Value type
-	template<typename> class CachePolicy = Policy::Random,   // Cache policy
-	typename Lock = NullLock,                                // Lock type (for multithreading)
-	template<typename...> class StatsProvider = Stats::Basic // Statistics measurement object
+	typename Key,                                                 // Key type
+	typename Value,                                               // Value type
+	template<typename> class CachePolicy = Policy::Random,        // Cache policy
+	typename Lock = NullLock,                                     // Lock type (for multithreading)
+	template<typename...> class StatsProvider = Stats::Basic,     // Statistics measurement object
+	template<typename...> class StorageType = std::unordered_map, // Underlying key-value storage
+	typename Weigher = UnitWeigher,                               // Weight of each entry
+	typename Clock = std::chrono::steady_clock                    // Clock used to expire entries
 >
 class Cache
 {
 private:
-	using underlying_storage = std::unordered_map<Key, Value>;
+	using underlying_storage = StorageType<Key, Value>;
+	using timed_lock = detail::timed_lock<Lock, StatsProvider<Key, Value>>;
+
+	template<typename K>
+	using enable_if_lookup_key = std::enable_if_t<detail::is_lookup_key<underlying_storage, K>::value,
+		decltype(detail::find(std::declval<const underlying_storage&>(), std::declval<const K&>()), void())>;
+
+	// Whether max_size() is a number of entries, and not a weight budget
+	static constexpr bool counts_entries = std::is_same<Weigher, UnitWeigher>::value;
 
 	const size_t m_MaxSize;
+	size_t m_Weight = 0;
 	underlying_storage m_Cache;
 	mutable CachePolicy<Key> m_CachePolicy;
 	mutable StatsProvider<Key, Value> m_Stats;
+	Weigher m_Weigher;
+	detail::timing_wheel<Key, Clock> m_Expiry;
+	typename Clock::duration m_DefaultTTL{};
 	mutable Lock m_Lock;
 
 public:
@@ -70,38 +110,44 @@ public:
 	using const_iterator  = typename underlying_storage::const_iterator;
 	using size_type       = typename underlying_storage::size_type;
 	using difference_type = typename underlying_storage::difference_type;
+	using duration        = typename Clock::duration;
 
+	// With a weigher other than UnitWeigher, `max_size` is the maximum total
+	// weight of the entries instead of their number
 	Cache(
 		const size_t max_size,
 		const CachePolicy<Key>& policy = CachePolicy<Key>(),
-		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>())
-		: m_MaxSize(max_size == 0 ? std::numeric_limits<size_t>::max() : max_size), m_CachePolicy(policy), m_Stats(stats), m_Lock()
+		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>(),
+		const Weigher& weigher = Weigher())
+		: m_MaxSize(max_size == 0 ? std::numeric_limits<size_t>::max() : max_size), m_CachePolicy(policy), m_Stats(stats), m_Weigher(weigher), m_Lock()
 	{
 		std::lock_guard<Lock> lock(m_Lock);
-		static constexpr size_t MAX_RESERVE_SIZE = 1024;
-		m_Cache.reserve(m_MaxSize < MAX_RESERVE_SIZE ? m_MaxSize : MAX_RESERVE_SIZE);
+		preallocate();
 	}
 
 	Cache(
 		const size_t max_size,
 		const Lock& lock,
 		const CachePolicy<Key>& policy = CachePolicy<Key>(),
-		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>())
-		: m_MaxSize(max_size == 0 ? std::numeric_limits<size_t>::max() : max_size), m_CachePolicy(policy), m_Stats(stats), m_Lock(lock)
+		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>(),
+		const Weigher& weigher = Weigher())
+		: m_MaxSize(max_size == 0 ? std::numeric_limits<size_t>::max() : max_size), m_CachePolicy(policy), m_Stats(stats), m_Weigher(weigher), m_Lock(lock)
 	{
 		std::lock_guard<Lock> mlock(m_Lock);
-		static constexpr size_t MAX_RESERVE_SIZE = 1024;
-		m_Cache.reserve(m_MaxSize < MAX_RESERVE_SIZE ? m_MaxSize : MAX_RESERVE_SIZE);
+		preallocate();
 	}
 
 	Cache(const Cache& other)
-		: m_MaxSize(other.m_MaxSize)
+		: m_MaxSize(other.m_MaxSize), m_Weigher(other.m_Weigher)
 	{
 		std::lock(m_Lock, other.m_Lock);
 		std::lock_guard<Lock> lhs_lk(m_Lock, std::adopt_lock);
 		std::lock_guard<Lock> rhs_lk(other.m_Lock, std::adopt_lock);
 
 		m_Cache = other.m_Cache;
+		m_Weight = other.m_Weight;
+		m_Expiry = other.m_Expiry;
+		m_DefaultTTL = other.m_DefaultTTL;
 		m_Stats = other.m_Stats;
 		m_CachePolicy = other.m_CachePolicy;
 	}
@@ -121,16 +167,36 @@ public:
 	size_type size() const noexcept { std::lock_guard<Lock> lock(m_Lock); return m_Cache.size(); }
 	constexpr size_type max_size() const noexcept { return m_MaxSize; }
 
-	      mapped_type& at(const key_type& key)       { std::lock_guard<Lock> lock(m_Lock); return m_Cache.at(key); }
-	const mapped_type& at(const key_type& key) const { std::lock_guard<Lock> lock(m_Lock); return m_Cache.at(key); }
+	// Total weight of the entries in the cache. Same as size() for UnitWeigher
+	size_type weight() const noexcept { std::lock_guard<Lock> lock(m_Lock); return m_Weight; }
+
+	      mapped_type& at(const key_type& key)       { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit(at_entry(*this, key)); }
+	const mapped_type& at(const key_type& key) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit(at_entry(*this, key)); }
 
 	      mapped_type& lookup(const key_type& key)       { return at(key); }
 	const mapped_type& lookup(const key_type& key) const { return at(key); }
 
-	mapped_type& operator[](const key_type&  key) { return insert(key, mapped_type()).first->second; }
-	mapped_type& operator[](      key_type&& key) { return insert(key, mapped_type()).first->second; }
+	// With a storage whose hasher and key comparator are transparent (like
+	// Storage::FlatStringMap), lookups also take any type the storage can look
+	// up, such as a string view for std::string keys, without building a key.
+	// Storages that can only find a key_type get one built from the argument.
+	template<typename K, typename = enable_if_lookup_key<K>>
+	      mapped_type& at(const K& key)       { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit(at_entry(*this, key)); }
+
+	template<typename K, typename = enable_if_lookup_key<K>>
+	const mapped_type& at(const K& key) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit(at_entry(*this, key)); }
+
+	template<typename K, typename = enable_if_lookup_key<K>>
+	      mapped_type& lookup(const K& key)       { return at(key); }
+
+	template<typename K, typename = enable_if_lookup_key<K>>
+	const mapped_type& lookup(const K& key) const { return at(key); }
 
-	iterator erase(const_iterator pos) { std::lock_guard<Lock> lock(m_Lock); m_CachePolicy.erase(pos->first); m_Stats.erase(pos->first, pos->second); return m_Cache.erase(pos); }
+	// operator[] must return a reference, so the policy can't reject the key
+	mapped_type& operator[](const key_type&  key) { timed_lock lock(m_Lock, m_Stats, Stats::operation::insert); return emplace_entry(true, key).first->second; }
+	mapped_type& operator[](      key_type&& key) { timed_lock lock(m_Lock, m_Stats, Stats::operation::insert); return emplace_entry(true, std::move(key)).first->second; }
+
+	iterator erase(const_iterator pos) { std::lock_guard<Lock> lock(m_Lock); m_CachePolicy.erase(pos->first); m_Stats.erase(pos->first, pos->second); m_Weight -= weigh(*pos); m_Expiry.cancel(pos->first); return m_Cache.erase(pos); }
 
 	iterator erase(const_iterator first, const_iterator last)
 	{
@@ -139,47 +205,30 @@ public:
 		{
 			m_CachePolicy.erase(it->first);
 			m_Stats.erase(it->first, it->second);
+			m_Weight -= weigh(*it);
+			m_Expiry.cancel(it->first);
 		}
 
 		return m_Cache.erase(first, last);
 	}
 
-	size_type erase(const key_type& key)
-	{
-		std::lock_guard<Lock> lock(m_Lock);
-		auto it = find_key(key);
-
-		if(it == m_Cache.end()) return 0;
+	size_type erase(const key_type& key) { std::lock_guard<Lock> lock(m_Lock); return erase_key(key); }
 
-		m_CachePolicy.erase(key);
-		m_Stats.erase(it->first, it->second);
-		m_Cache.erase(it);
-
-		return 1;
-	}
+	template<typename K, typename = enable_if_lookup_key<K>>
+	size_type erase(const K& key) { std::lock_guard<Lock> lock(m_Lock); return erase_key(key); }
 
   	template<typename... Args>
 	std::pair<iterator, bool> emplace(Args&&... args)
 	{
-		std::lock_guard<Lock> lock(m_Lock);
-		auto pair = m_Cache.emplace(args...);
+		timed_lock lock(m_Lock, m_Stats, Stats::operation::insert);
+		reclaim();
 
-		if(pair.second == true)
-		{
-			if(m_Cache.size() > m_MaxSize)
-			{
-				auto replaced_key = m_CachePolicy.replace_candidate();
-				auto it = m_Cache.find(replaced_key);
-
-				m_CachePolicy.erase(replaced_key);
-				m_Stats.evict(it->first, it->second);
-				m_Cache.erase(it);
-			}
+		auto pair = emplace_value(std::forward<Args>(args)...);
 
-			m_CachePolicy.insert(pair.first->first);
-		}
-		else
+		if(pair.second == false)
 			m_CachePolicy.touch(pair.first->first);
+		else if(!add_entry(pair.first, false))
+			return { m_Cache.end(), false };
 
 		return pair;
 	}
@@ -192,52 +241,171 @@ public:
 	}
 
 	void insert(std::initializer_list<value_type> ilist) { insert(ilist.begin(), ilist.end()); }
-	std::pair<iterator, bool> insert(const value_type& val) { return insert(val.first, val.second); }
+	std::pair<iterator, bool> insert(const value_type&  val) { return insert(val.first, val.second); }
+	std::pair<iterator, bool> insert(      value_type&& val) { return insert(val.first, std::move(val.second)); }
+
+	// If the policy rejects the key, nothing is inserted and the returned
+	// iterator is end()
+	std::pair<iterator, bool> insert(const key_type&  key, const mapped_type&  value) noexcept { timed_lock lock(m_Lock, m_Stats, Stats::operation::insert); return emplace_entry(false, key, value); }
+	std::pair<iterator, bool> insert(const key_type&  key,       mapped_type&& value) noexcept { timed_lock lock(m_Lock, m_Stats, Stats::operation::insert); return emplace_entry(false, key, std::move(value)); }
+	std::pair<iterator, bool> insert(      key_type&& key, const mapped_type&  value) noexcept { timed_lock lock(m_Lock, m_Stats, Stats::operation::insert); return emplace_entry(false, std::move(key), value); }
+	std::pair<iterator, bool> insert(      key_type&& key,       mapped_type&& value) noexcept { timed_lock lock(m_Lock, m_Stats, Stats::operation::insert); return emplace_entry(false, std::move(key), std::move(value)); }
+
+	// Same as insert(key, value), but the new entry expires after `ttl`
+	// instead of the default time to live of the cache
+	std::pair<iterator, bool> insert(const key_type& key, const mapped_type& value, duration ttl) { timed_lock lock(m_Lock, m_Stats, Stats::operation::insert); return expiring_entry(ttl, key, value); }
+	std::pair<iterator, bool> insert(key_type&& key, mapped_type&& value, duration ttl) { timed_lock lock(m_Lock, m_Stats, Stats::operation::insert); return expiring_entry(ttl, std::move(key), std::move(value)); }
+
+	// Inserts a value constructed in place from `args` if `key` is not in the
+	// cache. Otherwise nothing is constructed and the key is just touched.
+	template<typename... Args>
+	std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+	{
+		timed_lock lock(m_Lock, m_Stats, Stats::operation::insert);
+		return emplace_entry(false, key, std::forward<Args>(args)...);
+	}
 
-	std::pair<iterator, bool> insert(const key_type& key, const mapped_type& value) noexcept
+	template<typename... Args>
+	std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
 	{
-		std::lock_guard<Lock> lock(m_Lock);
-		auto it = m_Cache.find(key);
+		timed_lock lock(m_Lock, m_Stats, Stats::operation::insert);
+		return emplace_entry(false, std::move(key), std::forward<Args>(args)...);
+	}
 
-		if(it == m_Cache.end())
-		{
-			if(m_Cache.size() + 1 > m_MaxSize)
-			{
-				auto replaced_key = m_CachePolicy.replace_candidate();
-				it = m_Cache.find(replaced_key);
+	// Inserts `value` if `key` is not in the cache, or assigns it otherwise
+	template<typename M>
+	std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value)
+	{
+		timed_lock lock(m_Lock, m_Stats, Stats::operation::insert);
+		return assign_entry(key, std::forward<M>(value));
+	}
 
-				m_CachePolicy.erase(replaced_key);
-				m_Stats.evict(it->first, it->second);
-				m_Cache.erase(it);
-			}
+	template<typename M>
+	std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value)
+	{
+		timed_lock lock(m_Lock, m_Stats, Stats::operation::insert);
+		return assign_entry(std::move(key), std::forward<M>(value));
+	}
 
-			m_CachePolicy.insert(key);
-			return m_Cache.insert(std::make_pair(key, value));
-		}
-		else
-		{
-			m_CachePolicy.touch(key);
-			return { it, false };
-		}
+	// Returns the value of `key`, inserting the result of `factory()` first if
+	// the key is not in the cache. Counts as a lookup for the statistics and,
+	// like operator[], the new entry is always admitted. Keep in mind that
+	// `factory` is called with the cache locked.
+	template<typename Factory>
+	mapped_type& get_or_insert_with(const key_type& key, Factory&& factory)
+	{
+		timed_lock lock(m_Lock, m_Stats, Stats::operation::insert);
+		return get_or_insert_entry(key, factory);
+	}
+
+	template<typename Factory>
+	mapped_type& get_or_insert_with(key_type&& key, Factory&& factory)
+	{
+		timed_lock lock(m_Lock, m_Stats, Stats::operation::insert);
+		return get_or_insert_entry(std::move(key), factory);
 	}
 
 	void clear() noexcept
 	{
 		std::lock_guard<Lock> lock(m_Lock);
 
-		m_CachePolicy.clear();
-		m_Cache.clear();
+		reset();
 		m_Stats.clear();
 	}
 
 	void flush() noexcept { clear(); }
 	void flush(const key_type& key) noexcept { erase(key); }
 
-	bool   contains(const key_type& key) const { std::lock_guard<Lock> lock(m_Lock); return find_key(key) != m_Cache.end(); }
-	size_type count(const key_type& key) const { std::lock_guard<Lock> lock(m_Lock); return find_key(key) != m_Cache.end(); }
+	bool   contains(const key_type& key) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if(find_key(key) != m_Cache.end()); }
+	size_type count(const key_type& key) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if(find_key(key) != m_Cache.end()); }
+
+	      iterator find(const key_type& key)       { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if_found(find_key(key), m_Cache.end()); }
+	const_iterator find(const key_type& key) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if_found(find_key(key), m_Cache.end()); }
+
+	template<typename K, typename = enable_if_lookup_key<K>>
+	bool contains(const K& key) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if(find_key(key) != m_Cache.end()); }
+
+	template<typename K, typename = enable_if_lookup_key<K>>
+	size_type count(const K& key) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if(find_key(key) != m_Cache.end()); }
+
+	template<typename K, typename = enable_if_lookup_key<K>>
+	      iterator find(const K& key)       { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if_found(find_key(key), m_Cache.end()); }
+
+	template<typename K, typename = enable_if_lookup_key<K>>
+	const_iterator find(const K& key) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if_found(find_key(key), m_Cache.end()); }
+
+	// Copies the value of `key` into `value` before releasing the lock, so
+	// unlike find(), it is safe when other threads may evict the entry right
+	// after. Returns false (leaving `value` untouched) if the key is not in
+	// the cache.
+	bool try_get(const key_type& key, mapped_type& value) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if(copy_entry(key, value)); }
 
-	      iterator find(const key_type& key)       { std::lock_guard<Lock> lock(m_Lock); return find_key(key); }
-	const_iterator find(const key_type& key) const { std::lock_guard<Lock> lock(m_Lock); return find_key(key); }
+	template<typename K, typename = enable_if_lookup_key<K>>
+	bool try_get(const K& key, mapped_type& value) const { timed_lock lock(m_Lock, m_Stats, Stats::operation::miss); return lock.hit_if(copy_entry(key, value)); }
+
+	// Entries inserted from now on expire `ttl` after being inserted or
+	// assigned. A time to live of zero (the default) means they never expire.
+	void set_default_ttl(duration ttl) { std::lock_guard<Lock> lock(m_Lock); m_DefaultTTL = ttl; }
+	duration default_ttl() const { std::lock_guard<Lock> lock(m_Lock); return m_DefaultTTL; }
+
+	// Makes `key` expire `ttl` from now, or never if `ttl` is zero. Returns
+	// false if the key is not in the cache.
+	bool set_ttl(const key_type& key, duration ttl)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		auto it = m_Cache.find(key);
+
+		if(it == m_Cache.end() || is_expired(it->first)) return false;
+
+		schedule(it->first, ttl);
+		return true;
+	}
+
+	// Expired entries are removed when they are looked up and before every
+	// insertion. This removes all of them right away.
+	size_type purge_expired() { std::lock_guard<Lock> lock(m_Lock); return reclaim(); }
+
+	// Writes every entry to a snapshot that load() can read back, together
+	// with the state of the replacement policy (the LRU order, the frequencies
+	// of Policy::LFU, ...) and the remaining time to live of the entries.
+	// Entries are written one at a time, so saving a cache takes no extra
+	// memory, but the cache stays locked until all of them are written.
+	template<typename KeySerializer = Serializer<Key>, typename ValueSerializer = Serializer<Value>>
+	void save(std::ostream& os) const
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		save_entries<KeySerializer, ValueSerializer>(os);
+	}
+
+	// The snapshot is written to a temporary file that then replaces `path`
+	template<typename KeySerializer = Serializer<Key>, typename ValueSerializer = Serializer<Value>>
+	void save(const std::string& path) const
+	{
+		detail::snapshot::save_file(path, [this](std::ostream& os) { save<KeySerializer, ValueSerializer>(os); });
+	}
+
+	// Replaces the contents of the cache with a snapshot written by save().
+	// The storage is reserved once and every entry is handed to the policy in
+	// the saved order, without going through insert(). If the snapshot does
+	// not fit in the cache, the entries the policy would evict first are
+	// evicted. Throws std::runtime_error if the snapshot is invalid, in which
+	// case the cache is left empty.
+	template<typename KeySerializer = Serializer<Key>, typename ValueSerializer = Serializer<Value>>
+	void load(std::istream& is)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		load_entries<KeySerializer, ValueSerializer>(is);
+	}
+
+	template<typename KeySerializer = Serializer<Key>, typename ValueSerializer = Serializer<Value>>
+	void load(const std::string& path)
+	{
+		detail::snapshot::load_file(path, [this](std::istream& is) { load<KeySerializer, ValueSerializer>(is); });
+	}
+
+	// The statistics provider itself, for providers with extra information
+	// such as the latency percentiles of Stats::Latency
+	const StatsProvider<Key, Value>& stats() const noexcept { return m_Stats; }
 
 	size_type hit_count() const noexcept { return m_Stats.hit_count(); }
 	size_type miss_count() const noexcept { return m_Stats.miss_count(); }
@@ -245,28 +413,435 @@ public:
 	size_type entry_invalidation_count() const noexcept { return m_Stats.entry_invalidation_count(); }
 	size_type cache_invalidation_count() const noexcept { return m_Stats.cache_invalidation_count(); }
 	size_type evicted_count() const noexcept { return m_Stats.evicted_count(); }
+	size_type expired_count() const noexcept { return m_Stats.expired_count(); }
 
 	float hit_ratio  () const noexcept { return static_cast<float>(hit_count ())   / (static_cast<float>(hit_count() + miss_count())); }
 	float miss_ratio () const noexcept { return static_cast<float>(miss_count())   / (static_cast<float>(hit_count() + miss_count())); }
-	float utilization() const noexcept { return static_cast<float>(m_Cache.size()) /  static_cast<float>(m_MaxSize); }
+	float utilization() const noexcept { return static_cast<float>(weight())       /  static_cast<float>(m_MaxSize); }
 
 private:
-	iterator find_key(const key_type& key)
+	// Sizes the storage and the policy for max_size() entries. The maximum
+	// size of a weighted cache says nothing about its number of entries, so
+	// then nothing is reserved and policies that need to know their capacity
+	// (like Policy::ARC and Policy::WTinyLFU) work it out as the cache fills.
+	void preallocate()
 	{
-		auto it = m_Cache.find(key);
+		if(!counts_entries) return;
+
+		m_Cache.reserve(detail::initial_capacity<underlying_storage>(m_MaxSize));
+		detail::reserve(m_CachePolicy, m_MaxSize);
+	}
+
+	// Inserts a new entry unless `key` is already in the cache, in which case
+	// nothing is constructed and the key is touched
+	template<typename K, typename... Args>
+	std::pair<iterator, bool> emplace_entry(bool force, K&& key, Args&&... args)
+	{
+		reclaim();
+
+		// try_emplace() leaves its arguments untouched if the key exists, so
+		// they can be used again once the expired entry is gone
+		auto pair = detail::try_emplace(m_Cache, std::forward<K>(key), std::forward<Args>(args)...);
+
+		if(pair.second == false && drop_if_expired(pair.first))
+			pair = detail::try_emplace(m_Cache, std::forward<K>(key), std::forward<Args>(args)...);
+
+		if(pair.second == false)
+		{
+			m_CachePolicy.touch(pair.first->first);
+			return pair;
+		}
+
+		if(!add_entry(pair.first, force))
+			return { m_Cache.end(), false };
+
+		return pair;
+	}
+
+	template<typename K, typename... Args>
+	std::pair<iterator, bool> expiring_entry(duration ttl, K&& key, Args&&... args)
+	{
+		auto pair = emplace_entry(false, std::forward<K>(key), std::forward<Args>(args)...);
+		if(pair.second) schedule(pair.first->first, ttl);
+
+		return pair;
+	}
+
+	// emplace() takes any arguments std::pair can be constructed from, so the
+	// key is only known once the entry is constructed. The fast path is only
+	// taken when no entry can expire.
+	template<typename... Args>
+	std::pair<iterator, bool> emplace_value(Args&&... args)
+	{
+		if(m_Expiry.empty())
+			return m_Cache.emplace(std::forward<Args>(args)...);
+
+		value_type entry(std::forward<Args>(args)...);
+
+		auto it = m_Cache.find(entry.first);
+		if(it != m_Cache.end() && !drop_if_expired(it)) return { it, false };
+
+		return m_Cache.emplace(std::move(entry));
+	}
+
+	template<typename K, typename M>
+	std::pair<iterator, bool> assign_entry(K&& key, M&& value)
+	{
+		// `value` is only consumed if a new entry is inserted
+		auto pair = emplace_entry(false, std::forward<K>(key), std::forward<M>(value));
+
+		if(pair.second == false && pair.first != m_Cache.end())
+		{
+			const size_t old_weight = weigh(*pair.first);
+			pair.first->second = std::forward<M>(value);
+
+			const size_t weight = weigh(*pair.first);
+			if(weight != old_weight)
+			{
+				detail::update_weight(m_CachePolicy, pair.first->first, old_weight, weight);
+				m_Weight = m_Weight - old_weight + weight;
+				fit_entry(pair.first);
+			}
+
+			if(m_DefaultTTL > duration::zero())
+				schedule(pair.first->first, m_DefaultTTL);
+		}
+
+		return pair;
+	}
+
+	template<typename K, typename Factory>
+	mapped_type& get_or_insert_entry(K&& key, Factory& factory)
+	{
+		reclaim();
+
+		auto pair = detail::try_emplace(m_Cache, std::forward<K>(key), detail::lazy_value<Factory>{ factory });
+
+		if(pair.second == false && drop_if_expired(pair.first))
+			pair = detail::try_emplace(m_Cache, std::forward<K>(key), detail::lazy_value<Factory>{ factory });
+
+		if(pair.second == false)
+		{
+			m_Stats.hit(pair.first->first, pair.first->second);
+			m_CachePolicy.touch(pair.first->first);
+		}
+		else
+		{
+			m_Stats.miss(pair.first->first);
+			add_entry(pair.first, true);
+		}
+
+		return pair.first->second;
+	}
+
+	size_t weigh(const value_type& entry) const { return m_Weigher(entry.first, entry.second); }
+
+	// Makes room for an entry that was just added to the storage and hands it
+	// to the policy. If the policy rejects it, or it weighs more than the whole
+	// cache, the entry is removed again. Forced entries are always kept, even
+	// if that means going over the maximum weight until the next insertion.
+	bool add_entry(iterator it, bool force)
+	{
+		const size_t weight = weigh(*it);
+
+		if(!force && weight > m_MaxSize)
+		{
+			m_Cache.erase(it);
+			return false;
+		}
+
+		m_Weight += weight;
+
+		// The new entry is not in the policy yet, so it is never the victim
+		while(m_Weight > m_MaxSize && m_Cache.size() > 1)
+		{
+			if(!make_room(it->first, force))
+			{
+				m_Weight -= weight;
+				m_Cache.erase(it);
+				return false;
+			}
+		}
+
+		detail::insert(m_CachePolicy, it->first, weight);
+		if(m_DefaultTTL > duration::zero()) schedule(it->first, m_DefaultTTL);
+
+		return true;
+	}
+
+	// Evicts other entries until an entry that grew heavier fits again. The
+	// entry keeps its place in the policy, unless it becomes the replacement
+	// candidate itself: then it is handed to the policy again as if it was
+	// new, since that is the only way to keep it.
+	void fit_entry(iterator it)
+	{
+		while(m_Weight > m_MaxSize && m_Cache.size() > 1)
+		{
+			// Some policies (like Policy::Random) pick a new candidate on
+			// every call, so the one checked here must be the one evicted
+			const auto& victim = m_CachePolicy.replace_candidate();
+
+			if(victim == it->first)
+			{
+				m_CachePolicy.erase(it->first);
+				m_Weight -= weigh(*it);
+				add_entry(it, true);
+				return;
+			}
+
+			evict_entry(victim);
+		}
+	}
+
+	// Evicts the replacement candidate to make room for `key`, unless the
+	// policy refuses to admit `key` (and the admission is not forced)
+	bool make_room(const key_type& key, bool force)
+	{
+		const auto& victim = m_CachePolicy.replace_candidate();
+		if(!force && !detail::admit(m_CachePolicy, key, victim)) return false;
+
+		evict_entry(victim);
+		return true;
+	}
+
+	void evict_entry(const key_type& victim)
+	{
+		detail::scoped_timer<StatsProvider<Key, Value>> timer(m_Stats, Stats::operation::evict);
+		auto it = m_Cache.find(victim);
+
+		m_CachePolicy.erase(it->first);
+		m_Stats.evict(it->first, it->second);
+		m_Weight -= weigh(*it);
+		m_Expiry.cancel(it->first);
+		m_Cache.erase(it);
+	}
+
+	bool is_expired(const key_type& key) const { return !m_Expiry.empty() && m_Expiry.expired(key, Clock::now()); }
+
+	void schedule(const key_type& key, duration ttl)
+	{
+		if(ttl <= duration::zero())
+			return m_Expiry.cancel(key);
+
+		const auto now = Clock::now();
+		m_Expiry.schedule(key, now + ttl, now);
+	}
+
+	// Removes an expired entry. The entry must not be in the timing wheel.
+	void remove_expired(iterator it)
+	{
+		m_CachePolicy.erase(it->first);
+		detail::expire(m_Stats, it->first, it->second);
+		m_Weight -= weigh(*it);
+		m_Cache.erase(it);
+	}
+
+	bool drop_if_expired(iterator it)
+	{
+		if(!is_expired(it->first)) return false;
+
+		m_Expiry.cancel(it->first);
+		remove_expired(it);
+		return true;
+	}
+
+	// Removes every entry whose time to live has run out
+	size_type reclaim()
+	{
+		if(m_Expiry.empty()) return 0;
+
+		size_type count = 0;
+		m_Expiry.advance(Clock::now(), [this, &count](const key_type& key)
+		{
+			remove_expired(m_Cache.find(key));
+			count++;
+		});
+
+		return count;
+	}
+
+	// Empties the cache without reporting it to the statistics
+	void reset() noexcept
+	{
+		m_CachePolicy.clear();
+		m_Cache.clear();
+		m_Expiry.clear();
+		m_Weight = 0;
+	}
+
+	// Remaining time to live of `key` in nanoseconds, 0 if it never expires
+	// or -1 if it has already expired
+	std::int64_t remaining_ttl(const key_type& key, typename Clock::time_point now) const
+	{
+		if(m_Expiry.empty()) return 0;
+
+		const auto deadline = m_Expiry.deadline(key);
+		if(deadline == Clock::time_point::max()) return 0;
+		if(deadline <= now) return -1;
+
+		return std::max<std::int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count());
+	}
+
+	template<typename KeySerializer, typename ValueSerializer>
+	void save_entries(std::ostream& os) const
+	{
+		detail::snapshot::write_header(os, m_Cache.size());
+		const auto now = Clock::now();
+
+		auto write = [this, &os, now](const key_type& key, std::uint64_t state)
+		{
+			const auto it = m_Cache.find(key);
+
+			Serializer<std::uint64_t>::write(os, state);
+			Serializer<std::int64_t>::write(os, remaining_ttl(it->first, now));
+			KeySerializer::write(os, it->first);
+			ValueSerializer::write(os, it->second);
+		};
+
+		// Policies that can't dump their state get the entries in any order
+		if(!detail::dump(m_CachePolicy, write))
+		{
+			for(const auto& entry : m_Cache)
+				write(entry.first, 0);
+		}
+
+		if(!os) throw std::runtime_error("Cache::save(): cannot write snapshot");
+	}
+
+	template<typename KeySerializer, typename ValueSerializer>
+	void load_entries(std::istream& is)
+	{
+		const std::uint64_t count = detail::snapshot::read_header(is);
+		const auto now = Clock::now();
+
+		reset();
+
+		// The count comes from the file, so it is only trusted as far as the
+		// cache could hold that many entries anyway. Weighted and unbounded
+		// caches reserve a few entries and let the storage grow as needed.
+		constexpr std::uint64_t MAX_RESERVE = 4096;
+		const bool bounded = counts_entries && m_MaxSize != std::numeric_limits<size_t>::max();
+		const std::uint64_t limit = bounded ? m_MaxSize : MAX_RESERVE;
+
+		try
+		{
+			m_Cache.reserve(static_cast<size_t>(std::min<std::uint64_t>(count, limit)));
+
+			for(std::uint64_t i = 0; i < count; i++)
+			{
+				const std::uint64_t state = Serializer<std::uint64_t>::read(is);
+				const std::int64_t ttl = Serializer<std::int64_t>::read(is);
+				key_type key = KeySerializer::read(is);
+				mapped_type value = ValueSerializer::read(is);
+
+				if(!is) throw std::runtime_error("Cache::load(): truncated snapshot");
+
+				// Entries that had already expired are saved anyway, since the
+				// number of entries is written before them
+				if(ttl < 0) continue;
+
+				auto pair = m_Cache.emplace(std::move(key), std::move(value));
+				if(pair.second) restore_entry(pair.first, state, ttl, now);
+			}
+		}
+		catch(const std::bad_alloc&)
+		{
+			reset();
+			throw std::runtime_error("Cache::load(): invalid snapshot");
+		}
+		catch(...)
+		{
+			reset();
+			throw;
+		}
+	}
+
+	// Same as add_entry(), but restores the saved state of the entry instead
+	void restore_entry(iterator it, std::uint64_t state, std::int64_t ttl, typename Clock::time_point now)
+	{
+		const size_t weight = weigh(*it);
+
+		if(weight > m_MaxSize)
+		{
+			m_Cache.erase(it);
+			return;
+		}
+
+		m_Weight += weight;
+
+		while(m_Weight > m_MaxSize && m_Cache.size() > 1)
+			make_room(it->first, true);
+
+		detail::restore(m_CachePolicy, it->first, state, weight);
+
+		if(ttl > 0)
+		{
+			const auto left = std::chrono::duration_cast<duration>(std::chrono::nanoseconds(ttl));
+			m_Expiry.schedule(it->first, now + std::max(left, duration(1)), now);
+		}
+	}
+
+	// Expired entries are always reported as missing, but only non-const
+	// lookups remove them
+	template<typename Self, typename K>
+	static auto& at_entry(Self& self, const K& key)
+	{
+		auto it = detail::find(self.m_Cache, key);
+
+		if(it == self.m_Cache.end()) throw std::out_of_range("Cache::at(): key not found");
+		if(self.is_expired(it->first)) throw std::out_of_range("Cache::at(): key has expired");
+
+		return it->second;
+	}
+
+	// Once found, the policy and the timing wheel get the key stored in the
+	// cache, so they never see the type `key` was looked up with
+	template<typename K>
+	iterator find_key(const K& key)
+	{
+		auto it = detail::find(m_Cache, key);
+		if(it != m_Cache.end() && drop_if_expired(it)) it = m_Cache.end();
 
 		return (it != m_Cache.end() ?
-			(m_Stats.hit(it->first, it->second), m_CachePolicy.touch(key), it) :
-			(m_Stats.miss(key), it));
+			(m_Stats.hit(it->first, it->second), m_CachePolicy.touch(it->first), it) :
+			(detail::miss<Key>(m_Stats, key), it));
 	}
 
-	const_iterator find_key(const key_type& key) const
+	template<typename K>
+	const_iterator find_key(const K& key) const
 	{
-		auto it = m_Cache.find(key);
+		auto it = detail::find(m_Cache, key);
+		if(it != m_Cache.end() && is_expired(it->first)) it = m_Cache.end();
 
 		return (it != m_Cache.end() ?
-			(m_Stats.hit(it->first, it->second), m_CachePolicy.touch(key), it) :
-			(m_Stats.miss(key), it));
+			(m_Stats.hit(it->first, it->second), m_CachePolicy.touch(it->first), it) :
+			(detail::miss<Key>(m_Stats, key), it));
+	}
+
+	template<typename K>
+	bool copy_entry(const K& key, mapped_type& value) const
+	{
+		auto it = find_key(key);
+		if(it == m_Cache.end()) return false;
+
+		value = it->second;
+		return true;
+	}
+
+	template<typename K>
+	size_type erase_key(const K& key)
+	{
+		auto it = find_key(key);
+
+		if(it == m_Cache.end()) return 0;
+
+		m_CachePolicy.erase(it->first);
+		m_Stats.erase(it->first, it->second);
+		m_Weight -= weigh(*it);
+		m_Expiry.cancel(it->first);
+		m_Cache.erase(it);
+
+		return 1;
 	}
 };
 
@@ -278,9 +853,12 @@ namespace std
 		template<typename> class Policy,
 		typename Lock,
 		template<typename...> class Stats,
+		template<typename...> class Storage,
+		typename Weigher,
+		typename Clock,
 		typename Pred
 	>
-	typename Cache<Key, Value, Policy, Lock, Stats>::size_type erase_if(Cache<Key, Value, Policy, Lock, Stats>& c, Pred pred)
+	typename Cache<Key, Value, Policy, Lock, Stats, Storage, Weigher, Clock>::size_type erase_if(Cache<Key, Value, Policy, Lock, Stats, Storage, Weigher, Clock>& c, Pred pred)
 	{
 		auto old_size = c.size();
 		for(auto i = c.begin(), last = c.end(); i != last;)
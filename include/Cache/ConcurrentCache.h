@@ -0,0 +1,483 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Policy/Random.h"
+#include "Stats/Concurrent.h"
+#include "detail/policy_hooks.h"
+#include "detail/read_buffer.h"
+#include "detail/thread_index.h"
+
+// A thread-safe cache for read-mostly workloads. Unlike a `Cache` guarded by a
+// mutex, lookups never take a global lock: entries live in a hash map split in
+// segments, each one with its own reader-writer lock, and reads of different
+// keys only share a segment lock in read mode.
+//
+// The replacement policy is still a single, non-thread-safe object guarded by
+// a mutex. Lookups record the keys they read in a set of lossy read buffers
+// instead, which are applied to the policy in batches whenever a buffer fills
+// up and the policy is not busy, and before every write. Writes (insertions,
+// assignments and erasures) take the lock of the policy, so they are
+// serialized like in a thread-safe `Cache`.
+//
+// Statistics are reported from many threads at once, so `StatsProvider` must
+// be thread-safe, like Stats::Concurrent or Stats::None. Lookups report hits
+// and misses without taking any lock, while the rest of the events are
+// reported with the policy locked.
+template<
+	typename Key,                                                 // Key type
+	typename Value,                                               // Value type
+	template<typename> class CachePolicy = Policy::Random,        // Cache policy
+	template<typename...> class StatsProvider = Stats::Concurrent // Statistics measurement object (must be thread-safe)
+>
+class ConcurrentCache
+{
+public:
+	using key_type        = Key;
+	using mapped_type     = Value;
+	using value_type      = std::pair<const Key, Value>;
+	using size_type       = std::size_t;
+
+private:
+	struct segment
+	{
+		mutable std::shared_timed_mutex lock;
+		std::unordered_map<Key, Value> entries;
+	};
+
+	using read_lock  = std::shared_lock<std::shared_timed_mutex>;
+	using write_lock = std::lock_guard<std::shared_timed_mutex>;
+
+	const size_t m_MaxSize;
+	unsigned m_SegmentBits;
+	std::vector<std::unique_ptr<segment>> m_Segments;
+	mutable std::vector<std::unique_ptr<detail::read_buffer<Key>>> m_ReadBuffers;
+	std::atomic<size_t> m_Size{0};
+	mutable CachePolicy<Key> m_CachePolicy;
+	mutable StatsProvider<Key, Value> m_Stats;
+	mutable std::mutex m_PolicyLock;
+
+	static unsigned log2_ceil(size_t count) noexcept
+	{
+		unsigned bits = 0;
+		while((size_t{1} << bits) < count) bits++;
+
+		return bits;
+	}
+
+	segment& segment_for(const key_type& key) const noexcept
+	{
+		if(m_SegmentBits == 0) return *m_Segments.front();
+
+		// Use the top bits of the hash, so that segments do not correlate with
+		// the low bits used by the buckets of each segment
+		const std::uint64_t hash = static_cast<std::uint64_t>(std::hash<key_type>{}(key));
+		return *m_Segments[static_cast<size_t>((hash * 0x9E3779B97F4A7C15ULL) >> (64 - m_SegmentBits))];
+	}
+
+	// Every thread always records its reads in the same buffer
+	detail::read_buffer<Key>& read_buffer_for_this_thread() const noexcept
+	{
+		return *m_ReadBuffers[detail::thread_index() & (m_ReadBuffers.size() - 1)];
+	}
+
+public:
+	static size_t default_segment_count() noexcept
+	{
+		const size_t threads = std::thread::hardware_concurrency();
+		return threads == 0 ? 8 : 4 * threads;
+	}
+
+	ConcurrentCache(
+		const size_t max_size,
+		const size_t segment_count = default_segment_count(),
+		const CachePolicy<Key>& policy = CachePolicy<Key>(),
+		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>())
+		: m_MaxSize(max_size == 0 ? std::numeric_limits<size_t>::max() : max_size),
+		  m_SegmentBits(log2_ceil(segment_count == 0 ? 1 : segment_count)), m_CachePolicy(policy), m_Stats(stats)
+	{
+		const size_t segments = size_t{1} << m_SegmentBits;
+		const size_t threads = std::thread::hardware_concurrency();
+
+		m_Segments.reserve(segments);
+		for(size_t i = 0; i < segments; i++)
+		{
+			m_Segments.emplace_back(new segment());
+			if(max_size != 0) m_Segments.back()->entries.reserve(max_size / segments + 1);
+		}
+
+		// One read buffer per hardware thread (rounded up to a power of two)
+		// keeps two threads from sharing a buffer most of the time
+		for(size_t i = 0; i < (size_t{1} << log2_ceil(threads == 0 ? 4 : threads)); i++)
+			m_ReadBuffers.emplace_back(new detail::read_buffer<Key>());
+
+		detail::reserve(m_CachePolicy, m_MaxSize);
+	}
+
+	ConcurrentCache(const ConcurrentCache&) = delete;
+	ConcurrentCache& operator=(const ConcurrentCache&) = delete;
+
+	~ConcurrentCache() = default;
+
+	bool empty() const noexcept { return size() == 0; }
+
+	size_type size() const noexcept { return m_Size.load(std::memory_order_relaxed); }
+	constexpr size_type max_size() const noexcept { return m_MaxSize; }
+
+	size_type segment_count() const noexcept { return m_Segments.size(); }
+
+	// Values are returned by copy, since another thread could replace or
+	// evict the entry as soon as the lookup returns
+	mapped_type at(const key_type& key) const
+	{
+		return copy_entry(key, [this, &key]() -> mapped_type
+		{
+			m_Stats.miss(key);
+			throw std::out_of_range("ConcurrentCache::at(): key not found");
+		});
+	}
+
+	mapped_type lookup(const key_type& key) const { return at(key); }
+
+	// Copies the value of `key` into `value`. Returns false (leaving `value`
+	// untouched) if the key is not in the cache.
+	bool try_get(const key_type& key, mapped_type& value) const { return find_entry(key, [&value](const mapped_type& v) { value = v; }); }
+
+	bool   contains(const key_type& key) const { return find_entry(key, [](const mapped_type&) {}); }
+	size_type count(const key_type& key) const { return contains(key) ? 1 : 0; }
+
+	// If the policy rejects the key, nothing is inserted and false is returned
+	bool insert(const value_type&  val) { return insert(val.first, val.second); }
+	bool insert(      value_type&& val) { return insert(val.first, std::move(val.second)); }
+
+	bool insert(const key_type&  key, const mapped_type&  value) { return try_emplace(key, value); }
+	bool insert(const key_type&  key,       mapped_type&& value) { return try_emplace(key, std::move(value)); }
+	bool insert(      key_type&& key, const mapped_type&  value) { return try_emplace(std::move(key), value); }
+	bool insert(      key_type&& key,       mapped_type&& value) { return try_emplace(std::move(key), std::move(value)); }
+
+	template<typename InputIt>
+	void insert(InputIt first, InputIt last)
+	{
+		for(; first != last; ++first)
+			insert(first->first, first->second);
+	}
+
+	void insert(std::initializer_list<value_type> ilist) { insert(ilist.begin(), ilist.end()); }
+
+	// Inserts a value constructed in place from `args` if `key` is not in the
+	// cache. Otherwise nothing is constructed and the key is just touched.
+	template<typename... Args>
+	bool try_emplace(const key_type& key, Args&&... args)
+	{
+		std::lock_guard<std::mutex> lock(m_PolicyLock);
+		drain();
+
+		return emplace_entry(false, key, std::forward<Args>(args)...);
+	}
+
+	template<typename... Args>
+	bool try_emplace(key_type&& key, Args&&... args)
+	{
+		std::lock_guard<std::mutex> lock(m_PolicyLock);
+		drain();
+
+		return emplace_entry(false, std::move(key), std::forward<Args>(args)...);
+	}
+
+	// Inserts `value` if `key` is not in the cache, or assigns it otherwise.
+	// Returns true if the key was inserted.
+	template<typename M>
+	bool insert_or_assign(const key_type& key, M&& value)
+	{
+		std::lock_guard<std::mutex> lock(m_PolicyLock);
+		drain();
+
+		return assign_entry(key, std::forward<M>(value));
+	}
+
+	template<typename M>
+	bool insert_or_assign(key_type&& key, M&& value)
+	{
+		std::lock_guard<std::mutex> lock(m_PolicyLock);
+		drain();
+
+		return assign_entry(std::move(key), std::forward<M>(value));
+	}
+
+	// Returns the value of `key`, inserting the result of `factory()` first if
+	// the key is not in the cache. Hits take the same lock-free path as any
+	// other lookup, while `factory` is called with the policy locked.
+	template<typename Factory>
+	mapped_type get_or_insert_with(const key_type& key, Factory&& factory)
+	{
+		return copy_entry(key, [this, &key, &factory]()
+		{
+			std::lock_guard<std::mutex> lock(m_PolicyLock);
+			drain();
+
+			return get_or_insert_entry(key, factory);
+		});
+	}
+
+	size_type erase(const key_type& key)
+	{
+		std::lock_guard<std::mutex> lock(m_PolicyLock);
+		drain();
+
+		segment& seg = segment_for(key);
+		auto it = seg.entries.find(key);
+
+		if(it == seg.entries.end()) return 0;
+
+		write_lock seg_lock(seg.lock);
+		m_CachePolicy.erase(it->first);
+		m_Stats.erase(it->first, it->second);
+		seg.entries.erase(it);
+		m_Size.fetch_sub(1, std::memory_order_relaxed);
+
+		return 1;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(m_PolicyLock);
+
+		// Pending reads refer to entries that are about to disappear
+		for(auto& buffer : m_ReadBuffers)
+			buffer->drain([](const key_type&) {});
+
+		for(auto& seg : m_Segments)
+		{
+			write_lock seg_lock(seg->lock);
+			seg->entries.clear();
+		}
+
+		m_CachePolicy.clear();
+		m_Stats.clear();
+		m_Size.store(0, std::memory_order_relaxed);
+	}
+
+	void flush() { clear(); }
+	void flush(const key_type& key) { erase(key); }
+
+	// Applies every read recorded so far to the replacement policy. This is
+	// done automatically as the read buffers fill up and before every write,
+	// so it is only needed to observe the exact order of the policy.
+	void drain_buffers()
+	{
+		std::lock_guard<std::mutex> lock(m_PolicyLock);
+		drain();
+	}
+
+	// The statistics provider itself, for providers with extra information
+	// such as the latency percentiles of Stats::Latency
+	const StatsProvider<Key, Value>& stats() const noexcept { return m_Stats; }
+
+	size_type hit_count() const noexcept { return m_Stats.hit_count(); }
+	size_type miss_count() const noexcept { return m_Stats.miss_count(); }
+	size_type access_count() const noexcept { return m_Stats.hit_count() + m_Stats.miss_count(); }
+	size_type entry_invalidation_count() const noexcept { return m_Stats.entry_invalidation_count(); }
+	size_type cache_invalidation_count() const noexcept { return m_Stats.cache_invalidation_count(); }
+	size_type evicted_count() const noexcept { return m_Stats.evicted_count(); }
+
+	float hit_ratio  () const noexcept { return static_cast<float>(hit_count ()) / (static_cast<float>(hit_count() + miss_count())); }
+	float miss_ratio () const noexcept { return static_cast<float>(miss_count()) / (static_cast<float>(hit_count() + miss_count())); }
+	float utilization() const noexcept { return static_cast<float>(size())       /  static_cast<float>(m_MaxSize); }
+
+private:
+	// Looks `key` up with its segment locked in read mode, and calls fn(value)
+	// if it is found. The read is recorded for the policy once the segment is
+	// unlocked.
+	template<typename Fn>
+	bool find_entry(const key_type& key, Fn&& fn) const
+	{
+		segment& seg = segment_for(key);
+
+		{
+			read_lock seg_lock(seg.lock);
+			auto it = seg.entries.find(key);
+
+			if(it == seg.entries.end())
+			{
+				m_Stats.miss(key);
+				return false;
+			}
+
+			fn(it->second);
+			m_Stats.hit(it->first, it->second);
+		}
+
+		record_read(key);
+		return true;
+	}
+
+	// Returns a copy of the value of `key`, or the result of on_miss() if the
+	// key is not in the cache. Misses are left to on_miss() to report.
+	template<typename OnMiss>
+	mapped_type copy_entry(const key_type& key, OnMiss&& on_miss) const
+	{
+		segment& seg = segment_for(key);
+		read_lock seg_lock(seg.lock);
+		auto it = seg.entries.find(key);
+
+		if(it == seg.entries.end())
+		{
+			seg_lock.unlock();
+			return on_miss();
+		}
+
+		mapped_type value(it->second);
+		m_Stats.hit(it->first, it->second);
+		seg_lock.unlock();
+
+		record_read(key);
+		return value;
+	}
+
+	void record_read(const key_type& key) const
+	{
+		if(!read_buffer_for_this_thread().offer(key)) return;
+
+		// If another thread holds the policy, it will drain the buffers soon
+		std::unique_lock<std::mutex> lock(m_PolicyLock, std::try_to_lock);
+		if(lock.owns_lock()) drain();
+	}
+
+	// Must be called with the policy locked. Every write holds that lock, so
+	// no segment can change while the buffers are drained, and the segments
+	// can be read without locking them.
+	void drain() const
+	{
+		for(auto& buffer : m_ReadBuffers)
+		{
+			buffer->drain([this](const key_type& key)
+			{
+				// The key may have been evicted or erased after it was read
+				const segment& seg = segment_for(key);
+				if(seg.entries.find(key) != seg.entries.end()) m_CachePolicy.touch(key);
+			});
+		}
+	}
+
+	// Writes must drain the read buffers before calling any of the following
+	template<typename K, typename... Args>
+	bool emplace_entry(bool force, K&& key, Args&&... args)
+	{
+		segment& seg = segment_for(key);
+		if(seg.entries.find(key) != seg.entries.end())
+		{
+			m_CachePolicy.touch(key);
+			return false;
+		}
+
+		if(size() >= m_MaxSize && !make_room(key, force)) return false;
+
+		typename std::unordered_map<Key, Value>::iterator it;
+		{
+			write_lock seg_lock(seg.lock);
+			it = seg.entries.emplace(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...)).first;
+		}
+
+		detail::insert(m_CachePolicy, it->first, 1);
+		m_Size.fetch_add(1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	template<typename K, typename M>
+	bool assign_entry(K&& key, M&& value)
+	{
+		segment& seg = segment_for(key);
+		auto it = seg.entries.find(key);
+
+		if(it == seg.entries.end())
+			return emplace_entry(false, std::forward<K>(key), std::forward<M>(value));
+
+		{
+			write_lock seg_lock(seg.lock);
+			it->second = std::forward<M>(value);
+		}
+
+		m_CachePolicy.touch(it->first);
+		return false;
+	}
+
+	template<typename Factory>
+	mapped_type get_or_insert_entry(const key_type& key, Factory& factory)
+	{
+		// Another thread may have inserted the key since it was looked up
+		segment& seg = segment_for(key);
+		auto it = seg.entries.find(key);
+
+		if(it != seg.entries.end())
+		{
+			m_Stats.hit(it->first, it->second);
+			m_CachePolicy.touch(it->first);
+			return it->second;
+		}
+
+		m_Stats.miss(key);
+
+		mapped_type value = factory();
+		emplace_entry(true, key, value);
+
+		return value;
+	}
+
+	// Evicts the replacement candidate to make room for `key`, unless the
+	// policy refuses to admit `key` (and the admission is not forced)
+	bool make_room(const key_type& key, bool force)
+	{
+		const auto& victim = m_CachePolicy.replace_candidate();
+		if(!force && !detail::admit(m_CachePolicy, key, victim)) return false;
+
+		segment& seg = segment_for(victim);
+		write_lock seg_lock(seg.lock);
+		auto it = seg.entries.find(victim);
+
+		m_CachePolicy.erase(it->first);
+		m_Stats.evict(it->first, it->second);
+		seg.entries.erase(it);
+		m_Size.fetch_sub(1, std::memory_order_relaxed);
+
+		return true;
+	}
+};
@@ -0,0 +1,86 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <utility>
+
+#include "Serializer.h"
+
+// A key bundled with its hash, which is computed only once, when the key is
+// created. The hash of a HashedKey is the stored hash, so the storage, the
+// replacement policy and any other part of a cache that hashes keys just read
+// it instead of hashing the key again. Equality compares the hashes before
+// the keys, so most mismatches don't even look at the keys.
+//
+// Worth it for keys that are expensive to hash (like long strings or tuples),
+// as long as the key is built once and then used for every operation on it:
+//
+//   Cache<HashedKey<std::string>, Value, Policy::LRU> cache(1000);
+//
+//   HashedKey<std::string> key(std::move(url)); // Hashed here
+//   if(!cache.contains(key)) cache.insert(key, fetch(key.key()));
+template<typename Key, typename Hash = std::hash<Key>>
+class HashedKey
+{
+private:
+	Key m_Key;
+	std::size_t m_Hash;
+
+public:
+	HashedKey(const Key& key) : m_Key(key), m_Hash(Hash{}(m_Key)) {}
+	HashedKey(Key&& key) : m_Key(std::move(key)), m_Hash(Hash{}(m_Key)) {}
+
+	// For keys whose hash is already known, so that it is not computed again
+	HashedKey(const Key& key, std::size_t hash) : m_Key(key), m_Hash(hash) {}
+	HashedKey(Key&& key, std::size_t hash) : m_Key(std::move(key)), m_Hash(hash) {}
+
+	const Key& key() const noexcept { return m_Key; }
+	std::size_t hash() const noexcept { return m_Hash; }
+
+	friend bool operator==(const HashedKey& lhs, const HashedKey& rhs) { return lhs.m_Hash == rhs.m_Hash && lhs.m_Key == rhs.m_Key; }
+	friend bool operator!=(const HashedKey& lhs, const HashedKey& rhs) { return !(lhs == rhs); }
+	friend bool operator< (const HashedKey& lhs, const HashedKey& rhs) { return lhs.m_Key < rhs.m_Key; }
+};
+
+namespace std
+{
+	template<typename Key, typename Hash>
+	struct hash<HashedKey<Key, Hash>>
+	{
+		size_t operator()(const HashedKey<Key, Hash>& key) const noexcept { return key.hash(); }
+	};
+}
+
+// Only the key is saved in snapshots, and it is hashed again when loaded
+template<typename Key, typename Hash>
+struct Serializer<HashedKey<Key, Hash>>
+{
+	static void write(std::ostream& os, const HashedKey<Key, Hash>& key) { Serializer<Key>::write(os, key.key()); }
+	static HashedKey<Key, Hash> read(std::istream& is) { return HashedKey<Key, Hash>(Serializer<Key>::read(is)); }
+};
@@ -0,0 +1,449 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Cache.h"
+#include "Policy/Intrusive.h"
+#include "detail/hash.h"
+
+// A cache where every entry is a single allocation holding the key, the value,
+// the hook of the replacement policy and the link of its hash bucket. Policies
+// work directly on those hooks (see Policy/Intrusive.h), so keys are stored
+// only once and a hit is one hash table lookup plus a pointer splice.
+//
+// Since the policy keeps pointers into the entries of the cache, intrusive
+// caches can be neither copied nor moved.
+template<
+	typename Key,                                            // Key type
+	typename Value,                                          // Value type
+	typename CachePolicy = Policy::Intrusive::LRU,           // Intrusive cache policy
+	typename Lock = NullLock,                                // Lock type (for multithreading)
+	template<typename...> class StatsProvider = Stats::Basic // Statistics measurement object
+>
+class IntrusiveCache
+{
+public:
+	using key_type        = Key;
+	using mapped_type     = Value;
+	using value_type      = std::pair<const Key, Value>;
+	using reference       = value_type&;
+	using const_reference = const value_type&;
+	using pointer         = value_type*;
+	using const_pointer   = const value_type*;
+	using size_type       = std::size_t;
+	using difference_type = std::ptrdiff_t;
+
+private:
+	using hook_type = typename CachePolicy::hook_type;
+
+	struct node : hook_type
+	{
+		node* chain;       // Next node in the same bucket
+		std::uint64_t hash;
+		value_type entry;
+
+		template<typename... Args>
+		explicit node(Args&&... args) : hook_type(), chain(nullptr), hash(0), entry(std::forward<Args>(args)...) {}
+	};
+
+	template<bool Const>
+	class basic_iterator
+	{
+	private:
+		friend class IntrusiveCache;
+		template<bool> friend class basic_iterator;
+
+		node* const* m_Bucket;
+		node* const* m_Last;
+		node* m_Node;
+
+		basic_iterator(node* const* bucket, node* const* last, node* n) noexcept : m_Bucket(bucket), m_Last(last), m_Node(n) {}
+
+		void skip_empty_buckets() noexcept
+		{
+			while(m_Bucket != m_Last && *m_Bucket == nullptr) ++m_Bucket;
+			m_Node = (m_Bucket != m_Last ? *m_Bucket : nullptr);
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = typename IntrusiveCache::value_type;
+		using difference_type   = typename IntrusiveCache::difference_type;
+		using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+		using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+
+		basic_iterator() noexcept : m_Bucket(nullptr), m_Last(nullptr), m_Node(nullptr) {}
+
+		template<bool C = Const, typename = std::enable_if_t<C>>
+		basic_iterator(const basic_iterator<false>& other) noexcept : m_Bucket(other.m_Bucket), m_Last(other.m_Last), m_Node(other.m_Node) {}
+
+		reference operator*() const noexcept { return m_Node->entry; }
+		pointer operator->() const noexcept { return &m_Node->entry; }
+
+		basic_iterator& operator++() noexcept
+		{
+			if(m_Node->chain != nullptr)
+				m_Node = m_Node->chain;
+			else
+			{
+				++m_Bucket;
+				skip_empty_buckets();
+			}
+
+			return *this;
+		}
+
+		basic_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+
+		friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) noexcept { return lhs.m_Node == rhs.m_Node; }
+		friend bool operator!=(const basic_iterator& lhs, const basic_iterator& rhs) noexcept { return lhs.m_Node != rhs.m_Node; }
+	};
+
+public:
+	using iterator       = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+private:
+	const size_t m_MaxSize;
+	std::vector<node*> m_Buckets;
+	size_type m_Size;
+	mutable CachePolicy m_CachePolicy;
+	mutable StatsProvider<Key, Value> m_Stats;
+	mutable Lock m_Lock;
+
+	static std::uint64_t hash(const key_type& key) { return detail::mix(static_cast<std::uint64_t>(std::hash<key_type>{}(key))); }
+
+	// Buckets are allocated as the cache grows, so only size them upfront for
+	// the first few entries
+	static size_type bucket_count_for(size_type count) noexcept
+	{
+		static constexpr size_type MAX_RESERVE_SIZE = 1024;
+		if(count > MAX_RESERVE_SIZE) count = MAX_RESERVE_SIZE;
+
+		size_type buckets = 16;
+		while(buckets < count) buckets *= 2;
+
+		return buckets;
+	}
+
+	size_type bucket_index(std::uint64_t h) const noexcept { return static_cast<size_type>(h) & (m_Buckets.size() - 1); }
+
+	iterator iterator_at(node* n) noexcept
+	{
+		node* const* first = m_Buckets.data();
+		return iterator(first + bucket_index(n->hash), first + m_Buckets.size(), n);
+	}
+
+	const_iterator iterator_at(node* n) const noexcept
+	{
+		node* const* first = m_Buckets.data();
+		return const_iterator(first + bucket_index(n->hash), first + m_Buckets.size(), n);
+	}
+
+	node* find_node(const key_type& key, std::uint64_t h) const
+	{
+		for(node* n = m_Buckets[bucket_index(h)]; n != nullptr; n = n->chain)
+			if(n->hash == h && n->entry.first == key) return n;
+
+		return nullptr;
+	}
+
+	void link(node* n) noexcept
+	{
+		node*& bucket = m_Buckets[bucket_index(n->hash)];
+		n->chain = bucket;
+		bucket = n;
+		m_Size++;
+	}
+
+	void unlink(node* n) noexcept
+	{
+		node** link = &m_Buckets[bucket_index(n->hash)];
+		while(*link != n) link = &(*link)->chain;
+
+		*link = n->chain;
+		m_Size--;
+	}
+
+	// Keep the load factor at or below 1 so that chains stay short
+	void grow_if_needed(size_type size)
+	{
+		if(size <= m_Buckets.size()) return;
+
+		std::vector<node*> buckets(m_Buckets.size() * 2, nullptr);
+		for(node* first : m_Buckets)
+		{
+			for(node* n = first; n != nullptr;)
+			{
+				node* next = n->chain;
+				node*& bucket = buckets[static_cast<size_type>(n->hash) & (buckets.size() - 1)];
+				n->chain = bucket;
+				bucket = n;
+				n = next;
+			}
+		}
+
+		m_Buckets.swap(buckets);
+	}
+
+	// `n` must not be in the cache yet. The buckets are grown before evicting
+	// anything, so if that throws, the cache is left as it was.
+	iterator insert_node(std::unique_ptr<node> n)
+	{
+		const bool full = m_Size + 1 > m_MaxSize;
+		grow_if_needed(full ? m_Size : m_Size + 1);
+
+		if(full) evict();
+
+		link(n.get());
+		m_CachePolicy.insert(*n);
+
+		return iterator_at(n.release());
+	}
+
+	void evict()
+	{
+		node* victim = static_cast<node*>(&m_CachePolicy.replace_candidate());
+
+		m_CachePolicy.erase(*victim);
+		m_Stats.evict(victim->entry.first, victim->entry.second);
+		unlink(victim);
+		delete victim;
+	}
+
+	void erase_node(node* n)
+	{
+		m_CachePolicy.erase(*n);
+		m_Stats.erase(n->entry.first, n->entry.second);
+		unlink(n);
+		delete n;
+	}
+
+	void delete_nodes() noexcept
+	{
+		for(node*& first : m_Buckets)
+		{
+			for(node* n = first; n != nullptr;)
+			{
+				node* next = n->chain;
+				delete n;
+				n = next;
+			}
+
+			first = nullptr;
+		}
+
+		m_Size = 0;
+	}
+
+	node* find_key(const key_type& key) const
+	{
+		node* n = find_node(key, hash(key));
+
+		if(n != nullptr)
+		{
+			m_Stats.hit(n->entry.first, n->entry.second);
+			m_CachePolicy.touch(*n);
+		}
+		else
+			m_Stats.miss(key);
+
+		return n;
+	}
+
+	template<typename... Args>
+	std::pair<iterator, bool> insert_entry(const key_type& key, Args&&... args)
+	{
+		const std::uint64_t h = hash(key);
+		node* n = find_node(key, h);
+
+		if(n != nullptr)
+		{
+			m_CachePolicy.touch(*n);
+			return { iterator_at(n), false };
+		}
+
+		std::unique_ptr<node> created(new node(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...)));
+		created->hash = h;
+
+		return { insert_node(std::move(created)), true };
+	}
+
+public:
+	IntrusiveCache(
+		const size_t max_size,
+		const CachePolicy& policy = CachePolicy(),
+		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>())
+		: m_MaxSize(max_size == 0 ? std::numeric_limits<size_t>::max() : max_size),
+		  m_Buckets(bucket_count_for(max_size), nullptr), m_Size(0), m_CachePolicy(policy), m_Stats(stats), m_Lock()
+	{
+	}
+
+	IntrusiveCache(const IntrusiveCache&) = delete;
+	IntrusiveCache& operator=(const IntrusiveCache&) = delete;
+
+	~IntrusiveCache() { delete_nodes(); }
+
+	iterator begin() noexcept
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		iterator it(m_Buckets.data(), m_Buckets.data() + m_Buckets.size(), nullptr);
+		it.skip_empty_buckets();
+		return it;
+	}
+
+	const_iterator begin() const noexcept { return const_cast<IntrusiveCache*>(this)->begin(); }
+	const_iterator cbegin() const noexcept { return begin(); }
+
+	      iterator  end()       noexcept { return iterator(); }
+	const_iterator  end() const noexcept { return const_iterator(); }
+	const_iterator cend() const noexcept { return const_iterator(); }
+
+	bool empty() const noexcept { std::lock_guard<Lock> lock(m_Lock); return m_Size == 0; }
+
+	size_type size() const noexcept { std::lock_guard<Lock> lock(m_Lock); return m_Size; }
+	constexpr size_type max_size() const noexcept { return m_MaxSize; }
+
+	mapped_type& at(const key_type& key)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		node* n = find_node(key, hash(key));
+		if(n == nullptr) throw std::out_of_range("IntrusiveCache::at");
+
+		return n->entry.second;
+	}
+
+	const mapped_type& at(const key_type& key) const { return const_cast<IntrusiveCache*>(this)->at(key); }
+
+	      mapped_type& lookup(const key_type& key)       { return at(key); }
+	const mapped_type& lookup(const key_type& key) const { return at(key); }
+
+	mapped_type& operator[](const key_type& key) { std::lock_guard<Lock> lock(m_Lock); return insert_entry(key).first->second; }
+
+	iterator erase(const_iterator pos)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+
+		iterator next(pos.m_Bucket, pos.m_Last, pos.m_Node);
+		++next;
+
+		erase_node(pos.m_Node);
+		return next;
+	}
+
+	size_type erase(const key_type& key)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		node* n = find_key(key);
+
+		if(n == nullptr) return 0;
+
+		erase_node(n);
+		return 1;
+	}
+
+	template<typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+
+		std::unique_ptr<node> n(new node(std::forward<Args>(args)...));
+		n->hash = hash(n->entry.first);
+
+		if(node* existing = find_node(n->entry.first, n->hash))
+		{
+			m_CachePolicy.touch(*existing);
+			return { iterator_at(existing), false };
+		}
+
+		return { insert_node(std::move(n)), true };
+	}
+
+	template<typename InputIt>
+	void insert(InputIt first, InputIt last)
+	{
+		for(; first != last; ++first)
+			insert(first->first, first->second);
+	}
+
+	void insert(std::initializer_list<value_type> ilist) { insert(ilist.begin(), ilist.end()); }
+	std::pair<iterator, bool> insert(const value_type& val) { return insert(val.first, val.second); }
+
+	std::pair<iterator, bool> insert(const key_type& key, const mapped_type& value)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		return insert_entry(key, value);
+	}
+
+	void clear() noexcept
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+
+		m_CachePolicy.clear();
+		delete_nodes();
+		m_Stats.clear();
+	}
+
+	void flush() noexcept { clear(); }
+	void flush(const key_type& key) noexcept { erase(key); }
+
+	bool   contains(const key_type& key) const { std::lock_guard<Lock> lock(m_Lock); return find_key(key) != nullptr; }
+	size_type count(const key_type& key) const { std::lock_guard<Lock> lock(m_Lock); return find_key(key) != nullptr; }
+
+	iterator find(const key_type& key)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		node* n = find_key(key);
+		return n != nullptr ? iterator_at(n) : iterator();
+	}
+
+	const_iterator find(const key_type& key) const { return const_cast<IntrusiveCache*>(this)->find(key); }
+
+	size_type hit_count() const noexcept { return m_Stats.hit_count(); }
+	size_type miss_count() const noexcept { return m_Stats.miss_count(); }
+	size_type access_count() const noexcept { return m_Stats.hit_count() + m_Stats.miss_count(); }
+	size_type entry_invalidation_count() const noexcept { return m_Stats.entry_invalidation_count(); }
+	size_type cache_invalidation_count() const noexcept { return m_Stats.cache_invalidation_count(); }
+	size_type evicted_count() const noexcept { return m_Stats.evicted_count(); }
+
+	float hit_ratio  () const noexcept { return static_cast<float>(hit_count ()) / (static_cast<float>(hit_count() + miss_count())); }
+	float miss_ratio () const noexcept { return static_cast<float>(miss_count()) / (static_cast<float>(hit_count() + miss_count())); }
+	float utilization() const noexcept { return static_cast<float>(m_Size)       /  static_cast<float>(m_MaxSize); }
+};
@@ -0,0 +1,511 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "Cache.h"
+#include "detail/hash.h"
+#include "detail/mapped_region.h"
+
+// A fixed-size cache stored entirely inside a memory mapping instead of the
+// heap. Entries live in an open addressing table (linear probing, with
+// backward shift deletion so there are no tombstones) that refers to other
+// slots by index only, and the replacement policy is CLOCK, whose reference
+// bits and hand are stored in the same mapping.
+//
+// Without a path, the mapping is anonymous (and backed by huge pages when
+// possible). With a path, it is backed by that file, so the cache survives a
+// restart of the process: opening the same file again gives back the same
+// entries. This only works with keys and values that are trivially copyable
+// and whose std::hash does not change between runs, and the file can only be
+// opened by one cache at a time and by the same build of the program.
+template<
+	typename Key,                                            // Key type (trivially copyable)
+	typename Value,                                          // Value type (trivially copyable)
+	typename Lock = NullLock,                                // Lock type (for multithreading)
+	template<typename...> class StatsProvider = Stats::Basic // Statistics measurement object
+>
+class MappedCache
+{
+	static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value, "MappedCache: keys and values must be trivially copyable");
+
+public:
+	using key_type        = Key;
+	using mapped_type     = Value;
+	using value_type      = std::pair<const Key, Value>;
+	using reference       = value_type&;
+	using const_reference = const value_type&;
+	using pointer         = value_type*;
+	using const_pointer   = const value_type*;
+	using size_type       = std::size_t;
+	using difference_type = std::ptrdiff_t;
+
+private:
+	static constexpr std::uint32_t VERSION = 1;
+
+	struct header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t dirty;       // Set while the slots are being modified
+		std::uint64_t key_size;
+		std::uint64_t value_size;
+		std::uint64_t slot_size;
+		std::uint64_t slot_count;
+		std::uint64_t max_size;
+		std::uint64_t size;
+		std::uint64_t hand;        // Next slot the CLOCK hand looks at
+	};
+
+	struct slot
+	{
+		std::uint8_t used;
+		std::uint8_t referenced;   // CLOCK reference bit
+		value_type entry;
+	};
+
+	template<bool Const>
+	class basic_iterator
+	{
+	private:
+		friend class MappedCache;
+		template<bool> friend class basic_iterator;
+
+		slot* m_Slot;
+		slot* m_Last;
+
+		basic_iterator(slot* s, slot* last) noexcept : m_Slot(s), m_Last(last) {}
+
+		void skip_free_slots() noexcept
+		{
+			while(m_Slot != m_Last && !m_Slot->used) ++m_Slot;
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = typename MappedCache::value_type;
+		using difference_type   = typename MappedCache::difference_type;
+		using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+		using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+
+		basic_iterator() noexcept : m_Slot(nullptr), m_Last(nullptr) {}
+
+		template<bool C = Const, typename = std::enable_if_t<C>>
+		basic_iterator(const basic_iterator<false>& other) noexcept : m_Slot(other.m_Slot), m_Last(other.m_Last) {}
+
+		reference operator*() const noexcept { return m_Slot->entry; }
+		pointer operator->() const noexcept { return &m_Slot->entry; }
+
+		basic_iterator& operator++() noexcept { ++m_Slot; skip_free_slots(); return *this; }
+		basic_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+
+		friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) noexcept { return lhs.m_Slot == rhs.m_Slot; }
+		friend bool operator!=(const basic_iterator& lhs, const basic_iterator& rhs) noexcept { return lhs.m_Slot != rhs.m_Slot; }
+	};
+
+public:
+	using iterator       = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+private:
+	// Marks the mapping as dirty while the slots are modified. A file left
+	// dirty by a process that died halfway through a change can't be trusted,
+	// so the cache starts empty instead. The signal fences keep the compiler
+	// from moving the writes to the slots outside of the dirty window.
+	class write_guard
+	{
+	private:
+		header* m_Header;
+
+	public:
+		explicit write_guard(header* h) noexcept : m_Header(h) { m_Header->dirty = 1; std::atomic_signal_fence(std::memory_order_seq_cst); }
+		~write_guard() { std::atomic_signal_fence(std::memory_order_seq_cst); m_Header->dirty = 0; }
+	};
+
+	const size_t m_MaxSize;
+	const size_type m_SlotCount;   // Power of two
+	detail::mapped_region m_Region;
+	header* const m_Header;
+	slot* const m_Slots;
+	mutable StatsProvider<Key, Value> m_Stats;
+	mutable Lock m_Lock;
+
+	static const char* magic() noexcept { return "CACHEMAP"; }
+
+	static size_t checked_size(size_t max_size)
+	{
+		if(max_size == 0) throw std::invalid_argument("MappedCache: the maximum size can't be 0");
+		return max_size;
+	}
+
+	// Keep the load factor at or below 3/4 so that probe sequences stay short
+	static size_type slot_count_for(size_type count) noexcept
+	{
+		const size_type min_slots = count + count / 3 + 1;
+
+		size_type slots = 8;
+		while(slots < min_slots) slots *= 2;
+
+		return slots;
+	}
+
+	static constexpr size_type slots_offset() noexcept { return (sizeof(header) + alignof(slot) - 1) / alignof(slot) * alignof(slot); }
+	static constexpr size_type region_size(size_type slots) noexcept { return slots_offset() + slots * sizeof(slot); }
+
+	static std::uint64_t hash(const key_type& key) { return detail::mix(static_cast<std::uint64_t>(std::hash<key_type>{}(key))); }
+
+	size_type mask() const noexcept { return m_SlotCount - 1; }
+	size_type next(size_type index) const noexcept { return (index + 1) & mask(); }
+	size_type home(const key_type& key) const { return static_cast<size_type>(hash(key)) & mask(); }
+
+	void initialize() noexcept
+	{
+		std::memcpy(m_Header->magic, magic(), sizeof(header::magic));
+		m_Header->version = VERSION;
+		m_Header->dirty = 0;
+		m_Header->key_size = sizeof(Key);
+		m_Header->value_size = sizeof(Value);
+		m_Header->slot_size = sizeof(slot);
+		m_Header->slot_count = m_SlotCount;
+		m_Header->max_size = m_MaxSize;
+		m_Header->size = 0;
+		m_Header->hand = 0;
+	}
+
+	// Opens the cache left in a file by a previous run, or sets up a new one
+	void open(const std::string& path)
+	{
+		static const char blank[sizeof(header::magic)] = {};
+
+		if(std::memcmp(m_Header->magic, blank, sizeof(blank)) == 0)
+			return initialize();
+
+		if(std::memcmp(m_Header->magic, magic(), sizeof(header::magic)) != 0 || m_Header->version != VERSION)
+			throw std::runtime_error("MappedCache: " + path + " is not a cache file");
+
+		if(m_Header->key_size != sizeof(Key) || m_Header->value_size != sizeof(Value) || m_Header->slot_size != sizeof(slot))
+			throw std::runtime_error("MappedCache: " + path + " holds entries of a different size");
+
+		if(m_Header->slot_count != m_SlotCount || m_Header->max_size != m_MaxSize)
+			throw std::runtime_error("MappedCache: " + path + " holds a cache of a different size");
+
+		if(m_Header->dirty)
+			reset();
+	}
+
+	void reset() noexcept
+	{
+		for(size_type i = 0; i < m_SlotCount; i++)
+			m_Slots[i].used = m_Slots[i].referenced = 0;
+
+		m_Header->size = 0;
+		m_Header->hand = 0;
+		m_Header->dirty = 0;
+	}
+
+	iterator iterator_at(size_type index) noexcept { return iterator(m_Slots + index, m_Slots + m_SlotCount); }
+
+	// Returns the slot holding `key`, or the free slot where it should go.
+	// There is always a free slot, so probing always stops.
+	size_type probe(const key_type& key) const
+	{
+		size_type i = home(key);
+		while(m_Slots[i].used && !(m_Slots[i].entry.first == key)) i = next(i);
+
+		return i;
+	}
+
+	slot* find_key(const key_type& key) const
+	{
+		slot& s = m_Slots[probe(key)];
+
+		if(s.used)
+		{
+			m_Stats.hit(s.entry.first, s.entry.second);
+			s.referenced = 1;
+			return &s;
+		}
+
+		m_Stats.miss(key);
+		return nullptr;
+	}
+
+	// Removes the entry of a slot, and moves back the entries that follow it
+	// in the same cluster when that brings them closer to their home slot
+	void remove_index(size_type index) noexcept
+	{
+		for(size_type j = next(index); m_Slots[j].used; j = next(j))
+		{
+			// The entry can fill the hole if the hole is between its home
+			// slot and its current slot
+			const size_type h = home(m_Slots[j].entry.first);
+			if(((j - h) & mask()) < ((j - index) & mask())) continue;
+
+			::new(static_cast<void*>(&m_Slots[index].entry)) value_type(m_Slots[j].entry);
+			m_Slots[index].referenced = m_Slots[j].referenced;
+			index = j;
+		}
+
+		m_Slots[index].used = m_Slots[index].referenced = 0;
+		m_Header->size--;
+	}
+
+	// CLOCK: the hand sweeps the slots, clearing the reference bit of every
+	// entry it passes and evicting the first entry whose bit is already clear
+	void evict() noexcept
+	{
+		for(size_type i = static_cast<size_type>(m_Header->hand); ; i = next(i))
+		{
+			slot& s = m_Slots[i];
+
+			if(!s.used) continue;
+			if(s.referenced) { s.referenced = 0; continue; }
+
+			m_Stats.evict(s.entry.first, s.entry.second);
+
+			// The hole may be filled with an entry the hand hasn't seen yet
+			m_Header->hand = i;
+			remove_index(i);
+			return;
+		}
+	}
+
+	// New entries start unreferenced, so an entry that is never read again
+	// is evicted the first time the hand reaches it
+	template<typename... Args>
+	std::pair<iterator, bool> insert_entry(const key_type& key, Args&&... args)
+	{
+		size_type index = probe(key);
+
+		if(m_Slots[index].used)
+		{
+			m_Slots[index].referenced = 1;
+			return { iterator_at(index), false };
+		}
+
+		if(m_Header->size >= m_MaxSize)
+		{
+			evict();
+			index = probe(key);
+		}
+
+		slot& s = m_Slots[index];
+		::new(static_cast<void*>(&s.entry)) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+		s.referenced = 0;
+		s.used = 1;
+		m_Header->size++;
+
+		return { iterator_at(index), true };
+	}
+
+	void erase_index(size_type index) noexcept
+	{
+		m_Stats.erase(m_Slots[index].entry.first, m_Slots[index].entry.second);
+		remove_index(index);
+	}
+
+public:
+	// Anonymous cache of at most `max_size` entries
+	explicit MappedCache(
+		const size_t max_size,
+		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>())
+		: m_MaxSize(checked_size(max_size)), m_SlotCount(slot_count_for(m_MaxSize)), m_Region(region_size(m_SlotCount)),
+		  m_Header(reinterpret_cast<header*>(m_Region.data())), m_Slots(reinterpret_cast<slot*>(m_Region.data() + slots_offset())),
+		  m_Stats(stats), m_Lock()
+	{
+		initialize();
+	}
+
+	// Cache of at most `max_size` entries stored in the file at `path`. If the
+	// file already holds a cache, its entries are kept, but it must have been
+	// created with the same types and maximum size.
+	MappedCache(
+		const std::string& path,
+		const size_t max_size,
+		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>())
+		: m_MaxSize(checked_size(max_size)), m_SlotCount(slot_count_for(m_MaxSize)), m_Region(path, region_size(m_SlotCount)),
+		  m_Header(reinterpret_cast<header*>(m_Region.data())), m_Slots(reinterpret_cast<slot*>(m_Region.data() + slots_offset())),
+		  m_Stats(stats), m_Lock()
+	{
+		open(path);
+	}
+
+	MappedCache(const MappedCache&) = delete;
+	MappedCache& operator=(const MappedCache&) = delete;
+
+	~MappedCache() = default;
+
+	iterator begin() noexcept
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		iterator it = iterator_at(0);
+		it.skip_free_slots();
+		return it;
+	}
+
+	const_iterator begin() const noexcept { return const_cast<MappedCache*>(this)->begin(); }
+	const_iterator cbegin() const noexcept { return begin(); }
+
+	      iterator  end()       noexcept { return iterator_at(m_SlotCount); }
+	const_iterator  end() const noexcept { return const_cast<MappedCache*>(this)->end(); }
+	const_iterator cend() const noexcept { return end(); }
+
+	bool empty() const noexcept { std::lock_guard<Lock> lock(m_Lock); return m_Header->size == 0; }
+
+	size_type size() const noexcept { std::lock_guard<Lock> lock(m_Lock); return static_cast<size_type>(m_Header->size); }
+	constexpr size_type max_size() const noexcept { return m_MaxSize; }
+
+	mapped_type& at(const key_type& key)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		slot* s = find_key(key);
+		if(s == nullptr) throw std::out_of_range("MappedCache::at");
+
+		return s->entry.second;
+	}
+
+	const mapped_type& at(const key_type& key) const { return const_cast<MappedCache*>(this)->at(key); }
+
+	      mapped_type& lookup(const key_type& key)       { return at(key); }
+	const mapped_type& lookup(const key_type& key) const { return at(key); }
+
+	mapped_type& operator[](const key_type& key) { std::lock_guard<Lock> lock(m_Lock); write_guard guard(m_Header); return insert_entry(key).first->second; }
+
+	// Erasing an entry may move the entries that follow it, so the returned
+	// iterator may point to the same slot as `pos`. An erase_if() style loop
+	// still works, although near the end of the table it may visit an entry
+	// that it already visited at the beginning.
+	iterator erase(const_iterator pos)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		write_guard guard(m_Header);
+
+		const size_type index = static_cast<size_type>(pos.m_Slot - m_Slots);
+		erase_index(index);
+
+		iterator next = iterator_at(index);
+		next.skip_free_slots();
+		return next;
+	}
+
+	size_type erase(const key_type& key)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		slot* s = find_key(key);
+
+		if(s == nullptr) return 0;
+
+		write_guard guard(m_Header);
+		erase_index(static_cast<size_type>(s - m_Slots));
+		return 1;
+	}
+
+	template<typename InputIt>
+	void insert(InputIt first, InputIt last)
+	{
+		for(; first != last; ++first)
+			insert(first->first, first->second);
+	}
+
+	void insert(std::initializer_list<value_type> ilist) { insert(ilist.begin(), ilist.end()); }
+	std::pair<iterator, bool> insert(const value_type& val) { return insert(val.first, val.second); }
+
+	std::pair<iterator, bool> insert(const key_type& key, const mapped_type& value)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		write_guard guard(m_Header);
+		return insert_entry(key, value);
+	}
+
+	// Inserts `value` if `key` is not in the cache, or assigns it otherwise
+	std::pair<iterator, bool> insert_or_assign(const key_type& key, const mapped_type& value)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		write_guard guard(m_Header);
+
+		auto pair = insert_entry(key, value);
+		if(pair.second == false) pair.first->second = value;
+
+		return pair;
+	}
+
+	void clear() noexcept
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+
+		reset();
+		m_Stats.clear();
+	}
+
+	void flush() noexcept { clear(); }
+	void flush(const key_type& key) noexcept { erase(key); }
+
+	// Waits until every change is written to the file backing the cache.
+	// Does nothing for anonymous caches.
+	void sync()
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		m_Region.sync();
+	}
+
+	bool   contains(const key_type& key) const { std::lock_guard<Lock> lock(m_Lock); return find_key(key) != nullptr; }
+	size_type count(const key_type& key) const { std::lock_guard<Lock> lock(m_Lock); return find_key(key) != nullptr; }
+
+	iterator find(const key_type& key)
+	{
+		std::lock_guard<Lock> lock(m_Lock);
+		slot* s = find_key(key);
+		return s != nullptr ? iterator(s, m_Slots + m_SlotCount) : end();
+	}
+
+	const_iterator find(const key_type& key) const { return const_cast<MappedCache*>(this)->find(key); }
+
+	const StatsProvider<Key, Value>& stats() const noexcept { return m_Stats; }
+
+	size_type hit_count() const noexcept { return m_Stats.hit_count(); }
+	size_type miss_count() const noexcept { return m_Stats.miss_count(); }
+	size_type access_count() const noexcept { return m_Stats.hit_count() + m_Stats.miss_count(); }
+	size_type entry_invalidation_count() const noexcept { return m_Stats.entry_invalidation_count(); }
+	size_type cache_invalidation_count() const noexcept { return m_Stats.cache_invalidation_count(); }
+	size_type evicted_count() const noexcept { return m_Stats.evicted_count(); }
+
+	float hit_ratio  () const noexcept { return static_cast<float>(hit_count ()) / (static_cast<float>(hit_count() + miss_count())); }
+	float miss_ratio () const noexcept { return static_cast<float>(miss_count()) / (static_cast<float>(hit_count() + miss_count())); }
+	float utilization() const noexcept { return static_cast<float>(size())       /  static_cast<float>(m_MaxSize); }
+};
@@ -0,0 +1,239 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <unordered_map>
+
+namespace Policy
+{
+	// Adaptive Replacement Cache (Megiddo & Modha). Keys seen once live in T1,
+	// keys seen at least twice live in T2. Evicted keys are remembered in the
+	// ghost lists B1 and B2 (which only store the hash of the key), and a hit
+	// on a ghost entry moves the target size of T1 towards the list that would
+	// have kept it, so the policy adapts between recency and frequency.
+	//
+	// The cache asks for a victim before telling the policy which key will be
+	// inserted, so T1 is shrunk whenever it is larger than its target (the
+	// original algorithm also shrinks T1 when it is exactly at its target and
+	// the new key is a ghost of T2). Keys erased by the user are also
+	// remembered as ghosts.
+	template<typename Key>
+	class ARC
+	{
+	private:
+		enum class list_id : unsigned char { t1, t2 };
+
+		struct entry;
+		using storage_type = std::unordered_map<Key, entry>;
+		using node_type = typename storage_type::value_type;
+		using queue_type = std::list<node_type*>;
+
+		struct entry
+		{
+			list_id owner;
+			typename queue_type::iterator position;
+		};
+
+		struct ghost_entry
+		{
+			list_id owner;
+			std::list<std::size_t>::iterator position;
+		};
+
+		queue_type t1, t2;
+		std::list<std::size_t> b1, b2;
+		storage_type key_finder;
+		std::unordered_map<std::size_t, ghost_entry> ghost_finder;
+
+		// Number of keys the cache can hold, set by reserve(). Weighted caches
+		// don't know it, so until reserve() is called it is the largest number
+		// of keys the policy has held so far.
+		std::size_t capacity = 0;
+		bool reserved = false;
+		std::size_t target = 0;
+
+		static std::size_t hash(const Key& key) { return std::hash<Key>{}(key); }
+
+		queue_type& queue(list_id id) { return id == list_id::t1 ? t1 : t2; }
+		std::list<std::size_t>& ghosts(list_id id) { return id == list_id::t1 ? b1 : b2; }
+
+		void push(const Key& key, list_id to)
+		{
+			auto& node = *key_finder.emplace(key, entry{}).first;
+			queue(to).push_front(&node);
+			node.second = entry{ to, queue(to).begin() };
+
+			if(!reserved) capacity = std::max(capacity, key_finder.size());
+		}
+
+		void push_ghost(std::size_t h, list_id to)
+		{
+			auto it = ghost_finder.find(h);
+			if(it != ghost_finder.end())
+			{
+				ghosts(it->second.owner).erase(it->second.position);
+				ghost_finder.erase(it);
+			}
+
+			ghosts(to).push_front(h);
+			ghost_finder.emplace(h, ghost_entry{ to, ghosts(to).begin() });
+		}
+
+		void pop_ghost(list_id from)
+		{
+			ghost_finder.erase(ghosts(from).back());
+			ghosts(from).pop_back();
+		}
+
+		// Keep |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c
+		void trim_ghosts()
+		{
+			while(!b1.empty() && t1.size() + b1.size() > capacity)
+				pop_ghost(list_id::t1);
+
+			while(!b2.empty() && t1.size() + t2.size() + b1.size() + b2.size() > 2 * capacity)
+				pop_ghost(list_id::t2);
+		}
+
+	public:
+		ARC() = default;
+		~ARC() = default;
+
+		ARC(const ARC& other) : capacity(other.capacity), reserved(other.reserved), target(other.target) { copy_from(other); }
+
+		ARC& operator=(const ARC& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				capacity = other.capacity;
+				reserved = other.reserved;
+				target = other.target;
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
+		void reserve(std::size_t max_size) { capacity = max_size; reserved = true; }
+
+		void clear()
+		{
+			t1.clear();
+			t2.clear();
+			b1.clear();
+			b2.clear();
+			key_finder.clear();
+			ghost_finder.clear();
+			target = 0;
+		}
+
+		void insert(const Key& key)
+		{
+			auto ghost = ghost_finder.find(hash(key));
+
+			if(ghost == ghost_finder.end())
+			{
+				push(key, list_id::t1);
+				trim_ghosts();
+				return;
+			}
+
+			// Ghost hit: the key would still be cached if the list it was
+			// evicted from had been bigger, so grow the target of that list
+			if(ghost->second.owner == list_id::t1)
+				target = std::min(capacity, target + std::max<std::size_t>(b2.size() / b1.size(), 1));
+			else
+			{
+				const std::size_t delta = std::max<std::size_t>(b1.size() / b2.size(), 1);
+				target = target > delta ? target - delta : 0;
+			}
+
+			ghosts(ghost->second.owner).erase(ghost->second.position);
+			ghost_finder.erase(ghost);
+
+			push(key, list_id::t2);
+			trim_ghosts();
+		}
+
+		void touch(const Key& key)
+		{
+			auto& node = *key_finder.find(key);
+
+			t2.splice(t2.begin(), queue(node.second.owner), node.second.position);
+			node.second.owner = list_id::t2;
+		}
+
+		void erase(const Key& key)
+		{
+			auto it = key_finder.find(key);
+			const list_id owner = it->second.owner;
+			const std::size_t h = hash(key);
+
+			queue(owner).erase(it->second.position);
+			key_finder.erase(it);
+
+			// Unbounded caches never evict anything, so don't keep ghosts
+			if(capacity != std::numeric_limits<std::size_t>::max())
+			{
+				push_ghost(h, owner);
+				trim_ghosts();
+			}
+		}
+
+		const Key& replace_candidate() const
+		{
+			if(!t1.empty() && (t1.size() > target || t2.empty()))
+				return t1.back()->first;
+
+			return t2.back()->first;
+		}
+
+		// Target size of T1, adapted online
+		std::size_t target_size() const noexcept { return target; }
+
+	private:
+		void copy_from(const ARC& other)
+		{
+			for(auto id : { list_id::t1, list_id::t2 })
+			{
+				const auto& from = id == list_id::t1 ? other.t1 : other.t2;
+				for(auto it = from.rbegin(); it != from.rend(); ++it)
+					push((*it)->first, id);
+
+				const auto& ghosts_from = id == list_id::t1 ? other.b1 : other.b2;
+				for(auto it = ghosts_from.rbegin(); it != ghosts_from.rend(); ++it)
+					push_ghost(*it, id);
+			}
+		}
+	};
+}
@@ -26,6 +26,7 @@
 #pragma once
 
 #include <list>
+#include <unordered_map>
 
 namespace Policy
 {
@@ -34,16 +35,56 @@ namespace Policy
 	{
 	private:
 		std::list<Key> fifo_queue;
+		std::unordered_map<Key, typename std::list<Key>::iterator> key_finder;
+
+		void copy_from(const FIFO& other)
+		{
+			for(const auto& key : other.fifo_queue)
+				key_finder[key] = fifo_queue.insert(fifo_queue.end(), key);
+		}
 
 	public:
 		FIFO() = default;
 		~FIFO() = default;
 
-		void clear() { fifo_queue.clear(); }
-		void insert(const Key& key) { fifo_queue.emplace_front(key); }
-		void touch (const Key& key) { (void)key; }
-		void erase (const Key& key) { key == fifo_queue.back() ? fifo_queue.pop_back() : fifo_queue.remove(key); }
+		FIFO(const FIFO& other) { copy_from(other); }
+
+		FIFO& operator=(const FIFO& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
+		void clear() { fifo_queue.clear(); key_finder.clear(); }
+
+		void insert(const Key& key)
+		{
+			fifo_queue.emplace_front(key);
+			key_finder[key] = fifo_queue.begin();
+		}
+
+		void touch(const Key& key) { (void)key; }
+
+		void erase(const Key& key)
+		{
+			const auto it = key_finder.find(key);
+			fifo_queue.erase(it->second);
+			key_finder.erase(it);
+		}
 
 		const Key& replace_candidate() const { return fifo_queue.back(); }
+
+		// Oldest key first, which is also the eviction order
+		template<typename Fn>
+		void dump(Fn& fn) const
+		{
+			for(auto it = fifo_queue.rbegin(); it != fifo_queue.rend(); ++it)
+				fn(*it, 0);
+		}
 	};
 }
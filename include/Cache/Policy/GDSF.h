@@ -0,0 +1,143 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+
+namespace Policy
+{
+	// Greedy Dual-Size Frequency. Every key has a priority of L + frequency /
+	// weight, and the key with the lowest priority is evicted first. Light and
+	// popular entries are kept over heavy ones, which gives much better hit
+	// ratios than LRU when entry sizes are very different. L starts at 0 and
+	// is raised to the priority of every evicted key, so that entries that are
+	// no longer accessed eventually age out.
+	//
+	// The weight of every key is given by the weigher of the cache. Without a
+	// weigher, all keys weigh 1 and GDSF behaves like an LFU with aging.
+	template<typename Key>
+	class GDSF
+	{
+	private:
+		struct entry;
+		using storage_type = std::unordered_map<Key, entry>;
+		using node_type = typename storage_type::value_type;
+		using queue_type = std::multimap<double, node_type*>;
+
+		struct entry
+		{
+			typename queue_type::iterator position;
+			std::size_t frequency;
+			std::size_t weight;
+		};
+
+		queue_type priority_queue;
+		storage_type gdsf_storage;
+		double inflation = 0.0;
+
+		// Keys with the same priority are evicted in insertion order, since
+		// std::multimap inserts equivalent keys after the existing ones
+		void push(node_type& node)
+		{
+			const double priority = inflation + static_cast<double>(node.second.frequency) / static_cast<double>(node.second.weight);
+			node.second.position = priority_queue.emplace(priority, &node);
+		}
+
+		void copy_from(const GDSF& other)
+		{
+			inflation = other.inflation;
+
+			for(const auto& p : other.priority_queue)
+			{
+				auto& node = *gdsf_storage.emplace(p.second->first, p.second->second).first;
+				node.second.position = priority_queue.emplace_hint(priority_queue.end(), p.first, &node);
+			}
+		}
+
+	public:
+		GDSF() = default;
+		~GDSF() = default;
+
+		GDSF(const GDSF& other) { copy_from(other); }
+
+		GDSF& operator=(const GDSF& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
+		void clear() { priority_queue.clear(); gdsf_storage.clear(); inflation = 0.0; }
+
+		void insert(const Key& key) { insert(key, 1); }
+
+		void insert(const Key& key, std::size_t weight)
+		{
+			auto& node = *gdsf_storage.emplace(key, entry{ {}, 1, weight == 0 ? 1 : weight }).first;
+			push(node);
+		}
+
+		void touch(const Key& key)
+		{
+			auto& node = *gdsf_storage.find(key);
+
+			priority_queue.erase(node.second.position);
+			node.second.frequency++;
+			push(node);
+		}
+
+		// Keeps the frequency of the key, so only its priority changes
+		void update_weight(const Key& key, std::size_t, std::size_t weight)
+		{
+			auto& node = *gdsf_storage.find(key);
+
+			priority_queue.erase(node.second.position);
+			node.second.weight = weight == 0 ? 1 : weight;
+			push(node);
+		}
+
+		// The policy can't tell evictions from erasures, so erasing the key
+		// with the lowest priority raises L as well
+		void erase(const Key& key)
+		{
+			auto it = gdsf_storage.find(key);
+
+			if(it->second.position == priority_queue.begin())
+				inflation = it->second.position->first;
+
+			priority_queue.erase(it->second.position);
+			gdsf_storage.erase(it);
+		}
+
+		const Key& replace_candidate() const { return priority_queue.begin()->second->first; }
+	};
+}
@@ -0,0 +1,162 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+namespace Policy
+{
+	// Replacement policies for IntrusiveCache. Instead of keeping their own copy
+	// of every key (and a hash table to find it again), these policies store
+	// their bookkeeping in a hook embedded in each cache entry. The cache hands
+	// them the hook of the entry, so touching an entry is just a pointer splice.
+	//
+	// An intrusive policy is a plain class with a `hook_type` typedef and the
+	// usual methods, taking and returning hooks instead of keys:
+	//  - void clear()
+	//  - void insert(hook_type&)
+	//  - void touch(hook_type&)
+	//  - void erase(hook_type&)
+	//  - hook_type& replace_candidate()
+	namespace Intrusive
+	{
+		struct list_hook
+		{
+			list_hook* prev = nullptr;
+			list_hook* next = nullptr;
+		};
+
+		// Circular doubly linked list of hooks, with a sentinel node
+		class hook_list
+		{
+		private:
+			list_hook head;
+
+			static void link_after(list_hook& pos, list_hook& node) noexcept
+			{
+				node.prev = &pos;
+				node.next = pos.next;
+				pos.next->prev = &node;
+				pos.next = &node;
+			}
+
+		public:
+			hook_list() noexcept { head.prev = head.next = &head; }
+
+			// Hooks belong to the entries of one particular cache, so copying a
+			// policy (e.g. to pass it to a constructor) gives an empty one
+			hook_list(const hook_list&) noexcept : hook_list() {}
+			hook_list& operator=(const hook_list&) noexcept { clear(); return *this; }
+
+			bool empty() const noexcept { return head.next == &head; }
+
+			void clear() noexcept { head.prev = head.next = &head; }
+
+			void push_front(list_hook& node) noexcept { link_after(head, node); }
+			void push_back (list_hook& node) noexcept { link_after(*head.prev, node); }
+
+			void unlink(list_hook& node) noexcept
+			{
+				node.prev->next = node.next;
+				node.next->prev = node.prev;
+				node.prev = node.next = nullptr;
+			}
+
+			void move_to_front(list_hook& node) noexcept
+			{
+				if(head.next == &node) return;
+
+				unlink(node);
+				push_front(node);
+			}
+
+			list_hook& front() noexcept { return *head.next; }
+			list_hook& back () noexcept { return *head.prev; }
+		};
+
+		class LRU
+		{
+		private:
+			hook_list lru_queue;
+
+		public:
+			using hook_type = list_hook;
+
+			void clear() noexcept { lru_queue.clear(); }
+			void insert(hook_type& node) noexcept { lru_queue.push_front(node); }
+			void touch (hook_type& node) noexcept { lru_queue.move_to_front(node); }
+			void erase (hook_type& node) noexcept { lru_queue.unlink(node); }
+
+			hook_type& replace_candidate() noexcept { return lru_queue.back(); }
+		};
+
+		class MRU
+		{
+		private:
+			hook_list mru_queue;
+
+		public:
+			using hook_type = list_hook;
+
+			void clear() noexcept { mru_queue.clear(); }
+			void insert(hook_type& node) noexcept { mru_queue.push_front(node); }
+			void touch (hook_type& node) noexcept { mru_queue.move_to_front(node); }
+			void erase (hook_type& node) noexcept { mru_queue.unlink(node); }
+
+			hook_type& replace_candidate() noexcept { return mru_queue.front(); }
+		};
+
+		class FIFO
+		{
+		private:
+			hook_list fifo_queue;
+
+		public:
+			using hook_type = list_hook;
+
+			void clear() noexcept { fifo_queue.clear(); }
+			void insert(hook_type& node) noexcept { fifo_queue.push_front(node); }
+			void touch (hook_type&)      noexcept {}
+			void erase (hook_type& node) noexcept { fifo_queue.unlink(node); }
+
+			hook_type& replace_candidate() noexcept { return fifo_queue.back(); }
+		};
+
+		class LIFO
+		{
+		private:
+			hook_list lifo_queue;
+
+		public:
+			using hook_type = list_hook;
+
+			void clear() noexcept { lifo_queue.clear(); }
+			void insert(hook_type& node) noexcept { lifo_queue.push_front(node); }
+			void touch (hook_type&)      noexcept {}
+			void erase (hook_type& node) noexcept { lifo_queue.unlink(node); }
+
+			hook_type& replace_candidate() noexcept { return lifo_queue.front(); }
+		};
+	}
+}
@@ -26,46 +26,186 @@
 #pragma once
 
 #include <cstddef>
-#include <map>
-#include <memory>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <stdexcept>
 #include <unordered_map>
 
 namespace Policy
 {
+	// O(1) LFU: keys are grouped in buckets of equal frequency, and buckets are
+	// kept in a list sorted by ascending frequency. Touching a key just moves it
+	// to the neighbouring bucket. Within a bucket, the oldest key is evicted first.
+	//
+	// If `aging_period` is not zero, every `aging_period` calls to touch() all
+	// frequencies are halved, so keys that were popular a long time ago are
+	// eventually evicted. Aging costs O(n), so `aging_period` should be at least
+	// as big as the cache to keep touch() amortized O(1).
 	template<typename Key>
 	class LFU
 	{
 	private:
-		std::multimap<std::size_t, Key> frequency_storage;
-		std::unordered_map<Key, typename std::multimap<std::size_t, Key>::iterator> lfu_storage;
+		struct entry;
+		using storage_type = std::unordered_map<Key, entry>;
+		using node_type = typename storage_type::value_type;
+
+		struct bucket
+		{
+			std::size_t frequency;
+			std::list<node_type*> nodes;
+		};
+
+		using bucket_iterator = typename std::list<bucket>::iterator;
+
+		struct entry
+		{
+			bucket_iterator owner;
+			typename std::list<node_type*>::iterator position;
+		};
+
+		std::list<bucket> frequency_storage;
+		storage_type lfu_storage;
+		std::size_t aging_period = 0;
+		std::size_t touch_count = 0;
+
+		void push(node_type& node, bucket_iterator hint, std::size_t frequency)
+		{
+			if(hint == frequency_storage.end() || hint->frequency != frequency)
+				hint = frequency_storage.insert(hint, bucket{ frequency, {} });
+
+			hint->nodes.push_back(&node);
+			node.second = entry{ hint, std::prev(hint->nodes.end()) };
+		}
+
+		void age()
+		{
+			for(auto it = frequency_storage.begin(); it != frequency_storage.end();)
+			{
+				it->frequency = it->frequency > 1 ? it->frequency / 2 : 1;
+
+				// Halving keeps buckets sorted, but a bucket may now have the same
+				// frequency as the previous one. If so, merge them.
+				if(it != frequency_storage.begin() && std::prev(it)->frequency == it->frequency)
+				{
+					auto prev = std::prev(it);
+
+					for(node_type* node : it->nodes)
+						node->second.owner = prev;
+
+					prev->nodes.splice(prev->nodes.end(), it->nodes);
+					it = frequency_storage.erase(it);
+				}
+				else
+					++it;
+			}
+		}
 
 	public:
-		LFU() = default;
+		explicit LFU(std::size_t period = 0) : aging_period(period) {}
 		~LFU() = default;
 
+		LFU(const LFU& other) : aging_period(other.aging_period), touch_count(other.touch_count) { copy_from(other); }
+
+		LFU& operator=(const LFU& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				aging_period = other.aging_period;
+				touch_count = other.touch_count;
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
 		void clear() { frequency_storage.clear(); lfu_storage.clear(); }
 
 		void insert(const Key& key)
 		{
-			constexpr size_t INITIAL_VALUE = 1;
-			lfu_storage[key] = frequency_storage.emplace_hint(frequency_storage.begin(), INITIAL_VALUE, key);
+			constexpr std::size_t INITIAL_VALUE = 1;
+
+			auto& node = *lfu_storage.emplace(key, entry{}).first;
+			push(node, frequency_storage.begin(), INITIAL_VALUE);
 		}
 
 		void touch(const Key& key)
 		{
-			auto elem_for_update = lfu_storage[key];
-			auto updated_elem = std::make_pair(elem_for_update->first + 1, elem_for_update->second);
+			auto& node = *lfu_storage.find(key);
+			auto current = node.second.owner;
+			auto next = std::next(current);
+
+			if(next == frequency_storage.end() || next->frequency != current->frequency + 1)
+				next = frequency_storage.insert(next, bucket{ current->frequency + 1, {} });
+
+			next->nodes.splice(next->nodes.end(), current->nodes, node.second.position);
+			node.second.owner = next;
 
-			frequency_storage.erase(elem_for_update);
-			lfu_storage[key] = frequency_storage.emplace_hint(frequency_storage.end(), std::move(updated_elem));
+			if(current->nodes.empty()) frequency_storage.erase(current);
+
+			if(aging_period != 0 && ++touch_count >= aging_period)
+			{
+				touch_count = 0;
+				age();
+			}
 		}
 
 		void erase(const Key& key)
 		{
-			frequency_storage.erase(lfu_storage[key]);
-			lfu_storage.erase(key);
+			auto it = lfu_storage.find(key);
+			auto owner = it->second.owner;
+
+			owner->nodes.erase(it->second.position);
+			if(owner->nodes.empty()) frequency_storage.erase(owner);
+
+			lfu_storage.erase(it);
+		}
+
+		const Key& replace_candidate() const { return frequency_storage.front().nodes.front()->first; }
+
+		// Keys are dumped from the lowest to the highest frequency, and restored
+		// at the end of the bucket of their frequency. Restoring them in any
+		// other order throws std::runtime_error.
+		template<typename Fn>
+		void dump(Fn& fn) const
+		{
+			for(const auto& b : frequency_storage)
+				for(const node_type* node : b.nodes)
+					fn(node->first, static_cast<std::uint64_t>(b.frequency));
 		}
 
-		const Key& replace_candidate() const { return frequency_storage.begin()->second; }
+		void restore(const Key& key, std::uint64_t frequency)
+		{
+			const std::size_t freq = frequency == 0 ? 1 : static_cast<std::size_t>(frequency);
+			auto hint = frequency_storage.end();
+
+			// Keys come sorted by frequency, so their bucket is always the last
+			// one. Anything else would leave the buckets unsorted.
+			if(!frequency_storage.empty() && frequency_storage.back().frequency > freq)
+				throw std::runtime_error("Cache::load(): LFU frequencies are not sorted");
+
+			if(!frequency_storage.empty() && frequency_storage.back().frequency == freq)
+				hint = std::prev(hint);
+
+			auto& node = *lfu_storage.emplace(key, entry{}).first;
+			push(node, hint, freq);
+		}
+
+	private:
+		void copy_from(const LFU& other)
+		{
+			for(const auto& b : other.frequency_storage)
+			{
+				auto owner = frequency_storage.insert(frequency_storage.end(), bucket{ b.frequency, {} });
+
+				for(const node_type* n : b.nodes)
+				{
+					auto& node = *lfu_storage.emplace(n->first, entry{}).first;
+					owner->nodes.push_back(&node);
+					node.second = entry{ owner, std::prev(owner->nodes.end()) };
+				}
+			}
+		}
 	};
 }
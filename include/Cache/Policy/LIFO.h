@@ -26,6 +26,7 @@
 #pragma once
 
 #include <list>
+#include <unordered_map>
 
 namespace Policy
 {
@@ -34,16 +35,56 @@ namespace Policy
 	{
 	private:
 		std::list<Key> lifo_queue;
+		std::unordered_map<Key, typename std::list<Key>::iterator> key_finder;
+
+		void copy_from(const LIFO& other)
+		{
+			for(const auto& key : other.lifo_queue)
+				key_finder[key] = lifo_queue.insert(lifo_queue.end(), key);
+		}
 
 	public:
 		LIFO() = default;
 		~LIFO() = default;
 
-		void clear() { lifo_queue.clear(); }
-		void insert(const Key& key) { lifo_queue.emplace_front(key); }
-		void touch (const Key& key) { (void)key; }
-		void erase (const Key& key) { key == lifo_queue.front() ? lifo_queue.pop_front() : lifo_queue.remove(key); }
+		LIFO(const LIFO& other) { copy_from(other); }
+
+		LIFO& operator=(const LIFO& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
+		void clear() { lifo_queue.clear(); key_finder.clear(); }
+
+		void insert(const Key& key)
+		{
+			lifo_queue.emplace_front(key);
+			key_finder[key] = lifo_queue.begin();
+		}
+
+		void touch(const Key& key) { (void)key; }
+
+		void erase(const Key& key)
+		{
+			const auto it = key_finder.find(key);
+			lifo_queue.erase(it->second);
+			key_finder.erase(it);
+		}
 
 		const Key& replace_candidate() const { return lifo_queue.front(); }
+
+		// Oldest key first, so that the newest key ends up on top of the stack
+		template<typename Fn>
+		void dump(Fn& fn) const
+		{
+			for(auto it = lifo_queue.rbegin(); it != lifo_queue.rend(); ++it)
+				fn(*it, 0);
+		}
 	};
 }
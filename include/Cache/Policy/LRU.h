@@ -37,10 +37,29 @@ namespace Policy
 		std::list<Key> lru_queue;
 		std::unordered_map<Key, typename std::list<Key>::iterator> key_finder;
 
+		void copy_from(const LRU& other)
+		{
+			for(const auto& key : other.lru_queue)
+				key_finder[key] = lru_queue.insert(lru_queue.end(), key);
+		}
+
 	public:
 		LRU() = default;
 		~LRU() = default;
 
+		LRU(const LRU& other) { copy_from(other); }
+
+		LRU& operator=(const LRU& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
 		void clear() { lru_queue.clear(); key_finder.clear(); }
 
 		void insert(const Key& key)
@@ -58,5 +77,14 @@ namespace Policy
 		}
 
 		const Key& replace_candidate() const { return lru_queue.back(); }
+
+		// Least recently used key first, so that inserting the keys again in
+		// the same order rebuilds the same queue
+		template<typename Fn>
+		void dump(Fn& fn) const
+		{
+			for(auto it = lru_queue.rbegin(); it != lru_queue.rend(); ++it)
+				fn(*it, 0);
+		}
 	};
 }
@@ -37,10 +37,29 @@ namespace Policy
 		std::list<Key> mru_queue;
 		std::unordered_map<Key, typename std::list<Key>::iterator> key_finder;
 
+		void copy_from(const MRU& other)
+		{
+			for(const auto& key : other.mru_queue)
+				key_finder[key] = mru_queue.insert(mru_queue.end(), key);
+		}
+
 	public:
 		MRU() = default;
 		~MRU() = default;
 
+		MRU(const MRU& other) { copy_from(other); }
+
+		MRU& operator=(const MRU& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
 		void clear() { mru_queue.clear(); key_finder.clear(); }
 
 		void insert(const Key& key)
@@ -58,5 +77,14 @@ namespace Policy
 		}
 
 		const Key& replace_candidate() const { return mru_queue.front(); }
+
+		// Least recently used key first. Inserting them again in this order
+		// leaves the most recently used key at the front, ready to be evicted.
+		template<typename Fn>
+		void dump(Fn& fn) const
+		{
+			for(auto it = mru_queue.rbegin(); it != mru_queue.rend(); ++it)
+				fn(*it, 0);
+		}
 	};
 }
@@ -25,38 +25,63 @@
 
 #pragma once
 
-#include <iterator>
-#include <list>
+#include <cstddef>
+#include <cstdint>
 #include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "../detail/random.h"
 
 namespace Policy
 {
+	// Keys are stored contiguously, so a random candidate is just a random
+	// index. Erasing a key moves the last one into its place, which keeps every
+	// operation O(1).
 	template<typename Key>
 	class Random
 	{
 	private:
-		std::list<Key> key_storage;
+		std::vector<Key> key_storage;
+		std::unordered_map<Key, std::size_t> key_finder;
+		mutable detail::wyrand gen;
 
-		template<typename Iterator>
-		Iterator select_randomly(Iterator begin, size_t size) const
+		static std::uint64_t random_seed()
 		{
-			static std::random_device rd;
-			static std::mt19937 gen(rd());
-			static std::uniform_int_distribution<long> distrib(0, static_cast<long>(size) - 1);
-
-			std::advance(begin, distrib(gen));
-			return begin;
+			std::random_device rd;
+			return (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
 		}
 
 	public:
-		Random() = default;
+		Random() : gen(random_seed()) {}
+		explicit Random(std::uint64_t seed) : gen(seed) {}
 		~Random() = default;
 
-		void clear() { key_storage.clear(); }
-		void insert(const Key& key) { key_storage.emplace_back(key); }
-		void touch (const Key& key) { (void)key; }
-		void erase (const Key& key) { key_storage.remove(key); }
+		void clear() { key_storage.clear(); key_finder.clear(); }
+
+		void insert(const Key& key)
+		{
+			key_finder[key] = key_storage.size();
+			key_storage.emplace_back(key);
+		}
+
+		void touch(const Key& key) { (void)key; }
+
+		void erase(const Key& key)
+		{
+			const auto it = key_finder.find(key);
+			const std::size_t index = it->second;
+			key_finder.erase(it);
+
+			if(index != key_storage.size() - 1)
+			{
+				key_storage[index] = std::move(key_storage.back());
+				key_finder[key_storage[index]] = index;
+			}
+
+			key_storage.pop_back();
+		}
 
-		const Key& replace_candidate() const { return *select_randomly(key_storage.begin(), key_storage.size()); }
+		const Key& replace_candidate() const { return key_storage[static_cast<std::size_t>(gen(key_storage.size()))]; }
 	};
 }
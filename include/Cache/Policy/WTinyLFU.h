@@ -0,0 +1,266 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+
+#include "../detail/frequency_sketch.h"
+
+namespace Policy
+{
+	// W-TinyLFU: new keys enter a small LRU admission window. Keys pushed out
+	// of the window compete against the victim of the main cache (a segmented
+	// LRU with probation and protected segments), and the one with the lowest
+	// estimated frequency is evicted. Frequencies are estimated with a compact
+	// count-min sketch, so one-off scans can't flush the hot working set.
+	//
+	// `window_ratio` is the fraction of the cache used by the window. With a
+	// ratio of 0 there is no window, and the policy rejects the insertion of
+	// new keys that are less popular than the key they would replace.
+	template<typename Key>
+	class WTinyLFU
+	{
+	private:
+		enum class segment : unsigned char { window, probation, protect };
+
+		struct entry;
+		using storage_type = std::unordered_map<Key, entry>;
+		using node_type = typename storage_type::value_type;
+		using queue_type = std::list<node_type*>;
+
+		struct entry
+		{
+			segment owner;
+			typename queue_type::iterator position;
+		};
+
+		queue_type window_queue;
+		queue_type probation_queue;
+		queue_type protected_queue;
+		storage_type key_finder;
+		detail::frequency_sketch sketch;
+
+		float window_ratio;
+		std::size_t window_capacity = 0;
+		std::size_t protected_capacity = 0;
+
+		// Number of keys the cache can hold, set by reserve(). Weighted caches
+		// don't know it, so until reserve() is called it is the largest number
+		// of keys the policy has held so far.
+		std::size_t capacity = 0;
+		bool reserved = false;
+
+		static std::size_t hash(const Key& key) { return std::hash<Key>{}(key); }
+		unsigned frequency(const Key& key) const { return sketch.frequency(hash(key)); }
+
+		queue_type& queue(segment s)
+		{
+			switch(s)
+			{
+				case segment::window: return window_queue;
+				case segment::probation: return probation_queue;
+				default: return protected_queue;
+			}
+		}
+
+		const queue_type& queue(segment s) const { return const_cast<WTinyLFU*>(this)->queue(s); }
+
+		void push(node_type& node, segment to)
+		{
+			queue(to).push_front(&node);
+			node.second = entry{ to, queue(to).begin() };
+		}
+
+		void move(node_type& node, segment to)
+		{
+			queue(to).splice(queue(to).begin(), queue(node.second.owner), node.second.position);
+			node.second.owner = to;
+		}
+
+		void resize(std::size_t max_size)
+		{
+			capacity = max_size;
+			window_capacity = 0;
+
+			if(window_ratio > 0.0f)
+			{
+				const auto window = static_cast<std::size_t>(static_cast<double>(max_size) * static_cast<double>(window_ratio));
+				window_capacity = window == 0 ? 1 : window;
+			}
+
+			const std::size_t main_capacity = max_size - window_capacity;
+			protected_capacity = main_capacity - main_capacity / 5;
+		}
+
+	public:
+		explicit WTinyLFU(float ratio = 0.01f) : window_ratio(ratio) {}
+		~WTinyLFU() = default;
+
+		WTinyLFU(const WTinyLFU& other)
+			: sketch(other.sketch), window_ratio(other.window_ratio), window_capacity(other.window_capacity), protected_capacity(other.protected_capacity), capacity(other.capacity), reserved(other.reserved)
+		{
+			copy_from(other);
+		}
+
+		WTinyLFU& operator=(const WTinyLFU& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				sketch = other.sketch;
+				window_ratio = other.window_ratio;
+				window_capacity = other.window_capacity;
+				protected_capacity = other.protected_capacity;
+				capacity = other.capacity;
+				reserved = other.reserved;
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
+		void reserve(std::size_t max_size)
+		{
+			resize(max_size);
+			reserved = true;
+		}
+
+		void clear()
+		{
+			window_queue.clear();
+			probation_queue.clear();
+			protected_queue.clear();
+			key_finder.clear();
+		}
+
+		void insert(const Key& key)
+		{
+			auto& node = *key_finder.emplace(key, entry{}).first;
+
+			if(!reserved && key_finder.size() > capacity)
+			{
+				resize(key_finder.size());
+
+				// Give the room the protected segment just gained back to the
+				// keys that have waited longest in probation, which are usually
+				// the ones it demoted while it was smaller
+				while(protected_queue.size() < protected_capacity && !probation_queue.empty())
+					move(*probation_queue.back(), segment::protect);
+			}
+
+			sketch.ensure_capacity(key_finder.size());
+			sketch.increment(hash(key));
+
+			if(window_capacity == 0)
+				push(node, segment::probation);
+			else
+			{
+				push(node, segment::window);
+
+				if(window_queue.size() > window_capacity)
+					move(*window_queue.back(), segment::probation);
+			}
+		}
+
+		void touch(const Key& key)
+		{
+			sketch.increment(hash(key));
+			auto& node = *key_finder.find(key);
+
+			switch(node.second.owner)
+			{
+				case segment::window:
+					move(node, segment::window);
+					break;
+
+				case segment::probation:
+					move(node, segment::protect);
+
+					if(protected_queue.size() > protected_capacity)
+						move(*protected_queue.back(), segment::probation);
+					break;
+
+				case segment::protect:
+					move(node, segment::protect);
+					break;
+			}
+		}
+
+		void erase(const Key& key)
+		{
+			auto it = key_finder.find(key);
+
+			queue(it->second.owner).erase(it->second.position);
+			key_finder.erase(it);
+		}
+
+		const Key& replace_candidate() const
+		{
+			const node_type* main_victim =
+				!probation_queue.empty() ? probation_queue.back() :
+				!protected_queue.empty() ? protected_queue.back() : nullptr;
+
+			// The window only gives up a key if the new one will not fit in it
+			const node_type* window_victim = !window_queue.empty() && window_queue.size() >= window_capacity ? window_queue.back() : nullptr;
+
+			if(window_victim == nullptr) return main_victim != nullptr ? main_victim->first : window_queue.back()->first;
+			if(main_victim == nullptr) return window_victim->first;
+
+			return frequency(window_victim->first) > frequency(main_victim->first) ? main_victim->first : window_victim->first;
+		}
+
+		bool admit(const Key& candidate, const Key& victim)
+		{
+			// With a window, new keys are always admitted and the window itself
+			// decides which keys make it into the main cache
+			if(window_capacity != 0) return true;
+
+			// insert() will record this access if the candidate is admitted
+			if(frequency(candidate) + 1 > frequency(victim)) return true;
+
+			sketch.increment(hash(candidate));
+			return false;
+		}
+
+	private:
+		void copy_from(const WTinyLFU& other)
+		{
+			for(auto s : { segment::window, segment::probation, segment::protect })
+			{
+				for(const node_type* n : other.queue(s))
+				{
+					auto& node = *key_finder.emplace(n->first, entry{}).first;
+					queue(s).push_back(&node);
+					node.second = entry{ s, std::prev(queue(s).end()) };
+				}
+			}
+		}
+	};
+}
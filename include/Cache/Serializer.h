@@ -0,0 +1,97 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+// Customization point used by Cache::save() and Cache::load() to write keys
+// and values to a snapshot and read them back. Specialize it for your own types
+// (or pass your own serializers to save() and load()) with:
+//
+//  - static void write(std::ostream& os, const T& value)
+//  - static T read(std::istream& is)
+//
+// read() does not need to check for errors: the cache checks the state of the
+// stream after reading every entry.
+template<typename T, typename = void>
+struct Serializer;
+
+// Arithmetic and enum types are written as they are in memory, so snapshots
+// can only be loaded on machines with the same endianness
+template<typename T>
+struct Serializer<T, std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value>>
+{
+	static void write(std::ostream& os, const T& value) { os.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+	static T read(std::istream& is)
+	{
+		T value{};
+		is.read(reinterpret_cast<char*>(&value), sizeof(T));
+
+		return value;
+	}
+};
+
+// Strings are written as their length followed by their characters
+template<typename Char, typename Traits, typename Allocator>
+struct Serializer<std::basic_string<Char, Traits, Allocator>>
+{
+	using string_type = std::basic_string<Char, Traits, Allocator>;
+
+	static void write(std::ostream& os, const string_type& str)
+	{
+		Serializer<std::uint64_t>::write(os, static_cast<std::uint64_t>(str.size()));
+		os.write(reinterpret_cast<const char*>(str.data()), static_cast<std::streamsize>(str.size() * sizeof(Char)));
+	}
+
+	static string_type read(std::istream& is)
+	{
+		const std::uint64_t size = Serializer<std::uint64_t>::read(is);
+		string_type str;
+
+		// Read in chunks, so that a corrupted size can't make us allocate a
+		// huge string before finding out that the stream is too short
+		constexpr std::uint64_t CHUNK_SIZE = 4096;
+		Char chunk[CHUNK_SIZE];
+
+		for(std::uint64_t left = size; left > 0;)
+		{
+			const std::uint64_t count = left < CHUNK_SIZE ? left : CHUNK_SIZE;
+			is.read(reinterpret_cast<char*>(chunk), static_cast<std::streamsize>(count * sizeof(Char)));
+
+			// A short read only fills part of the chunk
+			str.append(chunk, static_cast<std::size_t>(is.gcount()) / sizeof(Char));
+			if(!is) break;
+
+			left -= count;
+		}
+
+		return str;
+	}
+};
@@ -0,0 +1,278 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Cache.h"
+
+// A cache that hash-partitions its keys across several independent `Cache`
+// shards. Every shard has its own replacement policy, statistics and lock, so
+// threads working on different shards never contend with each other.
+template<
+	typename Key,                                                 // Key type
+	typename Value,                                               // Value type
+	template<typename> class CachePolicy = Policy::Random,        // Cache policy (one instance per shard)
+	typename Lock = std::mutex,                                   // Lock type (one instance per shard)
+	template<typename...> class StatsProvider = Stats::Basic,     // Statistics measurement object (one instance per shard)
+	template<typename...> class StorageType = std::unordered_map, // Underlying key-value storage (one instance per shard)
+	typename Weigher = UnitWeigher,                               // Weight of each entry
+	typename Clock = std::chrono::steady_clock                    // Clock used to expire entries
+>
+class ShardedCache
+{
+public:
+	using shard_type      = Cache<Key, Value, CachePolicy, Lock, StatsProvider, StorageType, Weigher, Clock>;
+	using key_type        = typename shard_type::key_type;
+	using mapped_type     = typename shard_type::mapped_type;
+	using value_type      = typename shard_type::value_type;
+	using iterator        = typename shard_type::iterator;
+	using size_type       = typename shard_type::size_type;
+	using duration        = typename shard_type::duration;
+
+private:
+	const size_t m_MaxSize;
+	unsigned m_ShardBits;
+	std::vector<std::unique_ptr<shard_type>> m_Shards;
+
+	static unsigned shard_bits(size_t shard_count, size_t max_size) noexcept
+	{
+		if(max_size != 0 && shard_count > max_size) shard_count = max_size;
+
+		unsigned bits = 0;
+		while((size_t{1} << bits) < shard_count) bits++;
+
+		// Rounding up could give us more shards than entries
+		if(max_size != 0 && (size_t{1} << bits) > max_size && bits > 0) bits--;
+
+		return bits;
+	}
+
+	size_t shard_index(const key_type& key) const noexcept
+	{
+		if(m_ShardBits == 0) return 0;
+
+		// Fibonacci hashing: take the top bits of the product so that shards
+		// do not correlate with the low bits used by each shard's own buckets
+		const std::uint64_t hash = static_cast<std::uint64_t>(std::hash<key_type>{}(key));
+		return static_cast<size_t>((hash * 0x9E3779B97F4A7C15ULL) >> (64 - m_ShardBits));
+	}
+
+	size_t shard_max_size(size_t index) const noexcept
+	{
+		if(m_MaxSize == 0) return 0;
+
+		const size_t count = size_t{1} << m_ShardBits;
+		return m_MaxSize / count + (index < m_MaxSize % count ? 1 : 0);
+	}
+
+public:
+	static size_t default_shard_count() noexcept
+	{
+		const size_t threads = std::thread::hardware_concurrency();
+		return threads == 0 ? 8 : 4 * threads;
+	}
+
+	ShardedCache(
+		const size_t max_size,
+		const size_t shard_count = default_shard_count(),
+		const CachePolicy<Key>& policy = CachePolicy<Key>(),
+		const StatsProvider<Key, Value>& stats = StatsProvider<Key, Value>(),
+		const Weigher& weigher = Weigher())
+		: m_MaxSize(max_size), m_ShardBits(shard_bits(shard_count == 0 ? 1 : shard_count, max_size))
+	{
+		m_Shards.reserve(size_t{1} << m_ShardBits);
+
+		for(size_t i = 0; i < (size_t{1} << m_ShardBits); i++)
+			m_Shards.emplace_back(new shard_type(shard_max_size(i), policy, stats, weigher));
+	}
+
+	ShardedCache(const ShardedCache& other)
+		: m_MaxSize(other.m_MaxSize), m_ShardBits(other.m_ShardBits)
+	{
+		m_Shards.reserve(other.m_Shards.size());
+
+		for(const auto& shard : other.m_Shards)
+			m_Shards.emplace_back(new shard_type(*shard));
+	}
+
+	~ShardedCache() = default;
+
+	bool empty() const noexcept
+	{
+		return std::all_of(m_Shards.begin(), m_Shards.end(), [](const std::unique_ptr<shard_type>& s) { return s->empty(); });
+	}
+
+	size_type size() const noexcept { return sum([](const shard_type& s) { return s.size(); }); }
+	constexpr size_type max_size() const noexcept { return m_MaxSize == 0 ? std::numeric_limits<size_t>::max() : m_MaxSize; }
+
+	// The maximum weight is split evenly across all shards, so a single entry
+	// can't weigh more than max_size() / shard_count()
+	size_type weight() const noexcept { return sum([](const shard_type& s) { return s.weight(); }); }
+
+	size_type shard_count() const noexcept { return m_Shards.size(); }
+
+	      shard_type& shard(size_type index)       { return *m_Shards[index]; }
+	const shard_type& shard(size_type index) const { return *m_Shards[index]; }
+
+	      shard_type& shard_for(const key_type& key)       { return *m_Shards[shard_index(key)]; }
+	const shard_type& shard_for(const key_type& key) const { return *m_Shards[shard_index(key)]; }
+
+	      mapped_type& at(const key_type& key)       { return shard_for(key).at(key); }
+	const mapped_type& at(const key_type& key) const { return shard_for(key).at(key); }
+
+	      mapped_type& lookup(const key_type& key)       { return at(key); }
+	const mapped_type& lookup(const key_type& key) const { return at(key); }
+
+	mapped_type& operator[](const key_type&  key) { return shard_for(key)[key]; }
+	mapped_type& operator[](      key_type&& key) { auto& s = shard_for(key); return s[std::move(key)]; }
+
+	size_type erase(const key_type& key) { return shard_for(key).erase(key); }
+
+	template<typename... Args>
+	std::pair<iterator, bool> emplace(const key_type& key, Args&&... args)
+	{
+		return shard_for(key).emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+	}
+
+	template<typename... Args>
+	std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) { return shard_for(key).try_emplace(key, std::forward<Args>(args)...); }
+
+	template<typename... Args>
+	std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) { auto& s = shard_for(key); return s.try_emplace(std::move(key), std::forward<Args>(args)...); }
+
+	template<typename M>
+	std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value) { return shard_for(key).insert_or_assign(key, std::forward<M>(value)); }
+
+	template<typename M>
+	std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value) { auto& s = shard_for(key); return s.insert_or_assign(std::move(key), std::forward<M>(value)); }
+
+	template<typename Factory>
+	mapped_type& get_or_insert_with(const key_type& key, Factory&& factory) { return shard_for(key).get_or_insert_with(key, std::forward<Factory>(factory)); }
+
+	template<typename Factory>
+	mapped_type& get_or_insert_with(key_type&& key, Factory&& factory) { auto& s = shard_for(key); return s.get_or_insert_with(std::move(key), std::forward<Factory>(factory)); }
+
+	template<typename InputIt>
+	void insert(InputIt first, InputIt last)
+	{
+		for(; first != last; ++first)
+			insert(first->first, first->second);
+	}
+
+	void insert(std::initializer_list<value_type> ilist) { insert(ilist.begin(), ilist.end()); }
+	std::pair<iterator, bool> insert(const value_type&  val) { return insert(val.first, val.second); }
+	std::pair<iterator, bool> insert(      value_type&& val) { return insert(val.first, std::move(val.second)); }
+
+	std::pair<iterator, bool> insert(const key_type&  key, const mapped_type&  value) noexcept { return shard_for(key).insert(key, value); }
+	std::pair<iterator, bool> insert(const key_type&  key,       mapped_type&& value) noexcept { return shard_for(key).insert(key, std::move(value)); }
+	std::pair<iterator, bool> insert(      key_type&& key, const mapped_type&  value) noexcept { auto& s = shard_for(key); return s.insert(std::move(key), value); }
+	std::pair<iterator, bool> insert(      key_type&& key,       mapped_type&& value) noexcept { auto& s = shard_for(key); return s.insert(std::move(key), std::move(value)); }
+
+	std::pair<iterator, bool> insert(const key_type& key, const mapped_type& value, duration ttl) { return shard_for(key).insert(key, value, ttl); }
+	std::pair<iterator, bool> insert(key_type&& key, mapped_type&& value, duration ttl) { auto& s = shard_for(key); return s.insert(std::move(key), std::move(value), ttl); }
+
+	void set_default_ttl(duration ttl)
+	{
+		for(auto& shard : m_Shards)
+			shard->set_default_ttl(ttl);
+	}
+
+	duration default_ttl() const { return m_Shards.front()->default_ttl(); }
+
+	bool set_ttl(const key_type& key, duration ttl) { return shard_for(key).set_ttl(key, ttl); }
+
+	size_type purge_expired()
+	{
+		size_type count = 0;
+		for(auto& shard : m_Shards)
+			count += shard->purge_expired();
+
+		return count;
+	}
+
+	void clear() noexcept
+	{
+		for(auto& shard : m_Shards)
+			shard->clear();
+	}
+
+	void flush() noexcept { clear(); }
+	void flush(const key_type& key) noexcept { erase(key); }
+
+	bool   contains(const key_type& key) const { return shard_for(key).contains(key); }
+	size_type count(const key_type& key) const { return shard_for(key).count(key); }
+
+	bool try_get(const key_type& key, mapped_type& value) const { return shard_for(key).try_get(key, value); }
+
+	// Statistics are aggregated over all shards. Since every shard is locked
+	// independently, the result is not an atomic snapshot of the whole cache.
+	size_type hit_count() const noexcept { return sum([](const shard_type& s) { return s.hit_count(); }); }
+	size_type miss_count() const noexcept { return sum([](const shard_type& s) { return s.miss_count(); }); }
+	size_type access_count() const noexcept { return hit_count() + miss_count(); }
+	size_type entry_invalidation_count() const noexcept { return sum([](const shard_type& s) { return s.entry_invalidation_count(); }); }
+	size_type evicted_count() const noexcept { return sum([](const shard_type& s) { return s.evicted_count(); }); }
+	size_type expired_count() const noexcept { return sum([](const shard_type& s) { return s.expired_count(); }); }
+
+	// A call to clear() invalidates every shard once, so report the count of
+	// the most invalidated shard instead of the sum of all of them
+	size_type cache_invalidation_count() const noexcept
+	{
+		size_type count = 0;
+		for(const auto& shard : m_Shards)
+			count = std::max(count, shard->cache_invalidation_count());
+
+		return count;
+	}
+
+	float hit_ratio  () const noexcept { return static_cast<float>(hit_count ()) / (static_cast<float>(hit_count() + miss_count())); }
+	float miss_ratio () const noexcept { return static_cast<float>(miss_count()) / (static_cast<float>(hit_count() + miss_count())); }
+	float utilization() const noexcept { return static_cast<float>(weight())     /  static_cast<float>(max_size()); }
+
+private:
+	template<typename Getter>
+	size_type sum(Getter getter) const noexcept
+	{
+		size_type total = 0;
+		for(const auto& shard : m_Shards)
+			total += getter(*shard);
+
+		return total;
+	}
+};
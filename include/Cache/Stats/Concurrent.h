@@ -0,0 +1,123 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "../detail/thread_index.h"
+
+namespace Stats
+{
+	// Same counters as Stats::Basic, but safe to update from many threads at
+	// once. Every thread increments the counters of its own stripe, so the hit
+	// path never writes to a cache line shared with other threads, and reading
+	// a counter sums it over all stripes.
+	template<typename Key, typename Value>
+	class Concurrent
+	{
+	private:
+		enum counter { HITS, MISSES, EVICTIONS, ERASURES, INVALIDATIONS, EXPIRATIONS, COUNTERS };
+
+		// Padded so that the counters of two stripes are always more than a
+		// cache line apart, whatever the alignment of the array is
+		struct stripe
+		{
+			std::atomic<std::uint64_t> counters[COUNTERS];
+			char padding[128 - COUNTERS * sizeof(std::atomic<std::uint64_t>)];
+		};
+
+		std::size_t m_Mask;
+		std::unique_ptr<stripe[]> m_Stripes;
+
+		static std::size_t stripe_count() noexcept
+		{
+			const std::size_t threads = std::thread::hardware_concurrency();
+
+			std::size_t count = 1;
+			while(count < threads) count *= 2;
+
+			return count;
+		}
+
+		void add(counter c) noexcept { m_Stripes[detail::thread_index() & m_Mask].counters[c].fetch_add(1, std::memory_order_relaxed); }
+
+		std::size_t sum(counter c) const noexcept
+		{
+			std::uint64_t total = 0;
+			for(std::size_t i = 0; i <= m_Mask; i++)
+				total += m_Stripes[i].counters[c].load(std::memory_order_relaxed);
+
+			return static_cast<std::size_t>(total);
+		}
+
+		void copy_from(const Concurrent& other) noexcept
+		{
+			for(std::size_t i = 0; i <= m_Mask; i++)
+				for(int c = 0; c < COUNTERS; c++)
+					m_Stripes[i].counters[c].store(other.m_Stripes[i].counters[c].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+	public:
+		Concurrent() : m_Mask(stripe_count() - 1), m_Stripes(new stripe[m_Mask + 1]()) {}
+
+		Concurrent(const Concurrent& other) : m_Mask(other.m_Mask), m_Stripes(new stripe[m_Mask + 1]()) { copy_from(other); }
+
+		Concurrent& operator=(const Concurrent& other)
+		{
+			if(this != &other)
+			{
+				if(m_Mask != other.m_Mask)
+				{
+					m_Stripes.reset(new stripe[other.m_Mask + 1]());
+					m_Mask = other.m_Mask;
+				}
+
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
+		void clear()                          noexcept { add(INVALIDATIONS); }
+		void hit   (const Key&, const Value&) noexcept { add(HITS); }
+		void erase (const Key&, const Value&) noexcept { add(ERASURES); }
+		void evict (const Key&, const Value&) noexcept { add(EVICTIONS); }
+		void expire(const Key&, const Value&) noexcept { add(EXPIRATIONS); }
+
+		template<typename K>
+		void miss(const K&) noexcept { add(MISSES); }
+
+		std::size_t hit_count() const noexcept { return sum(HITS); }
+		std::size_t miss_count() const noexcept { return sum(MISSES); }
+		std::size_t entry_invalidation_count() const noexcept { return sum(ERASURES); }
+		std::size_t cache_invalidation_count() const noexcept { return sum(INVALIDATIONS); }
+		std::size_t evicted_count() const noexcept { return sum(EVICTIONS); }
+		std::size_t expired_count() const noexcept { return sum(EXPIRATIONS); }
+	};
+}
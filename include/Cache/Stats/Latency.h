@@ -0,0 +1,60 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Basic.h"
+#include "../detail/histogram.h"
+#include "../detail/latency.h"
+
+namespace Stats
+{
+	// Same counters as Stats::Basic, plus a latency histogram for every timed
+	// operation (see Stats::operation). Latencies are measured in nanoseconds,
+	// or in cycles if CACHE_LATENCY_RDTSC is defined.
+	//
+	// `Cache` reports latencies once the operation has released its lock, so
+	// the histograms are updated with atomic increments and never lock.
+	template<typename Key, typename Value>
+	class Latency : public Basic<Key, Value>
+	{
+	private:
+		detail::log_linear_histogram m_Histograms[5];
+
+		const detail::log_linear_histogram& histogram(operation op) const noexcept { return m_Histograms[static_cast<std::size_t>(op)]; }
+
+	public:
+		void latency(operation op, std::uint64_t ticks) noexcept { m_Histograms[static_cast<std::size_t>(op)].record(ticks); }
+
+		// Latency under which `quantile` (between 0 and 1) of the operations
+		// completed, e.g. percentile(operation::hit, 0.99) for the p99 of hits
+		std::uint64_t percentile(operation op, double quantile) const noexcept { return histogram(op).percentile(quantile); }
+
+		// Number of timed operations of the given kind
+		std::uint64_t latency_count(operation op) const noexcept { return histogram(op).count(); }
+	};
+}
@@ -0,0 +1,558 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "../detail/group.h"
+#include "../detail/hash.h"
+#include "../detail/storage_hooks.h"
+
+namespace Storage
+{
+	// Open addressing hash table in the style of SwissTable. Entries are stored
+	// inline in a single array of slots instead of one heap node per entry, and
+	// a parallel array of control bytes lets lookups match a whole group of
+	// slots at once. The interface is a subset of std::unordered_map, so it can
+	// be used as the `StorageType` of a Cache.
+	//
+	// Unlike std::unordered_map, inserting an element may invalidate iterators
+	// and references to other elements if the table has to grow. Erasing an
+	// element only invalidates iterators and references to that element.
+	template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+	class Flat
+	{
+	public:
+		using key_type        = Key;
+		using mapped_type     = Value;
+		using value_type      = std::pair<const Key, Value>;
+		using size_type       = std::size_t;
+		using difference_type = std::ptrdiff_t;
+		using hasher          = Hash;
+		using key_equal       = KeyEqual;
+		using reference       = value_type&;
+		using const_reference = const value_type&;
+		using pointer         = value_type*;
+		using const_pointer   = const value_type*;
+
+		// A bounded cache never grows past its maximum size, so the whole table
+		// can be allocated upfront instead of rehashing as the cache fills up
+		static constexpr bool preallocate = true;
+
+	private:
+		using ctrl_t = detail::ctrl_t;
+		using group = detail::group;
+
+		template<bool Const>
+		class basic_iterator
+		{
+		private:
+			friend class Flat;
+			template<bool> friend class basic_iterator;
+
+			const ctrl_t* m_Ctrl;
+			typename Flat::value_type* m_Slot;
+
+			basic_iterator(const ctrl_t* ctrl, typename Flat::value_type* slot) noexcept : m_Ctrl(ctrl), m_Slot(slot) {}
+
+			void skip_free_slots() noexcept
+			{
+				while(*m_Ctrl < detail::CTRL_SENTINEL) { ++m_Ctrl; ++m_Slot; }
+			}
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type        = typename Flat::value_type;
+			using difference_type   = typename Flat::difference_type;
+			using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+			using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+
+			basic_iterator() noexcept : m_Ctrl(nullptr), m_Slot(nullptr) {}
+
+			template<bool C = Const, typename = std::enable_if_t<C>>
+			basic_iterator(const basic_iterator<false>& other) noexcept : m_Ctrl(other.m_Ctrl), m_Slot(other.m_Slot) {}
+
+			reference operator*() const noexcept { return *m_Slot; }
+			pointer operator->() const noexcept { return m_Slot; }
+
+			basic_iterator& operator++() noexcept { ++m_Ctrl; ++m_Slot; skip_free_slots(); return *this; }
+			basic_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+
+			friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) noexcept { return lhs.m_Ctrl == rhs.m_Ctrl; }
+			friend bool operator!=(const basic_iterator& lhs, const basic_iterator& rhs) noexcept { return lhs.m_Ctrl != rhs.m_Ctrl; }
+		};
+
+	public:
+		using iterator       = basic_iterator<false>;
+		using const_iterator = basic_iterator<true>;
+
+	private:
+		ctrl_t* m_Ctrl;
+		value_type* m_Slots;
+		size_type m_Capacity;   // Number of slots. Either 0 or a power of two multiple of group::WIDTH
+		size_type m_Size;
+		size_type m_GrowthLeft; // Number of empty slots that can be filled before rehashing
+		Hash m_Hash;
+		KeyEqual m_Equal;
+
+		// Tables with no slots point here, so that iteration stops right away
+		static ctrl_t* empty_ctrl() noexcept
+		{
+			static ctrl_t sentinel[1] = { detail::CTRL_SENTINEL };
+			return sentinel;
+		}
+
+		// Maximum load factor is 7/8
+		static constexpr size_type max_load(size_type capacity) noexcept { return capacity - capacity / 8; }
+
+		static size_type capacity_for(size_type count) noexcept
+		{
+			const size_type min_slots = count + (count + 6) / 7;
+
+			size_type capacity = group::WIDTH;
+			while(capacity < min_slots) capacity *= 2;
+
+			return capacity;
+		}
+
+		template<typename K>
+		std::uint64_t hash(const K& key) const { return detail::mix(static_cast<std::uint64_t>(m_Hash(key))); }
+
+		static ctrl_t h2(std::uint64_t hash) noexcept { return static_cast<ctrl_t>(hash & 0x7F); }
+
+		// Groups are probed quadratically (1, 2, 3... groups apart), which
+		// visits every group once since the group count is a power of two
+		template<typename Visitor>
+		size_type probe(std::uint64_t hash, Visitor visit) const
+		{
+			const size_type mask = m_Capacity / group::WIDTH - 1;
+			size_type index = static_cast<size_type>(hash >> 7) & mask;
+
+			for(size_type step = 1; ; step++)
+			{
+				const size_type base = index * group::WIDTH;
+				const size_type result = visit(base, group(m_Ctrl + base));
+
+				if(result != npos()) return result;
+				index = (index + step) & mask;
+			}
+		}
+
+		static constexpr size_type npos() noexcept { return static_cast<size_type>(-1); }
+
+		// Returns the slot holding `key`, or m_Capacity if there is none
+		template<typename K>
+		size_type find_index(const K& key, std::uint64_t hash) const
+		{
+			if(m_Size == 0) return m_Capacity;
+
+			return probe(hash, [&](size_type base, const group& g)
+			{
+				for(auto match = g.match(h2(hash)); match; ++match)
+				{
+					const size_type i = base + match.lowest();
+					if(m_Equal(m_Slots[i].first, key)) return i;
+				}
+
+				return g.match_empty() ? m_Capacity : npos();
+			});
+		}
+
+		// Returns the first empty or deleted slot in the probe sequence of `hash`
+		size_type find_free_index(std::uint64_t hash) const
+		{
+			return probe(hash, [](size_type base, const group& g)
+			{
+				auto free = g.match_empty_or_deleted();
+				return free ? base + free.lowest() : npos();
+			});
+		}
+
+		// Returns the slot holding `key` and true, or the slot where `key`
+		// should be inserted and false. May rehash the table.
+		std::pair<size_type, bool> find_or_prepare_insert(const key_type& key)
+		{
+			const std::uint64_t h = hash(key);
+			size_type target = npos();
+
+			if(m_Capacity != 0)
+			{
+				const size_type found = probe(h, [&](size_type base, const group& g)
+				{
+					for(auto match = g.match(h2(h)); match; ++match)
+					{
+						const size_type i = base + match.lowest();
+						if(m_Equal(m_Slots[i].first, key)) return i;
+					}
+
+					if(target == npos())
+					{
+						auto free = g.match_empty_or_deleted();
+						if(free) target = base + free.lowest();
+					}
+
+					return g.match_empty() ? m_Capacity : npos();
+				});
+
+				if(found != m_Capacity) return { found, true };
+			}
+
+			// Reusing a deleted slot doesn't consume any growth
+			if(target == npos() || (m_Ctrl[target] == detail::CTRL_EMPTY && m_GrowthLeft == 0))
+			{
+				grow();
+				target = find_free_index(h);
+			}
+
+			if(m_Ctrl[target] == detail::CTRL_EMPTY) m_GrowthLeft--;
+			m_Ctrl[target] = h2(h);
+			m_Size++;
+
+			return { target, false };
+		}
+
+		void grow()
+		{
+			if(m_Capacity == 0)
+				rehash_to(group::WIDTH);
+			else if(m_Size <= max_load(m_Capacity) / 2)
+				rehash_to(m_Capacity); // Mostly tombstones, just clean them up
+			else
+				rehash_to(m_Capacity * 2);
+		}
+
+		void rehash_to(size_type capacity)
+		{
+			Flat other(allocate_tag{}, capacity, m_Hash, m_Equal);
+
+			for(size_type i = 0; i < m_Capacity; i++)
+			{
+				if(m_Ctrl[i] < 0) continue;
+
+				const std::uint64_t h = other.hash(m_Slots[i].first);
+				const size_type target = other.find_free_index(h);
+
+				::new(static_cast<void*>(other.m_Slots + target)) value_type(std::move(m_Slots[i]));
+				other.m_Ctrl[target] = h2(h);
+				other.m_Size++;
+				other.m_GrowthLeft--;
+			}
+
+			swap(other);
+		}
+
+		void erase_index(size_type index) noexcept
+		{
+			m_Slots[index].~value_type();
+			free_index(index);
+		}
+
+		// Marks a slot as free again, without destroying its contents
+		void free_index(size_type index) noexcept
+		{
+			m_Size--;
+
+			// Lookups stop at the first group with an empty slot, so if this
+			// group already has one no probe sequence can go past it and the
+			// slot can be marked as empty instead of leaving a tombstone
+			if(group(m_Ctrl + (index & ~(group::WIDTH - 1))).match_empty())
+			{
+				m_Ctrl[index] = detail::CTRL_EMPTY;
+				m_GrowthLeft++;
+			}
+			else
+				m_Ctrl[index] = detail::CTRL_DELETED;
+		}
+
+		// Constructs the entry of a slot returned by find_or_prepare_insert()
+		template<typename... Args>
+		void construct_at(size_type index, Args&&... args)
+		{
+			try
+			{
+				::new(static_cast<void*>(m_Slots + index)) value_type(std::forward<Args>(args)...);
+			}
+			catch(...)
+			{
+				free_index(index);
+				throw;
+			}
+		}
+
+		void destroy_slots() noexcept
+		{
+			for(size_type i = 0; i < m_Capacity; i++)
+				if(m_Ctrl[i] >= 0) m_Slots[i].~value_type();
+		}
+
+		iterator iterator_at(size_type index) noexcept { return iterator(m_Ctrl + index, m_Slots + index); }
+		const_iterator iterator_at(size_type index) const noexcept { return const_iterator(m_Ctrl + index, m_Slots + index); }
+
+		struct allocate_tag {};
+
+		Flat(allocate_tag, size_type capacity, const Hash& hash, const KeyEqual& equal)
+			: m_Ctrl(new ctrl_t[capacity + 1]), m_Slots(std::allocator<value_type>().allocate(capacity)),
+			  m_Capacity(capacity), m_Size(0), m_GrowthLeft(max_load(capacity)), m_Hash(hash), m_Equal(equal)
+		{
+			std::fill(m_Ctrl, m_Ctrl + capacity, detail::CTRL_EMPTY);
+			m_Ctrl[capacity] = detail::CTRL_SENTINEL;
+		}
+
+	public:
+		Flat() : Flat(size_type{0}) {}
+
+		explicit Flat(size_type count, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+			: m_Ctrl(empty_ctrl()), m_Slots(nullptr), m_Capacity(0), m_Size(0), m_GrowthLeft(0), m_Hash(hash), m_Equal(equal)
+		{
+			reserve(count);
+		}
+
+		Flat(const Flat& other) : Flat(other.m_Size, other.m_Hash, other.m_Equal)
+		{
+			for(const auto& entry : other)
+				try_emplace(entry.first, entry.second);
+		}
+
+		Flat(Flat&& other) noexcept
+			: m_Ctrl(other.m_Ctrl), m_Slots(other.m_Slots), m_Capacity(other.m_Capacity), m_Size(other.m_Size),
+			  m_GrowthLeft(other.m_GrowthLeft), m_Hash(std::move(other.m_Hash)), m_Equal(std::move(other.m_Equal))
+		{
+			other.m_Ctrl = empty_ctrl();
+			other.m_Slots = nullptr;
+			other.m_Capacity = other.m_Size = other.m_GrowthLeft = 0;
+		}
+
+		Flat& operator=(const Flat& other)
+		{
+			if(this != &other)
+			{
+				Flat tmp(other);
+				swap(tmp);
+			}
+
+			return *this;
+		}
+
+		Flat& operator=(Flat&& other) noexcept
+		{
+			Flat tmp(std::move(other));
+			swap(tmp);
+			return *this;
+		}
+
+		~Flat()
+		{
+			if(m_Capacity == 0) return;
+
+			destroy_slots();
+			std::allocator<value_type>().deallocate(m_Slots, m_Capacity);
+			delete[] m_Ctrl;
+		}
+
+		void swap(Flat& other) noexcept
+		{
+			using std::swap;
+			swap(m_Ctrl, other.m_Ctrl);
+			swap(m_Slots, other.m_Slots);
+			swap(m_Capacity, other.m_Capacity);
+			swap(m_Size, other.m_Size);
+			swap(m_GrowthLeft, other.m_GrowthLeft);
+			swap(m_Hash, other.m_Hash);
+			swap(m_Equal, other.m_Equal);
+		}
+
+		      iterator  begin()       noexcept { auto it = iterator_at(0); it.skip_free_slots(); return it; }
+		const_iterator  begin() const noexcept { auto it = iterator_at(0); it.skip_free_slots(); return it; }
+		const_iterator cbegin() const noexcept { return begin(); }
+
+		      iterator  end()       noexcept { return iterator_at(m_Capacity); }
+		const_iterator  end() const noexcept { return iterator_at(m_Capacity); }
+		const_iterator cend() const noexcept { return end(); }
+
+		bool empty() const noexcept { return m_Size == 0; }
+		size_type size() const noexcept { return m_Size; }
+		size_type max_size() const noexcept { return max_load(static_cast<size_type>(-1) / sizeof(value_type)); }
+
+		// Number of slots currently allocated
+		size_type capacity() const noexcept { return m_Capacity; }
+
+		void reserve(size_type count)
+		{
+			if(count == 0) return;
+
+			const size_type capacity = capacity_for(count);
+			if(capacity > m_Capacity) rehash_to(capacity);
+		}
+
+		void clear() noexcept
+		{
+			if(m_Capacity == 0) return;
+
+			destroy_slots();
+			std::fill(m_Ctrl, m_Ctrl + m_Capacity, detail::CTRL_EMPTY);
+			m_Size = 0;
+			m_GrowthLeft = max_load(m_Capacity);
+		}
+
+		template<typename... Args>
+		std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+		{
+			auto result = find_or_prepare_insert(key);
+
+			if(!result.second)
+				construct_at(result.first, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+
+			return { iterator_at(result.first), !result.second };
+		}
+
+		template<typename... Args>
+		std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+		{
+			auto result = find_or_prepare_insert(key);
+
+			if(!result.second)
+				construct_at(result.first, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+
+			return { iterator_at(result.first), !result.second };
+		}
+
+		// The key is only known once the value has been constructed, so build
+		// it aside first and move it into its slot if the key is not present
+		template<typename... Args>
+		std::pair<iterator, bool> emplace(Args&&... args)
+		{
+			typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type buffer;
+			value_type* entry = ::new(static_cast<void*>(&buffer)) value_type(std::forward<Args>(args)...);
+
+			struct destroy_guard { value_type* p; ~destroy_guard() { p->~value_type(); } } guard{ entry };
+
+			auto result = find_or_prepare_insert(entry->first);
+
+			if(!result.second)
+				construct_at(result.first, std::move(*entry));
+
+			return { iterator_at(result.first), !result.second };
+		}
+
+		// Fast path for emplace(key, value), which doesn't need a temporary
+		template<typename K, typename V, typename = std::enable_if_t<std::is_same<std::decay_t<K>, key_type>::value>>
+		std::pair<iterator, bool> emplace(K&& key, V&& value)
+		{
+			return try_emplace(std::forward<K>(key), std::forward<V>(value));
+		}
+
+		std::pair<iterator, bool> insert(const value_type& value) { return try_emplace(value.first, value.second); }
+		std::pair<iterator, bool> insert(value_type&& value) { return emplace(std::move(value)); }
+
+		template<typename P, typename = std::enable_if_t<std::is_constructible<value_type, P&&>::value>>
+		std::pair<iterator, bool> insert(P&& value) { return emplace(std::forward<P>(value)); }
+
+		iterator erase(const_iterator pos) noexcept
+		{
+			const size_type index = static_cast<size_type>(pos.m_Slot - m_Slots);
+			erase_index(index);
+
+			auto next = iterator_at(index + 1);
+			next.skip_free_slots();
+			return next;
+		}
+
+		iterator erase(iterator pos) noexcept { return erase(const_iterator(pos)); }
+
+		iterator erase(const_iterator first, const_iterator last) noexcept
+		{
+			while(first != last)
+				first = erase(first);
+
+			return iterator_at(static_cast<size_type>(last.m_Slot - m_Slots));
+		}
+
+		size_type erase(const key_type& key)
+		{
+			const size_type index = find_index(key, hash(key));
+			if(index == m_Capacity) return 0;
+
+			erase_index(index);
+			return 1;
+		}
+
+		      iterator find(const key_type& key)       { return iterator_at(find_index(key, hash(key))); }
+		const_iterator find(const key_type& key) const { return iterator_at(find_index(key, hash(key))); }
+
+		size_type count(const key_type& key) const { return find_index(key, hash(key)) != m_Capacity; }
+
+		mapped_type& at(const key_type& key)
+		{
+			const size_type index = find_index(key, hash(key));
+			if(index == m_Capacity) throw std::out_of_range("Storage::Flat::at");
+
+			return m_Slots[index].second;
+		}
+
+		const mapped_type& at(const key_type& key) const { return const_cast<Flat*>(this)->at(key); }
+
+		// With a transparent hasher and key comparator, keys can be looked up
+		// with any type they can be hashed and compared with, without
+		// building a key_type first
+		template<typename K, typename = std::enable_if_t<detail::is_lookup_key<Flat, K>::value>>
+		      iterator find(const K& key)       { return iterator_at(find_index(key, hash(key))); }
+
+		template<typename K, typename = std::enable_if_t<detail::is_lookup_key<Flat, K>::value>>
+		const_iterator find(const K& key) const { return iterator_at(find_index(key, hash(key))); }
+
+		template<typename K, typename = std::enable_if_t<detail::is_lookup_key<Flat, K>::value>>
+		size_type count(const K& key) const { return find_index(key, hash(key)) != m_Capacity; }
+
+		template<typename K, typename = std::enable_if_t<detail::is_lookup_key<Flat, K>::value>>
+		size_type erase(const K& key)
+		{
+			const size_type index = find_index(key, hash(key));
+			if(index == m_Capacity) return 0;
+
+			erase_index(index);
+			return 1;
+		}
+
+		mapped_type& operator[](const key_type&  key) { return try_emplace(key).first->second; }
+		mapped_type& operator[](      key_type&& key) { return try_emplace(std::move(key)).first->second; }
+
+		hasher hash_function() const { return m_Hash; }
+		key_equal key_eq() const { return m_Equal; }
+	};
+
+	template<typename Key, typename Value, typename Hash, typename KeyEqual>
+	void swap(Flat<Key, Value, Hash, KeyEqual>& lhs, Flat<Key, Value, Hash, KeyEqual>& rhs) noexcept { lhs.swap(rhs); }
+}
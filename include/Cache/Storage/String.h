@@ -0,0 +1,69 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+	#include <string_view>
+#endif
+
+#include "Flat.h"
+#include "../detail/hash.h"
+
+namespace Storage
+{
+	// Transparent hasher for string keys. A std::string, a C string and (since
+	// C++17) a std::string_view with the same characters get the same hash, so
+	// storages using it can look strings up without building a std::string.
+	struct string_hash
+	{
+		using is_transparent = void;
+
+		std::size_t operator()(const std::string& str) const noexcept { return hash(str.data(), str.size()); }
+		std::size_t operator()(const char* str) const noexcept { return hash(str, std::char_traits<char>::length(str)); }
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+		std::size_t operator()(std::string_view str) const noexcept { return hash(str.data(), str.size()); }
+#endif
+
+	private:
+		static std::size_t hash(const char* data, std::size_t size) noexcept { return static_cast<std::size_t>(detail::hash_bytes(data, size)); }
+	};
+
+	// Storages for caches with std::string keys, whose lookups also accept
+	// C strings and std::string_view. std::unordered_map only has
+	// heterogeneous lookups since C++20: before that, the cache builds a
+	// std::string from the argument to look it up in a StringMap. FlatStringMap
+	// has them in any version.
+	template<typename Key, typename Value>
+	using StringMap = std::unordered_map<Key, Value, string_hash, std::equal_to<>>;
+
+	template<typename Key, typename Value>
+	using FlatStringMap = Flat<Key, Value, string_hash, std::equal_to<>>;
+}
@@ -25,43 +25,279 @@
 
 #pragma once
 
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 
 #include "Cache/Cache.h"
 #include "Cache/Stats/None.h"
-#include "Cache/detail/utility.h"
+#include "Cache/detail/function_traits.h"
+#include "Cache/detail/single_flight.h"
 #include "Cache/detail/tuple_hash.h"
 
+// A function whose results are cached, as returned by wrap(). The cache maps
+// the arguments of every call (stored as a tuple) to its result, and is shared
+// by all copies of the same CachedFunction, but not by different calls to
+// wrap(), which each get a cache of their own.
+template<typename Function, typename CacheType>
+class CachedFunction
+{
+public:
+	using cache_type  = CacheType;
+	using key_type    = typename cache_type::key_type;
+	using result_type = typename cache_type::mapped_type;
+
+protected:
+	Function m_Function;
+	std::shared_ptr<cache_type> m_Cache;
+
+public:
+	CachedFunction(Function fn, std::shared_ptr<cache_type> cache)
+		: m_Function(std::move(fn)), m_Cache(std::move(cache)) {}
+
+	template<typename... Arguments>
+	result_type operator()(Arguments&&... arguments)
+	{
+		key_type key(arguments...);
+
+		{
+			result_type cached;
+			if(m_Cache->try_get(key, cached)) return cached;
+		}
+
+		// The function is called without holding the cache lock (it may
+		// well call itself), so look the key up again when inserting
+		result_type value = m_Function(std::forward<Arguments>(arguments)...);
+		m_Cache->try_emplace(std::move(key), value);
+		return value;
+	}
+
+	      cache_type& cache()       noexcept { return *m_Cache; }
+	const cache_type& cache() const noexcept { return *m_Cache; }
+
+	auto stats() const noexcept -> decltype(std::declval<const cache_type&>().stats()) { return m_Cache->stats(); }
+
+	void clear() noexcept { m_Cache->clear(); }
+};
+
+// Same as CachedFunction, but when several threads miss the same arguments at
+// the same time, only the first one calls the function and the rest wait for
+// its result instead of computing it again. Returned by wrap_single_flight().
+template<typename Function, typename CacheType>
+class SingleFlightFunction : public CachedFunction<Function, CacheType>
+{
+private:
+	using base = CachedFunction<Function, CacheType>;
+
+	std::shared_ptr<detail::single_flight<typename base::key_type, typename base::result_type>> m_InFlight;
+
+public:
+	using typename base::cache_type;
+	using typename base::key_type;
+	using typename base::result_type;
+
+	SingleFlightFunction(Function fn, std::shared_ptr<cache_type> cache)
+		: base(std::move(fn), std::move(cache)), m_InFlight(std::make_shared<detail::single_flight<key_type, result_type>>()) {}
+
+	template<typename... Arguments>
+	result_type operator()(Arguments&&... arguments)
+	{
+		const key_type key(arguments...);
+		result_type cached;
+
+		if(this->m_Cache->try_get(key, cached))
+			return cached;
+
+		return m_InFlight->run(key, [&]()
+		{
+			// A previous call may have finished right after our first lookup
+			if(this->m_Cache->try_get(key, cached))
+				return cached;
+
+			result_type value = this->m_Function(std::forward<Arguments>(arguments)...);
+			this->m_Cache->try_emplace(key, value);
+			return value;
+		});
+	}
+};
+
+// A function that starts an asynchronous computation and returns a future for
+// its result, whose futures are cached. Returned by async_wrap(). A miss calls
+// the function and returns its future right away, without waiting for it, and
+// a hit returns the same future. Concurrent misses of the same arguments call
+// the function only once and share its future. Futures that end up holding an
+// exception are not reused: the next call with the same arguments calls the
+// function again.
+template<typename Function, typename CacheType>
+class AsyncCachedFunction : public CachedFunction<Function, CacheType>
+{
+private:
+	using base = CachedFunction<Function, CacheType>;
+
+	std::shared_ptr<detail::single_flight<typename base::key_type, typename base::result_type>> m_InFlight;
+
+	static bool failed(const typename base::result_type& future)
+	{
+		if(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+
+		try { future.get(); }
+		catch(...) { return true; }
+
+		return false;
+	}
+
+public:
+	using typename base::cache_type;
+	using typename base::key_type;
+	using typename base::result_type;
+
+	AsyncCachedFunction(Function fn, std::shared_ptr<cache_type> cache)
+		: base(std::move(fn), std::move(cache)), m_InFlight(std::make_shared<detail::single_flight<key_type, result_type>>()) {}
+
+	template<typename... Arguments>
+	result_type operator()(Arguments&&... arguments)
+	{
+		const key_type key(arguments...);
+		result_type cached;
+
+		if(this->m_Cache->try_get(key, cached) && !failed(cached))
+			return cached;
+
+		return m_InFlight->run(key, [&]()
+		{
+			if(this->m_Cache->try_get(key, cached) && !failed(cached))
+				return cached;
+
+			// The function only starts the computation, so this doesn't wait
+			// for it. A failed future for the same key is replaced.
+			result_type future = this->m_Function(std::forward<Arguments>(arguments)...);
+			this->m_Cache->insert_or_assign(key, future);
+			return future;
+		});
+	}
+};
+
+// Wraps `fn` in a cache of the given policy, built from `args`. The argument
+// and result types of the cache are those of `fn`, which must thus have a
+// single call signature (generic lambdas need the overload below instead).
+// Cached results are copied out before the cache is unlocked, so the result
+// type must be default constructible.
 template<
-	template<typename> class CachePolicy, // Cache replacement policy
-	typename CacheLock = NullLock,        // Cache lock. Set to `std::mutex` if function is concurrent
-	typename Function,                    // Original function type
-	typename... Args                      // Variadic cache arguments. Forwarded to Cache constructor
+	template<typename> class CachePolicy,                    // Cache replacement policy
+	typename CacheLock = NullLock,                           // Cache lock. Set to `std::mutex` if function is concurrent
+	template<typename...> class StatsProvider = Stats::None, // Statistics measurement object
+	typename Function,                                       // Original function type
+	typename... Args,                                        // Variadic cache arguments. Forwarded to Cache constructor
+	std::enable_if_t<!std::is_function<Function>::value, int> = 0
 >
 auto wrap(Function fn, Args&&... args)
 {
-	return
-		[fn, cache_args = std::make_tuple(args...)]
-		(auto&&... arguments) mutable
-		{
-			using Arguments = std::tuple<std::decay_t<decltype(arguments)>...>;
-			using ReturnType = decltype(fn(std::forward<decltype(arguments)>(arguments)...));
-			using FunctionCache = Cache<Arguments, ReturnType, CachePolicy, CacheLock, Stats::None>;
+	using Arguments = typename detail::function_traits<Function>::arguments;
+	using ReturnType = std::decay_t<typename detail::function_traits<Function>::result_type>;
+	using FunctionCache = Cache<Arguments, ReturnType, CachePolicy, CacheLock, StatsProvider>;
 
-			static_assert(!std::is_void<ReturnType>::value, "Return type of wrapped function must not be void");
+	static_assert(!std::is_void<ReturnType>::value, "Return type of wrapped function must not be void");
 
-			static auto cache = detail::construct_from_tuple<FunctionCache>(cache_args);
+	return CachedFunction<Function, FunctionCache>(std::move(fn), std::make_shared<FunctionCache>(std::forward<Args>(args)...));
+}
+
+// Same as wrap(), but with the call signature of `fn` given explicitly, as in
+// wrap<Policy::LRU, NullLock, Stats::None, int(int)>(fn, 16). This allows
+// wrapping generic lambdas and function objects with overloaded operator():
+// `fn` is always called with the parameter types of `Signature`.
+template<
+	template<typename> class CachePolicy,                    // Cache replacement policy
+	typename CacheLock,                                      // Cache lock. Set to `std::mutex` if function is concurrent
+	template<typename...> class StatsProvider,               // Statistics measurement object
+	typename Signature,                                      // Call signature of `fn`, such as int(int)
+	typename Function,                                       // Original function type
+	typename... Args,                                        // Variadic cache arguments. Forwarded to Cache constructor
+	std::enable_if_t<std::is_function<Signature>::value, int> = 0
+>
+auto wrap(Function fn, Args&&... args)
+{
+	return wrap<CachePolicy, CacheLock, StatsProvider>(detail::with_signature<Signature, Function>{ std::move(fn) }, std::forward<Args>(args)...);
+}
 
-			auto key = std::make_tuple(arguments...);
-			auto it = cache.find(key);
+// Same as wrap(), but meant to be called from multiple threads at once. When
+// several threads miss the same arguments at the same time, only the first one
+// calls `fn` and the rest wait for its result instead of computing it again.
+// If `fn` throws, the exception is rethrown in every waiting thread and nothing
+// is cached.
+template<
+	template<typename> class CachePolicy,                    // Cache replacement policy
+	typename CacheLock = std::mutex,                         // Cache lock
+	template<typename...> class StatsProvider = Stats::None, // Statistics measurement object
+	typename Function,                                       // Original function type
+	typename... Args,                                        // Variadic cache arguments. Forwarded to Cache constructor
+	std::enable_if_t<!std::is_function<Function>::value, int> = 0
+>
+auto wrap_single_flight(Function fn, Args&&... args)
+{
+	using Arguments = typename detail::function_traits<Function>::arguments;
+	using ReturnType = std::decay_t<typename detail::function_traits<Function>::result_type>;
+	using FunctionCache = Cache<Arguments, ReturnType, CachePolicy, CacheLock, StatsProvider>;
 
-			if(it != cache.end())
-				return it->second;
+	static_assert(!std::is_void<ReturnType>::value, "Return type of wrapped function must not be void");
 
-			auto value = fn(std::forward<decltype(arguments)>(arguments)...);
-			cache[key] = value;
-			return value;
-		};
+	return SingleFlightFunction<Function, FunctionCache>(std::move(fn), std::make_shared<FunctionCache>(std::forward<Args>(args)...));
+}
+
+// Same as wrap_single_flight(), but with the call signature of `fn` given
+// explicitly, like the equivalent overload of wrap()
+template<
+	template<typename> class CachePolicy,                    // Cache replacement policy
+	typename CacheLock,                                      // Cache lock
+	template<typename...> class StatsProvider,               // Statistics measurement object
+	typename Signature,                                      // Call signature of `fn`, such as int(int)
+	typename Function,                                       // Original function type
+	typename... Args,                                        // Variadic cache arguments. Forwarded to Cache constructor
+	std::enable_if_t<std::is_function<Signature>::value, int> = 0
+>
+auto wrap_single_flight(Function fn, Args&&... args)
+{
+	return wrap_single_flight<CachePolicy, CacheLock, StatsProvider>(detail::with_signature<Signature, Function>{ std::move(fn) }, std::forward<Args>(args)...);
+}
+
+// Same as wrap_single_flight(), but for a function that returns a std::future
+// or std::shared_future instead of a value, which is useful to cache the result
+// of I/O-bound functions without blocking a thread while it is computed. The
+// function decides where the computation runs (with std::async, in a thread
+// pool, etc.), and the cache stores its futures as std::shared_future.
+template<
+	template<typename> class CachePolicy,                    // Cache replacement policy
+	typename CacheLock = std::mutex,                         // Cache lock
+	template<typename...> class StatsProvider = Stats::None, // Statistics measurement object
+	typename Function,                                       // Original function type
+	typename... Args,                                        // Variadic cache arguments. Forwarded to Cache constructor
+	std::enable_if_t<!std::is_function<Function>::value, int> = 0
+>
+auto async_wrap(Function fn, Args&&... args)
+{
+	using Arguments = typename detail::function_traits<Function>::arguments;
+	using Future = std::decay_t<typename detail::function_traits<Function>::result_type>;
+	using FunctionCache = Cache<Arguments, std::shared_future<typename detail::future_traits<Future>::value_type>, CachePolicy, CacheLock, StatsProvider>;
+
+	return AsyncCachedFunction<Function, FunctionCache>(std::move(fn), std::make_shared<FunctionCache>(std::forward<Args>(args)...));
+}
+
+// Same as async_wrap(), but with the call signature of `fn` given explicitly,
+// like the equivalent overload of wrap()
+template<
+	template<typename> class CachePolicy,                    // Cache replacement policy
+	typename CacheLock,                                      // Cache lock
+	template<typename...> class StatsProvider,               // Statistics measurement object
+	typename Signature,                                      // Call signature of `fn`, such as std::future<int>(int)
+	typename Function,                                       // Original function type
+	typename... Args,                                        // Variadic cache arguments. Forwarded to Cache constructor
+	std::enable_if_t<std::is_function<Signature>::value, int> = 0
+>
+auto async_wrap(Function fn, Args&&... args)
+{
+	return async_wrap<CachePolicy, CacheLock, StatsProvider>(detail::with_signature<Signature, Function>{ std::move(fn) }, std::forward<Args>(args)...);
 }
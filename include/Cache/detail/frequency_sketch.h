@@ -0,0 +1,154 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hash.h"
+
+namespace detail
+{
+	// Count-min sketch with four rows of 4-bit counters, packed 16 per word.
+	// Once the number of recorded events reaches ten times the expected number
+	// of distinct keys, all counters are halved so that the sketch forgets old
+	// history and follows changes in popularity.
+	//
+	// The sketch starts empty and grows with the number of keys (like the one
+	// in Caffeine), so huge or unbounded caches only pay for the keys they
+	// actually hold, up to MAX_WORDS (1 MiB).
+	class frequency_sketch
+	{
+	private:
+		static constexpr std::size_t MAX_WORDS = std::size_t{1} << 17;
+		static constexpr std::uint64_t RESET_MASK = 0x7777777777777777ULL;
+
+		std::vector<std::uint64_t> table;
+		std::size_t sample_size = 0;
+		std::size_t additions = 0;
+
+		static std::uint64_t seed(unsigned row) noexcept
+		{
+			constexpr std::uint64_t seeds[] = { 0xC3A5C85C97CB3127ULL, 0xB492B66FBE98F273ULL, 0x9AE16A3B2F90404FULL, 0xCBF29CE484222325ULL };
+			return seeds[row];
+		}
+
+		// Position (in counters, not words) of the counter of `hash` in `row`
+		std::size_t counter_of(std::size_t hash, unsigned row) const noexcept
+		{
+			const std::uint64_t counters = static_cast<std::uint64_t>(table.size()) * 16;
+			return static_cast<std::size_t>(mix(static_cast<std::uint64_t>(hash) ^ seed(row)) & (counters - 1));
+		}
+
+		unsigned counter(std::size_t position) const noexcept
+		{
+			return static_cast<unsigned>((table[position / 16] >> ((position % 16) * 4)) & 0xF);
+		}
+
+		void reset() noexcept
+		{
+			for(auto& word : table)
+				word = (word >> 1) & RESET_MASK;
+
+			additions /= 2;
+		}
+
+	public:
+		frequency_sketch() = default;
+
+		void resize(std::size_t expected_keys)
+		{
+			std::size_t words = 1;
+			while(words < expected_keys && words < MAX_WORDS) words *= 2;
+
+			table.assign(words, 0);
+			sample_size = 10 * std::max<std::size_t>(1, std::min(expected_keys, MAX_WORDS * 16));
+			additions = 0;
+		}
+
+		// Makes room for `keys` distinct keys, growing the sketch in powers of
+		// two. Unlike resize(), growing keeps the estimates: the position of a
+		// counter only gains high bits, so the old counters are repeated over
+		// the new table and every key finds its old counts there.
+		void ensure_capacity(std::size_t keys)
+		{
+			if(keys <= table.size() || table.size() >= MAX_WORDS) return;
+			if(table.empty()) return resize(keys);
+
+			const std::size_t old_words = table.size();
+			std::size_t words = old_words;
+			while(words < keys && words < MAX_WORDS) words *= 2;
+
+			table.resize(words);
+			for(std::size_t i = old_words; i < words; i++)
+				table[i] = table[i % old_words];
+
+			sample_size = 10 * std::min(keys, MAX_WORDS * 16);
+		}
+
+		// Number of distinct keys the sketch is currently sized for
+		std::size_t capacity() const noexcept { return table.size(); }
+
+		void clear() noexcept
+		{
+			std::fill(table.begin(), table.end(), 0);
+			additions = 0;
+		}
+
+		void increment(std::size_t hash) noexcept
+		{
+			if(table.empty()) return;
+
+			bool added = false;
+			for(unsigned row = 0; row < 4; row++)
+			{
+				const std::size_t position = counter_of(hash, row);
+
+				if(counter(position) < 15)
+				{
+					table[position / 16] += std::uint64_t{1} << ((position % 16) * 4);
+					added = true;
+				}
+			}
+
+			if(added && ++additions >= sample_size)
+				reset();
+		}
+
+		unsigned frequency(std::size_t hash) const noexcept
+		{
+			if(table.empty()) return 0;
+
+			unsigned estimate = 15;
+			for(unsigned row = 0; row < 4; row++)
+				estimate = std::min(estimate, counter(counter_of(hash, row)));
+
+			return estimate;
+		}
+	};
+}
@@ -0,0 +1,83 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <future>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace detail
+{
+	// The result and argument types of a callable with a single call signature:
+	// functions, function pointers, non-generic lambdas and function objects
+	// with a single, non-template operator()
+	template<typename Function>
+	struct function_traits : function_traits<decltype(&Function::operator())> {};
+
+	template<typename R, typename... Args>
+	struct function_traits<R(Args...)>
+	{
+		using result_type = R;
+		using arguments   = std::tuple<std::decay_t<Args>...>; // How the arguments are stored as a key
+	};
+
+	template<typename R, typename... Args> struct function_traits<R(*)(Args...)> : function_traits<R(Args...)> {};
+	template<typename R, typename... Args> struct function_traits<R(&)(Args...)> : function_traits<R(Args...)> {};
+
+	template<typename R, typename C, typename... Args> struct function_traits<R(C::*)(Args...)>       : function_traits<R(Args...)> {};
+	template<typename R, typename C, typename... Args> struct function_traits<R(C::*)(Args...) const> : function_traits<R(Args...)> {};
+
+#if defined(__cpp_noexcept_function_type)
+	// Since C++17, noexcept is part of the type of a function
+	template<typename R, typename... Args> struct function_traits<R(Args...) noexcept>    : function_traits<R(Args...)> {};
+	template<typename R, typename... Args> struct function_traits<R(*)(Args...) noexcept> : function_traits<R(Args...)> {};
+	template<typename R, typename... Args> struct function_traits<R(&)(Args...) noexcept> : function_traits<R(Args...)> {};
+
+	template<typename R, typename C, typename... Args> struct function_traits<R(C::*)(Args...) noexcept>       : function_traits<R(Args...)> {};
+	template<typename R, typename C, typename... Args> struct function_traits<R(C::*)(Args...) const noexcept> : function_traits<R(Args...)> {};
+#endif
+
+	// Calls a callable that may have several call signatures (like a generic
+	// lambda) through a single one, so that function_traits can be used on it.
+	// The arguments are converted to the parameter types of the signature
+	// before the call, so every call with the same key sees the same types.
+	template<typename Signature, typename Function>
+	struct with_signature;
+
+	template<typename R, typename... Args, typename Function>
+	struct with_signature<R(Args...), Function>
+	{
+		Function function;
+
+		R operator()(Args... args) { return function(std::forward<Args>(args)...); }
+	};
+
+	// The type of the result of a future. Only defined for futures.
+	template<typename T> struct future_traits {};
+	template<typename T> struct future_traits<std::future<T>>        { using value_type = T; };
+	template<typename T> struct future_traits<std::shared_future<T>> { using value_type = T; };
+}
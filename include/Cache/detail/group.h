@@ -0,0 +1,161 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CACHE_GROUP_SSE2 1
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	#define CACHE_GROUP_NEON 1
+	#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+// Control bytes and group probing for SwissTable-style open addressing tables.
+// Every slot of the table has one control byte: EMPTY, DELETED, or the 7 low
+// bits of the hash of the key stored in it. The table is probed one group of
+// slots at a time, matching all control bytes of a group at once with SIMD
+// instructions (SSE2 or NEON) or with plain 64-bit arithmetic.
+namespace detail
+{
+	using ctrl_t = std::int8_t;
+
+	constexpr ctrl_t CTRL_EMPTY    = -128; // 0b10000000
+	constexpr ctrl_t CTRL_DELETED  = -2;   // 0b11111110
+	constexpr ctrl_t CTRL_SENTINEL = -1;   // 0b11111111, marks the end of the table
+
+	inline unsigned countr_zero(std::uint64_t x) noexcept
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, x);
+		return static_cast<unsigned>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+		return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+		unsigned n = 0;
+		while((x & 1) == 0) { x >>= 1; n++; }
+		return n;
+#endif
+	}
+
+	// Set of matching slots within a group. Each slot is represented by
+	// 2^Shift bits of the mask, of which only the highest one may be set.
+	template<unsigned Shift>
+	class group_mask
+	{
+	private:
+		std::uint64_t mask;
+
+	public:
+		explicit group_mask(std::uint64_t m) noexcept : mask(m) {}
+
+		explicit operator bool() const noexcept { return mask != 0; }
+
+		unsigned lowest() const noexcept { return countr_zero(mask) >> Shift; }
+
+		group_mask& operator++() noexcept { mask &= mask - 1; return *this; }
+	};
+
+#if defined(CACHE_GROUP_SSE2)
+	struct group
+	{
+		static constexpr std::size_t WIDTH = 16;
+		using mask_type = group_mask<0>;
+
+		__m128i ctrl;
+
+		explicit group(const ctrl_t* pos) noexcept : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+		mask_type match(ctrl_t h2) const noexcept
+		{
+			return mask_type(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))));
+		}
+
+		mask_type match_empty() const noexcept { return match(CTRL_EMPTY); }
+
+		mask_type match_empty_or_deleted() const noexcept
+		{
+			return mask_type(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(CTRL_SENTINEL), ctrl))));
+		}
+	};
+#elif defined(CACHE_GROUP_NEON)
+	struct group
+	{
+		static constexpr std::size_t WIDTH = 8;
+		using mask_type = group_mask<3>;
+
+		int8x8_t ctrl;
+
+		explicit group(const ctrl_t* pos) noexcept : ctrl(vld1_s8(pos)) {}
+
+		static mask_type to_mask(uint8x8_t bytes) noexcept
+		{
+			return mask_type(vget_lane_u64(vreinterpret_u64_u8(bytes), 0) & 0x8080808080808080ULL);
+		}
+
+		mask_type match(ctrl_t h2) const noexcept { return to_mask(vceq_s8(ctrl, vdup_n_s8(h2))); }
+		mask_type match_empty() const noexcept { return match(CTRL_EMPTY); }
+		mask_type match_empty_or_deleted() const noexcept { return to_mask(vclt_s8(ctrl, vdup_n_s8(CTRL_SENTINEL))); }
+	};
+#else
+	// Portable fallback: treat 8 control bytes as a single 64-bit word
+	struct group
+	{
+		static constexpr std::size_t WIDTH = 8;
+		using mask_type = group_mask<3>;
+
+		static constexpr std::uint64_t LSBS = 0x0101010101010101ULL;
+		static constexpr std::uint64_t MSBS = 0x8080808080808080ULL;
+
+		std::uint64_t ctrl = 0;
+
+		explicit group(const ctrl_t* pos) noexcept
+		{
+			for(unsigned i = 0; i < WIDTH; i++)
+				ctrl |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(pos[i])) << (8 * i);
+		}
+
+		// May report false positives for bytes equal to h2 ^ 1 right after a
+		// true match. Those always belong to full slots, and every candidate
+		// slot is compared against the key anyway, so they are harmless.
+		mask_type match(ctrl_t h2) const noexcept
+		{
+			const std::uint64_t x = ctrl ^ (LSBS * static_cast<std::uint8_t>(h2));
+			return mask_type((x - LSBS) & ~x & MSBS);
+		}
+
+		mask_type match_empty() const noexcept { return mask_type(ctrl & ~(ctrl << 6) & MSBS); }
+		mask_type match_empty_or_deleted() const noexcept { return mask_type(ctrl & ~(ctrl << 7) & MSBS); }
+	};
+#endif
+}
@@ -0,0 +1,74 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace detail
+{
+	// 64-bit finalizer from MurmurHash3. Spreads the entropy of the input over
+	// all bits, which matters for std::hash implementations that are just the
+	// identity function for integers.
+	constexpr std::uint64_t mix(std::uint64_t h) noexcept
+	{
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ULL;
+		h ^= h >> 33;
+
+		return h;
+	}
+
+	constexpr std::uint64_t rotl(std::uint64_t x, unsigned r) noexcept { return (x << r) | (x >> (64 - r)); }
+
+	// Hashes a range of bytes, 8 of them at a time. Every word is multiplied
+	// into the state, and the result goes through mix() so that every input
+	// bit affects every bit of the hash.
+	inline std::uint64_t hash_bytes(const void* data, std::size_t size) noexcept
+	{
+		constexpr std::uint64_t K1 = 0x87C37B91114253D5ULL;
+		constexpr std::uint64_t K2 = 0x4CF5AD432745937FULL;
+
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		std::uint64_t h = 0x9E3779B97F4A7C15ULL ^ static_cast<std::uint64_t>(size);
+
+		for(; size >= 8; p += 8, size -= 8)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, p, 8);
+			h = rotl(h ^ (word * K1), 31) * K2;
+		}
+
+		std::uint64_t tail = 0;
+		std::memcpy(&tail, p, size);
+		h = rotl(h ^ (tail * K1), 31) * K2;
+
+		return mix(h);
+	}
+}
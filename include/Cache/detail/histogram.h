@@ -0,0 +1,138 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace detail
+{
+	// A histogram of 64-bit values with log-linear buckets, like HdrHistogram.
+	// Values below 2^SUB_BITS get a bucket each, and every power of two above
+	// that is split in 2^SUB_BITS buckets, so any value is reported with a
+	// relative error below 2^-SUB_BITS (6.25%). Values of 2^MAX_BITS and above
+	// all fall in the last bucket.
+	//
+	// Recording a value is a single relaxed atomic increment, so many threads
+	// can record values at once without any lock.
+	class log_linear_histogram
+	{
+	private:
+		static constexpr unsigned SUB_BITS = 4;
+		static constexpr unsigned MAX_BITS = 48;
+		static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BITS;
+		static constexpr std::size_t BUCKETS = SUB_BUCKETS + (MAX_BITS - SUB_BITS) * SUB_BUCKETS;
+
+		std::unique_ptr<std::atomic<std::uint64_t>[]> m_Counts;
+
+		static unsigned log2(std::uint64_t value) noexcept
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return 63U - static_cast<unsigned>(__builtin_clzll(value));
+#else
+			unsigned bits = 0;
+			while(value >>= 1) bits++;
+			return bits;
+#endif
+		}
+
+		static std::size_t bucket(std::uint64_t value) noexcept
+		{
+			if(value < SUB_BUCKETS) return static_cast<std::size_t>(value);
+
+			const unsigned msb = log2(value);
+			if(msb >= MAX_BITS) return BUCKETS - 1;
+
+			const unsigned shift = msb - SUB_BITS;
+			const std::size_t sub = static_cast<std::size_t>(value >> shift) & (SUB_BUCKETS - 1);
+
+			return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+		}
+
+		// Highest value that falls in the given bucket
+		static std::uint64_t highest_value(std::size_t index) noexcept
+		{
+			if(index < SUB_BUCKETS) return index;
+
+			const unsigned shift = static_cast<unsigned>((index - SUB_BUCKETS) / SUB_BUCKETS);
+			const std::uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+
+			return ((SUB_BUCKETS | sub) << shift) + ((std::uint64_t{1} << shift) - 1);
+		}
+
+	public:
+		log_linear_histogram() : m_Counts(new std::atomic<std::uint64_t>[BUCKETS]()) {}
+
+		log_linear_histogram(const log_linear_histogram& other) : log_linear_histogram() { *this = other; }
+
+		log_linear_histogram& operator=(const log_linear_histogram& other) noexcept
+		{
+			for(std::size_t i = 0; i < BUCKETS; i++)
+				m_Counts[i].store(other.m_Counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+			return *this;
+		}
+
+		void record(std::uint64_t value) noexcept { m_Counts[bucket(value)].fetch_add(1, std::memory_order_relaxed); }
+
+		std::uint64_t count() const noexcept
+		{
+			std::uint64_t total = 0;
+			for(std::size_t i = 0; i < BUCKETS; i++)
+				total += m_Counts[i].load(std::memory_order_relaxed);
+
+			return total;
+		}
+
+		// Smallest recorded value that is greater than or equal to `quantile`
+		// (between 0 and 1) of all the recorded values, rounded up to the end
+		// of its bucket. Returns 0 if nothing has been recorded.
+		std::uint64_t percentile(double quantile) const noexcept
+		{
+			const std::uint64_t total = count();
+			if(total == 0) return 0;
+
+			if(quantile < 0.0) quantile = 0.0;
+			if(quantile > 1.0) quantile = 1.0;
+
+			// The rank of the value we are looking for, from 1 to total
+			std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(quantile * static_cast<double>(total)));
+			if(rank == 0) rank = 1;
+			if(rank > total) rank = total;
+
+			std::uint64_t seen = 0;
+			for(std::size_t i = 0; i < BUCKETS; i++)
+			{
+				seen += m_Counts[i].load(std::memory_order_relaxed);
+				if(seen >= rank) return highest_value(i);
+			}
+
+			return highest_value(BUCKETS - 1);
+		}
+	};
+}
@@ -0,0 +1,166 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+// Define CACHE_LATENCY_RDTSC to time operations with the time stamp counter of
+// x86 processors instead of std::chrono::steady_clock. Reading it is several
+// times cheaper, but latencies are then measured in cycles instead of
+// nanoseconds. It is ignored on other architectures.
+#if defined(CACHE_LATENCY_RDTSC) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+	#define CACHE_LATENCY_USE_RDTSC 1
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#endif
+
+namespace Stats
+{
+	// Operations timed by `Cache` for statistics providers that implement the
+	// optional latency(operation, ticks) hook
+	enum class operation
+	{
+		hit,    // Lookup of a key in the cache (including the time to lock it)
+		miss,   // Lookup of a key not in the cache (including the time to lock it)
+		insert, // Insertion or assignment, including any evictions it causes
+		evict,  // Eviction of a single entry
+		lock    // Time spent waiting for the lock of the cache
+	};
+}
+
+namespace detail
+{
+	// Ticks are nanoseconds, or cycles if CACHE_LATENCY_RDTSC is defined
+	inline std::uint64_t latency_ticks() noexcept
+	{
+#if defined(CACHE_LATENCY_USE_RDTSC)
+		return static_cast<std::uint64_t>(__rdtsc());
+#else
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+
+	template<typename Stats, typename = void>
+	struct measures_latency : std::false_type {};
+
+	template<typename Stats>
+	struct measures_latency<Stats, decltype(std::declval<Stats&>().latency(::Stats::operation::hit, std::uint64_t{}), void())> : std::true_type {};
+
+	// Locks `lock` for the lifetime of the guard, like std::lock_guard. If the
+	// statistics provider implements the latency hook, it also reports the
+	// time spent waiting for the lock and, once unlocked, the time taken by
+	// the whole operation. Otherwise, the clock is never read.
+	template<typename Lock, typename Stats, bool = measures_latency<Stats>::value>
+	class timed_lock
+	{
+	private:
+		std::lock_guard<Lock> m_Guard;
+
+	public:
+		timed_lock(Lock& lock, Stats&, ::Stats::operation) : m_Guard(lock) {}
+
+		timed_lock(const timed_lock&) = delete;
+		timed_lock& operator=(const timed_lock&) = delete;
+
+		void set(::Stats::operation) noexcept {}
+		bool hit_if(bool hit) noexcept { return hit; }
+
+		template<typename T>
+		T& hit(T& value) noexcept { return value; }
+
+		template<typename Iterator>
+		Iterator hit_if_found(Iterator it, const Iterator&) noexcept { return it; }
+	};
+
+	template<typename Lock, typename Stats>
+	class timed_lock<Lock, Stats, true>
+	{
+	private:
+		// Declared before the guard, so that the operation is reported once
+		// the lock has been released
+		struct stopwatch
+		{
+			Stats& stats;
+			::Stats::operation op;
+			const std::uint64_t start = latency_ticks();
+
+			~stopwatch() { stats.latency(op, latency_ticks() - start); }
+		};
+
+		stopwatch m_Stopwatch;
+		std::lock_guard<Lock> m_Guard;
+
+	public:
+		timed_lock(Lock& lock, Stats& stats, ::Stats::operation op) : m_Stopwatch{ stats, op }, m_Guard(lock)
+		{
+			stats.latency(::Stats::operation::lock, latency_ticks() - m_Stopwatch.start);
+		}
+
+		timed_lock(const timed_lock&) = delete;
+		timed_lock& operator=(const timed_lock&) = delete;
+
+		// Changes the operation reported once the guard is destroyed
+		void set(::Stats::operation op) noexcept { m_Stopwatch.op = op; }
+		bool hit_if(bool hit) noexcept { set(hit ? ::Stats::operation::hit : ::Stats::operation::miss); return hit; }
+
+		template<typename T>
+		T& hit(T& value) noexcept { set(::Stats::operation::hit); return value; }
+
+		template<typename Iterator>
+		Iterator hit_if_found(Iterator it, const Iterator& end) noexcept { hit_if(it != end); return it; }
+	};
+
+	// Times a single step of an operation whose lock is already held
+	template<typename Stats, bool = measures_latency<Stats>::value>
+	class scoped_timer
+	{
+	public:
+		scoped_timer(Stats&, ::Stats::operation) noexcept {}
+	};
+
+	template<typename Stats>
+	class scoped_timer<Stats, true>
+	{
+	private:
+		Stats& m_Stats;
+		::Stats::operation m_Op;
+		const std::uint64_t m_Start = latency_ticks();
+
+	public:
+		scoped_timer(Stats& stats, ::Stats::operation op) noexcept : m_Stats(stats), m_Op(op) {}
+
+		scoped_timer(const scoped_timer&) = delete;
+		scoped_timer& operator=(const scoped_timer&) = delete;
+
+		~scoped_timer() { m_Stats.latency(m_Op, latency_ticks() - m_Start); }
+	};
+}
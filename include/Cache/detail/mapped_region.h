@@ -0,0 +1,289 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace detail
+{
+	// Memory mapping, either anonymous or backed by a file. Changes to a
+	// writable file-backed region are shared with the file, so they outlive
+	// the process that made them.
+	class mapped_region
+	{
+	private:
+		char* m_Data = nullptr;
+		std::size_t m_Size = 0;
+
+		static constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{2} << 20;
+
+		static std::system_error error(const std::string& what)
+		{
+#if defined(_WIN32)
+			return std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+#else
+			return std::system_error(errno, std::generic_category(), what);
+#endif
+		}
+
+		void unmap() noexcept
+		{
+			if(m_Data == nullptr) return;
+
+#if defined(_WIN32)
+			UnmapViewOfFile(m_Data);
+#else
+			munmap(m_Data, m_Size);
+#endif
+			m_Data = nullptr;
+			m_Size = 0;
+		}
+
+#if defined(_WIN32)
+		void map(HANDLE file, const std::string& what, bool writable = true)
+		{
+			const std::uint64_t size = m_Size;
+			HANDLE mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+			if(mapping == nullptr) throw error("Unable to map " + what);
+
+			// The error is built before closing the mapping, since
+			// CloseHandle() may overwrite the last error
+			m_Data = static_cast<char*>(MapViewOfFile(mapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, m_Size));
+			if(m_Data == nullptr)
+			{
+				const auto err = error("Unable to map " + what);
+				CloseHandle(mapping);
+				throw err;
+			}
+
+			CloseHandle(mapping);
+		}
+#endif
+
+		mapped_region() = default;
+
+	public:
+		// Anonymous mapping of `size` zeroed bytes. Regions of at least one
+		// huge page are backed by huge pages when the system has any to spare,
+		// which saves most of the TLB misses of a big cache.
+		explicit mapped_region(std::size_t size) : m_Size(size)
+		{
+#if defined(_WIN32)
+			map(INVALID_HANDLE_VALUE, "anonymous memory");
+#else
+			void* data = MAP_FAILED;
+
+	#if defined(MAP_HUGETLB)
+			if(size >= HUGE_PAGE_SIZE)
+			{
+				const std::size_t rounded = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+				data = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+				if(data != MAP_FAILED) m_Size = rounded;
+			}
+	#endif
+
+			if(data == MAP_FAILED)
+			{
+				data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if(data == MAP_FAILED) throw error("Unable to map anonymous memory");
+
+	#if defined(MADV_HUGEPAGE)
+				// No huge pages reserved, so ask for transparent ones instead
+				if(size >= HUGE_PAGE_SIZE) madvise(data, size, MADV_HUGEPAGE);
+	#endif
+			}
+
+			m_Data = static_cast<char*>(data);
+#endif
+		}
+
+		// Maps the first `size` bytes of the file at `path`, which is created
+		// if it does not exist and extended with zeros if it is shorter
+		mapped_region(const std::string& path, std::size_t size) : m_Size(size)
+		{
+#if defined(_WIN32)
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if(file == INVALID_HANDLE_VALUE) throw error("Unable to open " + path);
+
+			try { map(file, path); } catch(...) { CloseHandle(file); throw; }
+			CloseHandle(file);
+#else
+			const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+			if(fd < 0) throw error("Unable to open " + path);
+
+			// The errors are built before closing the file, since close() may
+			// overwrite errno
+			struct stat info;
+			if(fstat(fd, &info) != 0)
+			{
+				const auto err = error("Unable to read the size of " + path);
+				close(fd);
+				throw err;
+			}
+
+			if(static_cast<std::size_t>(info.st_size) < size && ftruncate(fd, static_cast<off_t>(size)) != 0)
+			{
+				const auto err = error("Unable to resize " + path);
+				close(fd);
+				throw err;
+			}
+
+			void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if(data == MAP_FAILED)
+			{
+				const auto err = error("Unable to map " + path);
+				close(fd);
+				throw err;
+			}
+
+			close(fd);
+
+			m_Data = static_cast<char*>(data);
+#endif
+		}
+
+		// Maps the whole file at `path` for reading only. Pages are loaded by
+		// the OS on demand, so files much bigger than the available RAM can be
+		// read sequentially without ever being loaded completely.
+		static mapped_region open_read_only(const std::string& path)
+		{
+			mapped_region region;
+
+#if defined(_WIN32)
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if(file == INVALID_HANDLE_VALUE) throw error("Unable to open " + path);
+
+			LARGE_INTEGER size;
+			if(!GetFileSizeEx(file, &size))
+			{
+				const auto err = error("Unable to read the size of " + path);
+				CloseHandle(file);
+				throw err;
+			}
+
+			region.m_Size = static_cast<std::size_t>(size.QuadPart);
+
+			if(region.m_Size > 0)
+			{
+				try { region.map(file, path, false); } catch(...) { CloseHandle(file); throw; }
+			}
+
+			CloseHandle(file);
+#else
+			const int fd = open(path.c_str(), O_RDONLY);
+			if(fd < 0) throw error("Unable to open " + path);
+
+			struct stat info;
+			if(fstat(fd, &info) != 0)
+			{
+				const auto err = error("Unable to read the size of " + path);
+				close(fd);
+				throw err;
+			}
+
+			region.m_Size = static_cast<std::size_t>(info.st_size);
+
+			// Empty files can't be mapped, so they get an empty region
+			if(region.m_Size > 0)
+			{
+				void* data = mmap(nullptr, region.m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(data == MAP_FAILED)
+				{
+					const auto err = error("Unable to map " + path);
+					close(fd);
+					throw err;
+				}
+
+				region.m_Data = static_cast<char*>(data);
+				madvise(data, region.m_Size, MADV_SEQUENTIAL);
+			}
+
+			close(fd);
+#endif
+
+			return region;
+		}
+
+		mapped_region(const mapped_region&) = delete;
+		mapped_region& operator=(const mapped_region&) = delete;
+
+		mapped_region(mapped_region&& other) noexcept : m_Data(other.m_Data), m_Size(other.m_Size)
+		{
+			other.m_Data = nullptr;
+			other.m_Size = 0;
+		}
+
+		mapped_region& operator=(mapped_region&& other) noexcept
+		{
+			if(this != &other)
+			{
+				unmap();
+				m_Data = other.m_Data;
+				m_Size = other.m_Size;
+				other.m_Data = nullptr;
+				other.m_Size = 0;
+			}
+
+			return *this;
+		}
+
+		~mapped_region() { unmap(); }
+
+		// Writes the changes of a file-backed region to disk, and waits until
+		// they are written. Without it, the OS writes them back eventually.
+		void sync()
+		{
+			if(m_Data == nullptr) return;
+
+#if defined(_WIN32)
+			if(!FlushViewOfFile(m_Data, m_Size)) throw error("Unable to write mapped memory back");
+#else
+			if(msync(m_Data, m_Size, MS_SYNC) != 0) throw error("Unable to write mapped memory back");
+#endif
+		}
+
+		char* data() const noexcept { return m_Data; }
+		std::size_t size() const noexcept { return m_Size; }
+	};
+}
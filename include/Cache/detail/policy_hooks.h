@@ -0,0 +1,135 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Optional replacement policy hooks. Policies only need to provide the five
+// basic methods (clear, insert, touch, erase and replace_candidate), but they
+// may implement any of the following ones to get extra information from the
+// cache. If a policy does not provide a hook, a sensible default is used.
+namespace detail
+{
+	template<typename Policy>
+	auto reserve(Policy& policy, std::size_t max_size, int) -> decltype(policy.reserve(max_size), void())
+	{
+		policy.reserve(max_size);
+	}
+
+	template<typename Policy>
+	void reserve(Policy&, std::size_t, long) {}
+
+	// Called once, when the cache is created, with its maximum number of
+	// entries. Weighted caches don't know it, so they never call it.
+	template<typename Policy>
+	void reserve(Policy& policy, std::size_t max_size) { reserve(policy, max_size, 0); }
+
+	template<typename Policy, typename Key>
+	auto insert(Policy& policy, const Key& key, std::size_t weight, int) -> decltype(policy.insert(key, weight), void())
+	{
+		policy.insert(key, weight);
+	}
+
+	template<typename Policy, typename Key>
+	void insert(Policy& policy, const Key& key, std::size_t, long) { policy.insert(key); }
+
+	// Called instead of insert(key) for policies that take the weight of the
+	// entries into account, such as Policy::GDSF
+	template<typename Policy, typename Key>
+	void insert(Policy& policy, const Key& key, std::size_t weight) { insert(policy, key, weight, 0); }
+
+	template<typename Policy, typename Key>
+	auto reinsert(Policy& policy, const Key& key, std::size_t weight, int) -> decltype(policy.insert(key, weight), void())
+	{
+		policy.erase(key);
+		policy.insert(key, weight);
+	}
+
+	template<typename Policy, typename Key>
+	void reinsert(Policy&, const Key&, std::size_t, long) {}
+
+	template<typename Policy, typename Key>
+	auto update_weight(Policy& policy, const Key& key, std::size_t old_weight, std::size_t new_weight, int) -> decltype(policy.update_weight(key, old_weight, new_weight), void())
+	{
+		policy.update_weight(key, old_weight, new_weight);
+	}
+
+	template<typename Policy, typename Key>
+	void update_weight(Policy& policy, const Key& key, std::size_t, std::size_t new_weight, long) { reinsert(policy, key, new_weight, 0); }
+
+	// Called when an assignment changes the weight of an entry. Policies that
+	// take weights into account but don't provide this hook get the key erased
+	// and inserted again, which loses its history. Other policies ignore it.
+	template<typename Policy, typename Key>
+	void update_weight(Policy& policy, const Key& key, std::size_t old_weight, std::size_t new_weight) { update_weight(policy, key, old_weight, new_weight, 0); }
+
+	template<typename Policy, typename Key>
+	auto admit(Policy& policy, const Key& candidate, const Key& victim, int) -> decltype(bool(policy.admit(candidate, victim)))
+	{
+		return policy.admit(candidate, victim);
+	}
+
+	template<typename Policy, typename Key>
+	bool admit(Policy&, const Key&, const Key&, long) { return true; }
+
+	// Called when the cache is full, before evicting `victim` to make room
+	// for `candidate`. Returning false rejects the insertion of `candidate`.
+	template<typename Policy, typename Key>
+	bool admit(Policy& policy, const Key& candidate, const Key& victim) { return admit(policy, candidate, victim, 0); }
+
+	template<typename Policy, typename Fn>
+	auto dump(const Policy& policy, Fn& fn, int) -> decltype(policy.dump(fn), bool())
+	{
+		policy.dump(fn);
+		return true;
+	}
+
+	template<typename Policy, typename Fn>
+	bool dump(const Policy&, Fn&, long) { return false; }
+
+	// Calls fn(key, state) for every key of the policy, in the order they must
+	// be restored to rebuild the same policy (usually, the next key to evict
+	// first). `state` is any extra information the policy needs to restore the
+	// key, like its frequency. Returns false if the policy does not support it.
+	template<typename Policy, typename Fn>
+	bool dump(const Policy& policy, Fn&& fn) { return dump(policy, fn, 0); }
+
+	template<typename Policy, typename Key>
+	auto restore(Policy& policy, const Key& key, std::uint64_t state, std::size_t, int) -> decltype(policy.restore(key, state), void())
+	{
+		policy.restore(key, state);
+	}
+
+	template<typename Policy, typename Key>
+	void restore(Policy& policy, const Key& key, std::uint64_t, std::size_t weight, long) { insert(policy, key, weight); }
+
+	// Called instead of insert() for every key of a snapshot, in the order
+	// they were dumped. Policies without restore() just insert the key again.
+	template<typename Policy, typename Key>
+	void restore(Policy& policy, const Key& key, std::uint64_t state, std::size_t weight) { restore(policy, key, state, weight, 0); }
+}
@@ -0,0 +1,84 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace detail
+{
+	// High 64 bits of the 128-bit product of a and b
+	inline std::uint64_t mulhi(std::uint64_t a, std::uint64_t b, std::uint64_t& lo) noexcept
+	{
+#if defined(__SIZEOF_INT128__)
+		__extension__ typedef unsigned __int128 uint128_t;
+
+		const uint128_t product = static_cast<uint128_t>(a) * b;
+		lo = static_cast<std::uint64_t>(product);
+		return static_cast<std::uint64_t>(product >> 64);
+#else
+		const std::uint64_t a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+		const std::uint64_t b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+
+		const std::uint64_t lo_lo = a_lo * b_lo;
+		const std::uint64_t hi_lo = a_hi * b_lo;
+		const std::uint64_t lo_hi = a_lo * b_hi;
+		const std::uint64_t hi_hi = a_hi * b_hi;
+
+		const std::uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+
+		lo = (cross << 32) | (lo_lo & 0xFFFFFFFFULL);
+		return hi_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+	}
+
+	// wyrand, by Wang Yi. A tiny and very fast PRNG with a single word of
+	// state, more than good enough to pick eviction candidates.
+	class wyrand
+	{
+	private:
+		std::uint64_t m_State;
+
+	public:
+		explicit wyrand(std::uint64_t seed) noexcept : m_State(seed) {}
+
+		std::uint64_t operator()() noexcept
+		{
+			m_State += 0xA0761D6478BD642FULL;
+
+			std::uint64_t lo;
+			const std::uint64_t hi = mulhi(m_State, m_State ^ 0xE7037ED1A0B428DBULL, lo);
+			return hi ^ lo;
+		}
+
+		// Uniformly distributed number in [0, bound), using Lemire's
+		// multiply-shift reduction instead of a (much slower) modulo
+		std::uint64_t operator()(std::uint64_t bound) noexcept
+		{
+			std::uint64_t lo;
+			return mulhi((*this)(), bound, lo);
+		}
+	};
+}
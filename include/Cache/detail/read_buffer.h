@@ -0,0 +1,102 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace detail
+{
+	// A small, lossy buffer of recently read keys. Readers never wait for it:
+	// if the buffer is full or another thread is using it, the read is just
+	// not recorded. Losing a few reads only makes the replacement policy a bit
+	// less accurate, which is much cheaper than making every reader take the
+	// lock of the policy.
+	template<typename Key, std::size_t Capacity = 16>
+	class read_buffer
+	{
+	private:
+		std::atomic<bool> m_Busy{false};
+		std::vector<Key> m_Keys;
+
+		bool try_acquire() noexcept
+		{
+			// Check before exchanging, so that a busy buffer is not written to
+			return !m_Busy.load(std::memory_order_relaxed) && !m_Busy.exchange(true, std::memory_order_acquire);
+		}
+
+		void release() noexcept { m_Busy.store(false, std::memory_order_release); }
+
+	public:
+		read_buffer() { m_Keys.reserve(Capacity); }
+
+		read_buffer(const read_buffer&) = delete;
+		read_buffer& operator=(const read_buffer&) = delete;
+
+		// Records a read of `key`, unless the buffer is full or busy. Returns
+		// true if the buffer is full and should be drained.
+		bool offer(const Key& key) noexcept
+		{
+			if(!try_acquire()) return false;
+
+			bool full = true;
+			try
+			{
+				if(m_Keys.size() < Capacity) m_Keys.push_back(key);
+				full = m_Keys.size() >= Capacity;
+			}
+			catch(...) {}
+
+			release();
+			return full;
+		}
+
+		// Calls fn(key) for every recorded read, oldest first, and empties the
+		// buffer. Waits for the reader using the buffer, if any.
+		template<typename Fn>
+		void drain(Fn&& fn)
+		{
+			while(!try_acquire())
+				std::this_thread::yield();
+
+			try
+			{
+				for(const auto& key : m_Keys)
+					fn(key);
+			}
+			catch(...)
+			{
+				m_Keys.clear();
+				release();
+				throw;
+			}
+
+			m_Keys.clear();
+			release();
+		}
+	};
+}
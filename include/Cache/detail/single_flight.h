@@ -0,0 +1,86 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <exception>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+namespace detail
+{
+	// Deduplicates concurrent computations of the same key: the first caller
+	// runs the computation and every caller that arrives while it is still in
+	// flight waits for (and shares) its result, including any exception.
+	template<typename Key, typename Value>
+	class single_flight
+	{
+	private:
+		std::mutex m_Mutex;
+		std::unordered_map<Key, std::shared_future<Value>> m_Calls;
+
+		void forget(const Key& key)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Calls.erase(key);
+		}
+
+	public:
+		template<typename Compute>
+		Value run(const Key& key, Compute compute)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			auto it = m_Calls.find(key);
+			if(it != m_Calls.end())
+			{
+				auto result = it->second;
+				lock.unlock();
+
+				return result.get();
+			}
+
+			std::promise<Value> promise;
+			m_Calls.emplace(key, promise.get_future().share());
+			lock.unlock();
+
+			try
+			{
+				Value value = compute();
+				promise.set_value(value);
+				forget(key);
+
+				return value;
+			}
+			catch(...)
+			{
+				promise.set_exception(std::current_exception());
+				forget(key);
+				throw;
+			}
+		}
+	};
+}
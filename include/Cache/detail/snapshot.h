@@ -0,0 +1,128 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "../Serializer.h"
+
+// Snapshot format written by Cache::save():
+//
+//  - Header: the magic bytes "CACHESNP", a 32-bit format version and the
+//    64-bit number of entries.
+//  - One record per entry, in the order the replacement policy must see them
+//    again: the 64-bit policy state of the entry (see detail::dump()), its
+//    remaining time to live in nanoseconds as a signed 64-bit integer (0 if it
+//    never expires, negative if it had already expired), its key and its
+//    value.
+//
+// Integers are stored in the native byte order of the machine.
+namespace detail
+{
+	namespace snapshot
+	{
+		constexpr char MAGIC[8] = { 'C', 'A', 'C', 'H', 'E', 'S', 'N', 'P' };
+		constexpr std::uint32_t VERSION = 1;
+
+		inline void write_header(std::ostream& os, std::uint64_t count)
+		{
+			os.write(MAGIC, sizeof(MAGIC));
+			Serializer<std::uint32_t>::write(os, VERSION);
+			Serializer<std::uint64_t>::write(os, count);
+		}
+
+		// Returns the number of entries in the snapshot
+		inline std::uint64_t read_header(std::istream& is)
+		{
+			char magic[sizeof(MAGIC)] = {};
+			is.read(magic, sizeof(magic));
+
+			if(!is || !std::equal(magic, magic + sizeof(magic), MAGIC))
+				throw std::runtime_error("Cache::load(): not a cache snapshot");
+
+			if(Serializer<std::uint32_t>::read(is) != VERSION)
+				throw std::runtime_error("Cache::load(): unsupported snapshot version");
+
+			const std::uint64_t count = Serializer<std::uint64_t>::read(is);
+			if(!is) throw std::runtime_error("Cache::load(): truncated snapshot");
+
+			return count;
+		}
+
+		// Calls write(stream) on a temporary file next to `path`, and then
+		// replaces `path` with it, so that a crash while saving never leaves a
+		// half-written snapshot behind
+		template<typename Write>
+		void save_file(const std::string& path, Write&& write)
+		{
+			const std::string temporary = path + ".tmp";
+
+			std::ofstream os(temporary, std::ios::binary | std::ios::trunc);
+			if(!os) throw std::runtime_error("Cache::save(): cannot open '" + temporary + "'");
+
+			try
+			{
+				write(os);
+				os.close();
+
+				if(!os) throw std::runtime_error("Cache::save(): cannot write '" + temporary + "'");
+			}
+			catch(...)
+			{
+				os.close();
+				std::remove(temporary.c_str());
+				throw;
+			}
+
+			// std::rename() does not replace existing files on Windows
+			if(std::rename(temporary.c_str(), path.c_str()) != 0)
+			{
+				std::remove(path.c_str());
+
+				if(std::rename(temporary.c_str(), path.c_str()) != 0)
+				{
+					std::remove(temporary.c_str());
+					throw std::runtime_error("Cache::save(): cannot replace '" + path + "'");
+				}
+			}
+		}
+
+		template<typename Read>
+		void load_file(const std::string& path, Read&& read)
+		{
+			std::ifstream is(path, std::ios::binary);
+			if(!is) throw std::runtime_error("Cache::load(): cannot open '" + path + "'");
+
+			read(is);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <utility>
+
+// Optional statistics provider hooks. Providers only need to provide the basic
+// events (clear, hit, miss, erase and evict), but they may implement any of
+// the following ones to be notified of other events.
+namespace detail
+{
+	template<typename Key, typename Stats, typename K>
+	auto miss(Stats& stats, const K& key, int) -> decltype(stats.miss(key), void())
+	{
+		stats.miss(key);
+	}
+
+	template<typename Key, typename Stats, typename K>
+	void miss(Stats& stats, const K& key, long) { stats.miss(Key(key)); }
+
+	// Called on a miss with the key that was looked up, which may be of any
+	// type the storage can look up (see is_lookup_key). Providers that only
+	// take `const Key&` get the key converted first.
+	template<typename Key, typename Stats, typename K>
+	void miss(Stats& stats, const K& key) { miss<Key>(stats, key, 0); }
+
+	template<typename Stats, typename Key, typename Value>
+	auto expire(Stats& stats, const Key& key, const Value& value, int) -> decltype(stats.expire(key, value), void())
+	{
+		stats.expire(key, value);
+	}
+
+	template<typename Stats, typename Key, typename Value>
+	void expire(Stats&, const Key&, const Value&, long) {}
+
+	// Called when an entry is removed because its time to live ran out
+	template<typename Stats, typename Key, typename Value>
+	void expire(Stats& stats, const Key& key, const Value& value) { expire(stats, key, value, 0); }
+}
@@ -0,0 +1,129 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Optional storage hooks. Any container with the same interface as
+// std::unordered_map can be used as the storage of a cache, but it may declare
+// the following members to tune how the cache uses it.
+namespace detail
+{
+	template<typename Storage, typename = void>
+	struct preallocates : std::false_type {};
+
+	template<typename Storage>
+	struct preallocates<Storage, std::enable_if_t<Storage::preallocate>> : std::true_type {};
+
+	// Number of entries to reserve when the cache is created. Node-based
+	// containers only reserve buckets for the first few entries, while storages
+	// declaring `static constexpr bool preallocate = true` are sized for the
+	// whole cache at once (unless the cache is unbounded). New entries are
+	// inserted before evicting the replacement candidate, so they get one
+	// extra entry to never rehash.
+	template<typename Storage>
+	std::size_t initial_capacity(std::size_t max_size) noexcept
+	{
+		static constexpr std::size_t MAX_RESERVE_SIZE = 1024;
+
+		if(preallocates<Storage>::value && max_size != std::numeric_limits<std::size_t>::max())
+			return max_size + 1;
+
+		return max_size < MAX_RESERVE_SIZE ? max_size : MAX_RESERVE_SIZE;
+	}
+
+	template<typename T, typename = void>
+	struct is_transparent : std::false_type {};
+
+	template<typename T>
+	struct is_transparent<T, decltype(std::declval<typename T::is_transparent*>(), void())> : std::true_type {};
+
+	template<typename Storage, typename K, typename = void>
+	struct is_lookup_key : std::false_type {};
+
+	// Whether keys of type `K` can be looked up in `Storage` as they are,
+	// without building a `key_type` first. That requires both the hasher and
+	// the key comparator of the storage to be transparent (to declare a type
+	// named `is_transparent`). Iterators are excluded so that erase(it) keeps
+	// calling the overload that takes an iterator.
+	template<typename Storage, typename K>
+	struct is_lookup_key<Storage, K, std::enable_if_t<is_transparent<typename Storage::hasher>::value && is_transparent<typename Storage::key_equal>::value>>
+		: std::integral_constant<bool,
+			!std::is_convertible<const K&, typename Storage::iterator>::value &&
+			!std::is_convertible<const K&, typename Storage::const_iterator>::value> {};
+
+	template<typename Storage, typename K>
+	auto find(Storage& storage, const K& key, int) -> decltype(storage.find(key))
+	{
+		return storage.find(key);
+	}
+
+	template<typename Storage, typename K>
+	auto find(Storage& storage, const K& key, long) -> decltype(storage.find(typename Storage::key_type(key)))
+	{
+		return storage.find(typename Storage::key_type(key));
+	}
+
+	// Looks `key` up in `storage`. Storages with a transparent hasher whose
+	// find() does not take a `K` anyway (std::unordered_map before C++20) get
+	// a `key_type` built from it. Storages that can't do either don't accept
+	// `K` as a lookup key.
+	template<typename Storage, typename K>
+	auto find(Storage& storage, const K& key) -> decltype(find(storage, key, 0))
+	{
+		return find(storage, key, 0);
+	}
+
+	template<typename Storage, typename K, typename... Args>
+	auto try_emplace_impl(int, Storage& storage, K&& key, Args&&... args)
+		-> decltype(storage.try_emplace(std::forward<K>(key), std::forward<Args>(args)...))
+	{
+		return storage.try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+	}
+
+	template<typename Storage, typename K, typename... Args>
+	std::pair<typename Storage::iterator, bool> try_emplace_impl(long, Storage& storage, K&& key, Args&&... args)
+	{
+		auto it = storage.find(key);
+		if(it != storage.end()) return { it, false };
+
+		return storage.emplace(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+	}
+
+	// Inserts an entry with a value constructed from `args` if `key` is not
+	// in the storage, otherwise nothing is constructed. Storages with their
+	// own try_emplace() (like std::unordered_map in C++17) do it in a single
+	// lookup, the rest fall back to find() + emplace().
+	template<typename Storage, typename K, typename... Args>
+	std::pair<typename Storage::iterator, bool> try_emplace(Storage& storage, K&& key, Args&&... args)
+	{
+		return try_emplace_impl(0, storage, std::forward<K>(key), std::forward<Args>(args)...);
+	}
+}
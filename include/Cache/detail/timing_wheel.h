@@ -0,0 +1,284 @@
+/*
+ *  This file is part of the Cache library (https://github.com/marcizhu/Cache)
+ *
+ *  Copyright (C) 2020-2021 Marc Izquierdo
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace detail
+{
+	// Hierarchical timing wheel keeping the expiration time of a set of keys.
+	// Time is split in ticks of 1 ms (or one unit of the clock, if coarser),
+	// and every level of the wheel has 64 slots spanning 64 ticks of the level
+	// below. A key is kept in the lowest level where its deadline falls within
+	// the current rotation, and moves down a level (cascades) when the wheel
+	// reaches its slot. Scheduling, cancelling and expiring a key are O(1), and
+	// advancing the wheel costs O(1) per tick. If the wheel is left idle for
+	// longer than the time it would take to scan all of its keys, it is rebuilt
+	// from scratch instead.
+	template<typename Key, typename Clock, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+	class timing_wheel
+	{
+	public:
+		using time_point = typename Clock::time_point;
+		using duration   = typename Clock::duration;
+
+	private:
+		static constexpr unsigned BITS = 6;
+		static constexpr std::size_t SLOTS = std::size_t{1} << BITS;
+		static constexpr unsigned LEVELS = (64 + BITS - 1) / BITS;
+
+		struct node
+		{
+			time_point deadline;
+			std::uint64_t tick;
+			const Key* key;
+			node* prev;
+			node* next;
+			std::size_t slot;
+		};
+
+		std::unordered_map<Key, node, Hash, KeyEqual> m_Nodes;
+		std::vector<node*> m_Slots;
+		std::uint64_t m_Current = 0;
+
+		static duration resolution() noexcept
+		{
+			const auto ms = std::chrono::duration_cast<duration>(std::chrono::milliseconds(1));
+			return ms.count() > 0 ? ms : duration(1);
+		}
+
+		static std::uint64_t tick_of(time_point t, bool round_up) noexcept
+		{
+			const duration since_epoch = t.time_since_epoch();
+			if(since_epoch.count() <= 0) return 0;
+
+			auto ticks = since_epoch / resolution();
+			if(round_up && ticks * resolution() < since_epoch) ticks++;
+
+			return static_cast<std::uint64_t>(ticks);
+		}
+
+		// Links `n` to the slot of its tick, or of `min_tick` if its tick has
+		// already gone by. The level is given by the highest digit (in base 64)
+		// where the tick differs from the current one.
+		void link(node& n, std::uint64_t min_tick) noexcept
+		{
+			const std::uint64_t tick = n.tick > min_tick ? n.tick : min_tick;
+			const std::uint64_t diff = tick ^ m_Current;
+
+			unsigned level = 0;
+			while(level + 1 < LEVELS && (diff >> (BITS * (level + 1))) != 0)
+				level++;
+
+			n.slot = level * SLOTS + static_cast<std::size_t>((tick >> (BITS * level)) & (SLOTS - 1));
+			n.prev = nullptr;
+			n.next = m_Slots[n.slot];
+
+			if(n.next) n.next->prev = &n;
+			m_Slots[n.slot] = &n;
+		}
+
+		void unlink(node& n) noexcept
+		{
+			if(n.prev) n.prev->next = n.next;
+			else m_Slots[n.slot] = n.next;
+
+			if(n.next) n.next->prev = n.prev;
+		}
+
+		void cascade(unsigned level) noexcept
+		{
+			const std::size_t slot = level * SLOTS + static_cast<std::size_t>((m_Current >> (BITS * level)) & (SLOTS - 1));
+			node* n = m_Slots[slot];
+			m_Slots[slot] = nullptr;
+
+			while(n)
+			{
+				node* next = n->next;
+				link(*n, m_Current);
+				n = next;
+			}
+		}
+
+		template<typename Fn>
+		void expire_slot(std::size_t slot, Fn& on_expire)
+		{
+			while(node* n = m_Slots[slot])
+			{
+				unlink(*n);
+				on_expire(*n->key);
+				m_Nodes.erase(m_Nodes.find(*n->key));
+			}
+		}
+
+		template<typename Fn>
+		void rebuild(std::uint64_t target, Fn& on_expire)
+		{
+			m_Current = target;
+			std::fill(m_Slots.begin(), m_Slots.end(), nullptr);
+
+			for(auto it = m_Nodes.begin(); it != m_Nodes.end();)
+			{
+				if(it->second.tick <= target)
+				{
+					on_expire(it->first);
+					it = m_Nodes.erase(it);
+				}
+				else
+				{
+					link(it->second, target + 1);
+					++it;
+				}
+			}
+		}
+
+		void copy_from(const timing_wheel& other)
+		{
+			m_Current = other.m_Current;
+			if(other.m_Nodes.empty()) return;
+
+			m_Slots.assign(LEVELS * SLOTS, nullptr);
+
+			for(const auto& p : other.m_Nodes)
+			{
+				auto& entry = *m_Nodes.emplace(p.first, p.second).first;
+				entry.second.key = &entry.first;
+				link(entry.second, m_Current + 1);
+			}
+		}
+
+	public:
+		timing_wheel() = default;
+		~timing_wheel() = default;
+
+		timing_wheel(const timing_wheel& other) { copy_from(other); }
+
+		timing_wheel& operator=(const timing_wheel& other)
+		{
+			if(this != &other)
+			{
+				clear();
+				copy_from(other);
+			}
+
+			return *this;
+		}
+
+		bool empty() const noexcept { return m_Nodes.empty(); }
+		std::size_t size() const noexcept { return m_Nodes.size(); }
+
+		void clear() noexcept
+		{
+			m_Nodes.clear();
+			std::fill(m_Slots.begin(), m_Slots.end(), nullptr);
+		}
+
+		// Sets (or replaces) the deadline of `key`
+		void schedule(const Key& key, time_point deadline, time_point now)
+		{
+			if(m_Slots.empty()) m_Slots.assign(LEVELS * SLOTS, nullptr);
+			if(m_Nodes.empty()) m_Current = tick_of(now, false);
+
+			auto pair = m_Nodes.emplace(key, node{});
+			node& n = pair.first->second;
+
+			if(!pair.second) unlink(n);
+
+			n.key = &pair.first->first;
+			n.deadline = deadline;
+			n.tick = tick_of(deadline, true);
+			link(n, m_Current + 1);
+		}
+
+		void cancel(const Key& key)
+		{
+			if(m_Nodes.empty()) return;
+
+			auto it = m_Nodes.find(key);
+			if(it == m_Nodes.end()) return;
+
+			unlink(it->second);
+			m_Nodes.erase(it);
+		}
+
+		bool expired(const Key& key, time_point now) const
+		{
+			if(m_Nodes.empty()) return false;
+
+			auto it = m_Nodes.find(key);
+			return it != m_Nodes.end() && it->second.deadline <= now;
+		}
+
+		// Deadline of `key`, or time_point::max() if it does not expire
+		time_point deadline(const Key& key) const
+		{
+			if(m_Nodes.empty()) return time_point::max();
+
+			auto it = m_Nodes.find(key);
+			return it != m_Nodes.end() ? it->second.deadline : time_point::max();
+		}
+
+		// Removes every key whose deadline is not after `now`, calling
+		// `on_expire(key)` for each one of them. `on_expire` must not modify
+		// the wheel.
+		template<typename Fn>
+		void advance(time_point now, Fn&& on_expire)
+		{
+			const std::uint64_t target = tick_of(now, false);
+
+			if(m_Nodes.empty())
+			{
+				if(target > m_Current) m_Current = target;
+				return;
+			}
+
+			if(target <= m_Current) return;
+
+			if(target - m_Current > m_Nodes.size() + SLOTS)
+				return rebuild(target, on_expire);
+
+			while(m_Current < target)
+			{
+				m_Current++;
+
+				// Higher levels first, so that their keys cascade all the way down
+				for(unsigned level = LEVELS - 1; level > 0; level--)
+				{
+					if((m_Current & ((std::uint64_t{1} << (BITS * level)) - 1)) == 0)
+						cascade(level);
+				}
+
+				expire_slot(static_cast<std::size_t>(m_Current & (SLOTS - 1)), on_expire);
+			}
+		}
+	};
+}
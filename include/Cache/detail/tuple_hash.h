@@ -25,9 +25,49 @@
 
 #pragma once
 
-#include <tuple>      // std::tuple
-#include <utility>    // std::get, std::make_index_sequence
-#include <functional> // std::hash
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint64_t
+#include <functional>  // std::hash
+#include <tuple>       // std::tuple, std::get
+#include <type_traits> // std::enable_if, std::is_integral, std::is_enum
+#include <utility>     // std::index_sequence
+
+#include "Cache/detail/hash.h"
+
+namespace detail
+{
+	// Integers and enums are used as they are: the tuple hash mixes them
+	// anyway, and it keeps hashing tuples of them constexpr
+	template<typename T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, int>::type = 0>
+	constexpr std::uint64_t hash_element(const T& value) noexcept { return static_cast<std::uint64_t>(value); }
+
+	template<typename T, typename std::enable_if<!std::is_integral<T>::value && !std::is_enum<T>::value, int>::type = 0>
+	std::uint64_t hash_element(const T& value) { return static_cast<std::uint64_t>(std::hash<T>{}(value)); }
+
+	// A single multiplication per element, which makes the hash depend on the
+	// order of the elements. mix() takes care of the rest at the end.
+	constexpr std::uint64_t hash_round(std::uint64_t h, std::uint64_t value) noexcept
+	{
+		return (h ^ value) * 0x87C37B91114253D5ULL;
+	}
+
+	template<typename Tuple>
+	constexpr std::uint64_t hash_elements(std::uint64_t h, const Tuple&, std::index_sequence<>) noexcept { return h; }
+
+	template<typename Tuple, std::size_t I, std::size_t... Is>
+	constexpr std::uint64_t hash_elements(std::uint64_t h, const Tuple& tuple, std::index_sequence<I, Is...>)
+	{
+		return hash_elements(hash_round(h, hash_element(std::get<I>(tuple))), tuple, std::index_sequence<Is...>());
+	}
+
+	// Hashes every element in place (without copying it) and mixes the result,
+	// so that tuples of small integers spread over all the bits of the hash
+	template<typename... Ts>
+	constexpr std::uint64_t hash_tuple(const std::tuple<Ts...>& tuple)
+	{
+		return mix(hash_elements(0x9E3779B97F4A7C15ULL ^ sizeof...(Ts), tuple, std::index_sequence_for<Ts...>()));
+	}
+}
 
 namespace std
 {
@@ -37,20 +77,6 @@ namespace std
 		using argument_type = std::tuple<Ts...>;
 		using result_type = std::size_t;
 
-		result_type operator()(const argument_type& argument) const { return hash_tuple(argument, std::make_index_sequence<sizeof...(Ts)>()); }
-
-	private:
-		template<std::size_t I, std::size_t... Is>
-		result_type hash_tuple(const argument_type& tuple, std::index_sequence<I, Is...>) const
-		{
-			auto value = std::get<I>(tuple);
-			auto current = std::hash<decltype(value)>{}(value);
-			auto seed = hash_tuple(tuple, std::index_sequence<Is...>());
-
-			// http://www.boost.org/doc/libs/1_35_0/doc/html/boost/hash_combine_id241013.html
-			return current + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-		}
-
-		result_type hash_tuple(const argument_type&, std::index_sequence<>) const { return 0; }
+		constexpr result_type operator()(const argument_type& argument) const { return static_cast<result_type>(detail::hash_tuple(argument)); }
 	};
 }
@@ -47,4 +47,15 @@ namespace detail
 	{
 		return construct_from_tuple<T>(std::move(args), std::make_index_sequence<sizeof...(Args)>());
 	}
+
+	// Converts to the result of calling `factory`, so that a value can be
+	// constructed in place from the result of a function that is only called
+	// if the value is actually constructed
+	template<typename Factory>
+	struct lazy_value
+	{
+		Factory& factory;
+
+		operator decltype(std::declval<Factory&>()())() const { return factory(); }
+	};
 }
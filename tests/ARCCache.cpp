@@ -0,0 +1,150 @@
+#include <string>
+
+#include "Cache/Cache.h"
+#include "Cache/Policy/ARC.h"
+
+#include "catch2/catch.hpp"
+
+TEST_CASE("Cache w/ ARC replacement policy: ARC behaviour", "[cache][behaviour][arc]")
+{
+	constexpr size_t MAX_SIZE = 128;
+	Cache<std::string, int, Policy::ARC> cache(MAX_SIZE);
+
+	SECTION("Keys seen only once are replaced in LRU order")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		REQUIRE(cache.size() == cache.max_size());
+		REQUIRE(cache.evicted_count() == 0);
+
+		cache.insert("asdf", 42);
+		CHECK(cache.contains("1") == false);
+		CHECK(cache.evicted_count() == 1);
+	}
+
+	SECTION("Keys seen only once are replaced before frequently used keys")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		for(size_t i = 1; i <= MAX_SIZE / 2; i++)
+			REQUIRE(cache.contains(std::to_string(i)) == true);
+
+		for(size_t i = 1; i <= 10 * MAX_SIZE; i++)
+			cache.insert("scan " + std::to_string(i), (int)i);
+
+		for(size_t i = 1; i <= MAX_SIZE / 2; i++)
+			CHECK(cache.contains(std::to_string(i)) == true);
+
+		CHECK(cache.size() == MAX_SIZE);
+	}
+
+	SECTION("If there are no recently seen keys, the least recently used frequent key is replaced")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			REQUIRE(cache.contains(std::to_string(i)) == true);
+
+		cache.insert("asdf", 42);
+		CHECK(cache.contains("1") == false);
+		CHECK(cache.evicted_count() == 1);
+	}
+}
+
+TEST_CASE("ARC replacement policy: adaptation", "[policy][arc]")
+{
+	constexpr size_t MAX_SIZE = 4;
+	Policy::ARC<int> policy;
+	policy.reserve(MAX_SIZE);
+
+	auto evict = [&policy]() { auto key = policy.replace_candidate(); policy.erase(key); return key; };
+
+	for(int i = 1; i <= 4; i++)
+		policy.insert(i);
+
+	policy.touch(3);
+	policy.touch(4);
+
+	REQUIRE(policy.target_size() == 0);
+
+	SECTION("A ghost hit in B1 grows the target size of T1")
+	{
+		CHECK(evict() == 1);
+		policy.insert(5);
+
+		CHECK(evict() == 2);
+		policy.insert(1);
+
+		CHECK(policy.target_size() == 1);
+	}
+
+	SECTION("A ghost hit in B2 shrinks the target size of T1")
+	{
+		CHECK(evict() == 1);
+		policy.insert(5);
+
+		CHECK(evict() == 2);
+		policy.insert(1);
+		REQUIRE(policy.target_size() == 1);
+
+		// T1 = { 5 }, which is at its target size, so T2 is shrunk instead
+		CHECK(evict() == 3);
+		policy.insert(6);
+
+		CHECK(evict() == 5);
+		policy.insert(3);
+		CHECK(policy.target_size() == 0);
+	}
+
+	SECTION("Ghost entries are bounded by the cache size")
+	{
+		for(int i = 10; i < 1000; i++)
+		{
+			evict();
+			policy.insert(i);
+		}
+
+		CHECK(policy.replace_candidate() == 998);
+
+		// Key 10 was evicted long ago, so it is no longer a ghost
+		evict();
+		policy.insert(10);
+		CHECK(policy.target_size() == 0);
+
+		// Key 998 was just evicted, so it is a ghost of T1
+		evict();
+		policy.insert(998);
+		CHECK(policy.target_size() == 1);
+	}
+}
+
+TEST_CASE("ARC replacement policy: unknown capacity", "[policy][arc]")
+{
+	// Weighted caches never call reserve(), so the policy takes the largest
+	// number of keys it has held as its capacity
+	Policy::ARC<int> policy;
+
+	auto evict = [&policy]() { auto key = policy.replace_candidate(); policy.erase(key); return key; };
+
+	for(int i = 1; i <= 4; i++)
+		policy.insert(i);
+
+	for(int i = 10; i < 1000; i++)
+	{
+		evict();
+		policy.insert(i);
+	}
+
+	// Key 10 was evicted long ago, so it is no longer a ghost
+	evict();
+	policy.insert(10);
+	CHECK(policy.target_size() == 0);
+
+	// The key that was just evicted is a ghost of T1
+	const int ghost = evict();
+	policy.insert(ghost);
+	CHECK(policy.target_size() == 1);
+}
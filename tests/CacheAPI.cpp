@@ -1,13 +1,19 @@
 #include <functional>
+#include <limits>
+#include <stdexcept>
 #include <string>
 
 #include "Cache/Cache.h"
+#include "Cache/Policy/ARC.h"
 #include "Cache/Policy/FIFO.h"
+#include "Cache/Policy/GDSF.h"
 #include "Cache/Policy/LFU.h"
 #include "Cache/Policy/LIFO.h"
 #include "Cache/Policy/LRU.h"
 #include "Cache/Policy/MRU.h"
 #include "Cache/Policy/Random.h"
+#include "Cache/Policy/WTinyLFU.h"
+#include "Cache/Storage/Flat.h"
 
 #include "catch2/catch.hpp"
 
@@ -18,13 +24,58 @@ struct wrapper
 	using apply = Template<Args>;
 };
 
+// Key that counts how many times it is built from an id, to check that
+// transparent lookups by id never build one
+struct id_key
+{
+	static int conversions;
+	int id;
+
+	explicit id_key(int i) : id(i) { conversions++; }
+	bool operator==(const id_key& other) const noexcept { return id == other.id; }
+};
+
+int id_key::conversions = 0;
+
+namespace std
+{
+	template<>
+	struct hash<id_key>
+	{
+		size_t operator()(const id_key& key) const noexcept { return std::hash<int>{}(key.id); }
+	};
+}
+
+struct id_hash
+{
+	using is_transparent = void;
+
+	size_t operator()(const id_key& key) const noexcept { return std::hash<int>{}(key.id); }
+	size_t operator()(int id) const noexcept { return std::hash<int>{}(id); }
+};
+
+struct id_equal
+{
+	using is_transparent = void;
+
+	bool operator()(const id_key& lhs, const id_key& rhs) const noexcept { return lhs.id == rhs.id; }
+	bool operator()(const id_key& lhs, int rhs) const noexcept { return lhs.id == rhs; }
+	bool operator()(int lhs, const id_key& rhs) const noexcept { return lhs == rhs.id; }
+};
+
+template<typename Key, typename Value>
+using id_storage = Storage::Flat<Key, Value, id_hash, id_equal>;
+
 #define CACHE_REPLACEMENT_POLICIES \
+	wrapper<Policy::ARC >, \
 	wrapper<Policy::FIFO>, \
+	wrapper<Policy::GDSF>, \
 	wrapper<Policy::LFU >, \
 	wrapper<Policy::LIFO>, \
 	wrapper<Policy::LRU >, \
 	wrapper<Policy::MRU >, \
-	wrapper<Policy::Random>
+	wrapper<Policy::Random>, \
+	wrapper<Policy::WTinyLFU>
 
 TEMPLATE_TEST_CASE("Cache API: std::erase_if()", "[cache][erase_if]", CACHE_REPLACEMENT_POLICIES)
 {
@@ -115,6 +166,7 @@ TEMPLATE_TEST_CASE("Cache API: Thread-safety", "[cache][thread]", CACHE_REPLACEM
 	// Size getters
 	SECTION("empty() is thread-safe") { CHECK_THREAD_SAFETY(cache.empty()); }
 	SECTION("size() is thread-safe")  { CHECK_THREAD_SAFETY(cache.size() ); }
+	SECTION("weight() is thread-safe") { CHECK_THREAD_SAFETY(cache.weight()); }
 
 	// Lookup functions
 	SECTION("at() is thread-safe")       { cache["key"] = 0; CHECK_THREAD_SAFETY_EX(cache.at    ("key"), 2, 3); }
@@ -123,6 +175,7 @@ TEMPLATE_TEST_CASE("Cache API: Thread-safety", "[cache][thread]", CACHE_REPLACEM
 	SECTION("contains() is thread-safe") { CHECK_THREAD_SAFETY(cache.contains("key")); }
 	SECTION("count() is thread-safe")    { CHECK_THREAD_SAFETY(cache.count("key")); }
 	SECTION("find() is thread-safe")     { CHECK_THREAD_SAFETY(cache.find("key")); }
+	SECTION("try_get() is thread-safe")  { int value = 0; CHECK_THREAD_SAFETY(cache.try_get("key", value)); }
 
 	// Erase functions
 	SECTION("erase(it) is thread-safe")    { cache["key"] = 0; CHECK_THREAD_SAFETY_EX(cache.erase(cache.begin()             ), 2, 4); }
@@ -134,6 +187,9 @@ TEMPLATE_TEST_CASE("Cache API: Thread-safety", "[cache][thread]", CACHE_REPLACEM
 	SECTION("insert() is thread-safe")      { CHECK_THREAD_SAFETY(cache.insert ("test", 5)); }
 	SECTION("insert(range) is thread-safe") { CHECK_THREAD_SAFETY_EX(cache.insert({ { "a", 1 }, { "b", 2}, { "c", 3 } }), 1, 1+3); }
 	SECTION("insert(pair) is thread-safe")  { CHECK_THREAD_SAFETY(cache.insert(std::make_pair("key", 9))); }
+	SECTION("try_emplace() is thread-safe")        { CHECK_THREAD_SAFETY(cache.try_emplace("test", 5)); }
+	SECTION("insert_or_assign() is thread-safe")   { CHECK_THREAD_SAFETY(cache.insert_or_assign("test", 5)); }
+	SECTION("get_or_insert_with() is thread-safe") { CHECK_THREAD_SAFETY(cache.get_or_insert_with("test", []() { return 5; })); }
 
 	// Clear functions
 	SECTION("clear() is thread-safe") { CHECK_THREAD_SAFETY(cache.clear()); }
@@ -500,6 +556,328 @@ TEMPLATE_TEST_CASE("Cache API: emplace()", "[cache][emplace]", CACHE_REPLACEMENT
 	}
 }
 
+TEMPLATE_TEST_CASE("Cache API: try_emplace()", "[cache][try_emplace]", CACHE_REPLACEMENT_POLICIES)
+{
+	constexpr size_t MAX_SIZE = 128;
+	Cache<std::string, std::string, TestType::template apply> cache(MAX_SIZE);
+
+	SECTION("try_emplace() constructs item in-place")
+	{
+		auto pair = cache.try_emplace("key", 3, 'a');
+
+		CHECK(pair.second == true);
+		CHECK(pair.first->second == "aaa");
+		CHECK(cache.size() == 1);
+	}
+
+	SECTION("try_emplace() of an existing item does not modify it")
+	{
+		cache.try_emplace("key", 3, 'a');
+		auto pair = cache.try_emplace("key", 3, 'b');
+
+		CHECK(pair.second == false);
+		CHECK(pair.first->second == "aaa");
+		CHECK(cache.size() == 1);
+	}
+
+	SECTION("try_emplace() evicts items if size() == max_size()")
+	{
+		for(size_t i = 1; i <= 2 * MAX_SIZE; i++)
+			cache.try_emplace(std::to_string(i), std::to_string(i));
+
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.evicted_count() == MAX_SIZE);
+		CHECK(cache.hit_count() == 0);
+		CHECK(cache.miss_count() == 0);
+	}
+
+	SECTION("insert_or_assign() inserts new items and overwrites existing ones")
+	{
+		CHECK(cache.insert_or_assign("key", "value 1").second == true);
+		CHECK(cache.insert_or_assign("key", "value 2").second == false);
+
+		CHECK(cache.at("key") == "value 2");
+		CHECK(cache.size() == 1);
+	}
+
+	SECTION("get_or_insert_with() only calls the factory on a miss")
+	{
+		int calls = 0;
+		auto factory = [&calls]() { calls++; return std::string("value"); };
+
+		CHECK(cache.get_or_insert_with("key", factory) == "value");
+		CHECK(cache.get_or_insert_with("key", factory) == "value");
+
+		CHECK(calls == 1);
+		CHECK(cache.size() == 1);
+		CHECK(cache.hit_count() == 1);
+		CHECK(cache.miss_count() == 1);
+	}
+
+	SECTION("get_or_insert_with() inserts nothing if the factory throws")
+	{
+		CHECK_THROWS_AS(cache.get_or_insert_with("key", []() -> std::string { throw std::runtime_error("error"); }), std::runtime_error);
+
+		CHECK(cache.size() == 0);
+		CHECK(cache.contains("key") == false);
+	}
+}
+
+struct StringWeigher
+{
+	size_t operator()(const std::string&, const std::string& value) const noexcept { return value.size(); }
+};
+
+TEMPLATE_TEST_CASE("Cache API: Weighted capacity", "[cache][weight]", CACHE_REPLACEMENT_POLICIES)
+{
+	constexpr size_t MAX_WEIGHT = 1000;
+	using CacheType = Cache<std::string, std::string, TestType::template apply, NullLock, Stats::Basic, std::unordered_map, StringWeigher>;
+	CacheType cache(MAX_WEIGHT);
+
+	const auto total_weight = [&cache]()
+	{
+		size_t total = 0;
+		for(const auto& entry : cache)
+			total += entry.second.size();
+
+		return total;
+	};
+
+	SECTION("The total weight never exceeds max_size()")
+	{
+		for(size_t i = 1; i <= 200; i++)
+		{
+			cache.insert(std::to_string(i), std::string(1 + (i * 37) % 150, 'x'));
+
+			REQUIRE(cache.weight() <= MAX_WEIGHT);
+			REQUIRE(cache.weight() == total_weight());
+		}
+
+		CHECK(cache.evicted_count() > 0);
+		CHECK(cache.utilization() == static_cast<float>(cache.weight()) / MAX_WEIGHT);
+	}
+
+	SECTION("Several entries are evicted to make room for a heavy one")
+	{
+		for(size_t i = 1; i <= 10; i++)
+			cache.insert(std::to_string(i), std::string(100, 'x'));
+
+		REQUIRE(cache.size() == 10);
+		REQUIRE(cache.weight() == MAX_WEIGHT);
+
+		// get_or_insert_with() always admits the new entry
+		cache.get_or_insert_with("heavy", []() { return std::string(450, 'x'); });
+		CHECK(cache.contains("heavy") == true);
+		CHECK(cache.size() == 6);
+		CHECK(cache.evicted_count() == 5);
+		CHECK(cache.weight() == 950);
+	}
+
+	SECTION("Entries heavier than max_size() are rejected")
+	{
+		cache.insert("a", std::string(10, 'x'));
+
+		auto pair = cache.insert("huge", std::string(MAX_WEIGHT + 1, 'x'));
+		CHECK(pair.second == false);
+		CHECK(pair.first == cache.end());
+		CHECK(cache.size() == 1);
+		CHECK(cache.weight() == 10);
+		CHECK(cache.evicted_count() == 0);
+	}
+
+	SECTION("insert_or_assign() updates the weight of existing entries")
+	{
+		for(size_t i = 1; i <= 10; i++)
+			cache.insert(std::to_string(i), std::string(100, 'x'));
+
+		cache.insert_or_assign("1", std::string(10, 'x'));
+		CHECK(cache.weight() == 910);
+
+		cache.insert_or_assign("1", std::string(300, 'x'));
+		CHECK(cache.at("1").size() == 300);
+		CHECK(cache.weight() <= MAX_WEIGHT);
+		CHECK(cache.weight() == total_weight());
+	}
+
+	SECTION("Entries that grow heavier are never evicted by their own assignment")
+	{
+		for(size_t round = 1; round <= 50; round++)
+		{
+			for(size_t i = 1; i <= 10; i++)
+				cache.insert(std::to_string(i), std::string(100, 'x'));
+
+			const std::string key = std::to_string(1 + round % 10);
+			cache.insert_or_assign(key, std::string(500, 'x'));
+
+			REQUIRE(cache.contains(key) == true);
+			REQUIRE(cache.at(key).size() == 500);
+			REQUIRE(cache.weight() <= MAX_WEIGHT);
+			REQUIRE(cache.weight() == total_weight());
+		}
+	}
+
+	SECTION("Big weight budgets are not preallocated as if they were entries")
+	{
+		// Flat storage used to reserve a slot for every unit of weight
+		constexpr size_t HUGE_WEIGHT = std::numeric_limits<size_t>::max() / 2;
+		Cache<std::string, std::string, TestType::template apply, NullLock, Stats::Basic, Storage::Flat, StringWeigher> big(HUGE_WEIGHT);
+
+		for(size_t i = 1; i <= 100; i++)
+			big.insert(std::to_string(i), std::string(i, 'x'));
+
+		CHECK(big.size() == 100);
+		CHECK(big.weight() == 5050);
+		CHECK(big.evicted_count() == 0);
+		CHECK(big.at("100").size() == 100);
+	}
+
+	SECTION("erase() and clear() release the weight of the entries")
+	{
+		cache.insert("a", std::string(10, 'x'));
+		cache.insert("b", std::string(20, 'x'));
+		cache.insert("c", std::string(30, 'x'));
+
+		cache.erase("b");
+		CHECK(cache.weight() == 40);
+
+		cache.erase(cache.find("a"));
+		CHECK(cache.weight() == 30);
+
+		cache.clear();
+		CHECK(cache.weight() == 0);
+	}
+}
+
+// Counts how many times its instances have been copied
+struct CopyCounter
+{
+	static int Copies;
+
+	std::string data;
+
+	CopyCounter() = default;
+	CopyCounter(const char* str) : data(str) {}
+	CopyCounter(const CopyCounter& other) : data(other.data) { Copies++; }
+	CopyCounter(CopyCounter&&) = default;
+	CopyCounter& operator=(const CopyCounter& other) { data = other.data; Copies++; return *this; }
+	CopyCounter& operator=(CopyCounter&&) = default;
+};
+
+int CopyCounter::Copies = 0;
+
+// Key that counts how many times its instances have been copied
+struct CopyCountingKey
+{
+	static int Copies;
+
+	std::string data;
+
+	CopyCountingKey() = default;
+	CopyCountingKey(std::string str) : data(std::move(str)) {}
+	CopyCountingKey(const CopyCountingKey& other) : data(other.data) { Copies++; }
+	CopyCountingKey(CopyCountingKey&&) = default;
+	CopyCountingKey& operator=(const CopyCountingKey& other) { data = other.data; Copies++; return *this; }
+	CopyCountingKey& operator=(CopyCountingKey&&) = default;
+
+	bool operator==(const CopyCountingKey& other) const noexcept { return data == other.data; }
+	bool operator!=(const CopyCountingKey& other) const noexcept { return data != other.data; }
+};
+
+int CopyCountingKey::Copies = 0;
+
+namespace std
+{
+	template<>
+	struct hash<CopyCountingKey>
+	{
+		size_t operator()(const CopyCountingKey& key) const noexcept { return hash<string>()(key.data); }
+	};
+}
+
+TEMPLATE_TEST_CASE("Cache API: Move semantics", "[cache][move]", CACHE_REPLACEMENT_POLICIES)
+{
+	constexpr size_t MAX_SIZE = 4;
+	Cache<std::string, CopyCounter, TestType::template apply> cache(MAX_SIZE);
+
+	CopyCounter::Copies = 0;
+
+	SECTION("insert() of rvalues does not copy the value")
+	{
+		for(int i = 0; i < 2 * (int)MAX_SIZE; i++)
+		{
+			CopyCounter value("value");
+			cache.insert(std::to_string(i), std::move(value));
+		}
+
+		CHECK(CopyCounter::Copies == 0);
+		CHECK(cache.size() == MAX_SIZE);
+	}
+
+	SECTION("insert() of an rvalue pair does not copy the value")
+	{
+		cache.insert(std::make_pair(std::string("key"), CopyCounter("value")));
+		CHECK(CopyCounter::Copies == 0);
+	}
+
+	SECTION("operator[], try_emplace() and emplace() do not copy the value")
+	{
+		cache["key 1"] = CopyCounter("value");
+		cache.try_emplace("key 2", "value");
+		cache.emplace("key 3", CopyCounter("value"));
+
+		CHECK(CopyCounter::Copies == 0);
+		CHECK(cache.size() == 3);
+	}
+
+	SECTION("insert_or_assign() and get_or_insert_with() do not copy the value")
+	{
+		cache.insert_or_assign("key", CopyCounter("value 1"));
+		cache.insert_or_assign("key", CopyCounter("value 2"));
+		cache.get_or_insert_with("key 2", []() { return CopyCounter("value"); });
+
+		CHECK(CopyCounter::Copies == 0);
+		CHECK(cache.at("key").data == "value 2");
+	}
+
+	SECTION("insert() of rvalues only copies the key into the policy")
+	{
+		// Policies own copies of their keys (some of them in more than one
+		// container), so count those on a bare policy first
+		typename TestType::template apply<CopyCountingKey> policy;
+		detail::reserve(policy, MAX_SIZE);
+		CopyCountingKey::Copies = 0;
+
+		for(int i = 0; i < (int)MAX_SIZE; i++)
+			detail::insert(policy, CopyCountingKey(std::to_string(i)), 1);
+
+		const int policy_copies = CopyCountingKey::Copies;
+		REQUIRE(policy_copies > 0);
+
+		// The cache itself moves the key into the storage and the value too
+		Cache<CopyCountingKey, CopyCounter, TestType::template apply> keyed(MAX_SIZE);
+		CopyCountingKey::Copies = 0;
+
+		for(int i = 0; i < (int)MAX_SIZE; i++)
+		{
+			CopyCountingKey key(std::to_string(i));
+			CopyCounter value("value");
+			keyed.insert(std::move(key), std::move(value));
+		}
+
+		CHECK(CopyCountingKey::Copies == policy_copies);
+		CHECK(CopyCounter::Copies == 0);
+		CHECK(keyed.size() == MAX_SIZE);
+	}
+
+	SECTION("insert() of lvalues copies the value once")
+	{
+		CopyCounter value("value");
+		cache.insert("key", value);
+
+		CHECK(CopyCounter::Copies == 1);
+	}
+}
+
 TEMPLATE_TEST_CASE("Cache API: find()", "[cache][find]", CACHE_REPLACEMENT_POLICIES)
 {
 	constexpr size_t MAX_SIZE = 128;
@@ -616,6 +994,35 @@ TEMPLATE_TEST_CASE("Cache API: count()", "[cache][count]", CACHE_REPLACEMENT_POL
 	}
 }
 
+TEMPLATE_TEST_CASE("Cache API: try_get()", "[cache][try_get]", CACHE_REPLACEMENT_POLICIES)
+{
+	constexpr size_t MAX_SIZE = 128;
+	Cache<std::string, int, TestType::template apply, NullLock, Stats::Basic> cache(MAX_SIZE);
+
+	for(size_t i = 1; i <= MAX_SIZE; i++)
+		cache.insert(std::to_string(i), (int)i);
+
+	SECTION("try_get() for an existing item copies its value")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+		{
+			int value = 0;
+			CHECK(cache.try_get(std::to_string(i), value) == true);
+			CHECK(value == (int)i);
+		}
+
+		CHECK(cache.hit_count() == MAX_SIZE);
+	}
+
+	SECTION("try_get() for a non-existing item leaves the value untouched")
+	{
+		int value = -1;
+		CHECK(cache.try_get("missing", value) == false);
+		CHECK(value == -1);
+		CHECK(cache.miss_count() == 1);
+	}
+}
+
 TEMPLATE_TEST_CASE("Cache API: flush()", "[cache][flush]", CACHE_REPLACEMENT_POLICIES)
 {
 	constexpr size_t MAX_SIZE = 128;
@@ -993,3 +1400,49 @@ TEMPLATE_TEST_CASE("Cache API: operator[]", "[cache][operator]", CACHE_REPLACEME
 		CHECK(cache.max_size() == MAX_SIZE);
 	}
 }
+
+TEMPLATE_TEST_CASE("Cache API: Transparent lookups", "[cache][transparent]", CACHE_REPLACEMENT_POLICIES)
+{
+	constexpr int MAX_SIZE = 16;
+	Cache<id_key, int, TestType::template apply, NullLock, Stats::Basic, id_storage> cache(MAX_SIZE);
+
+	for(int i = 0; i < MAX_SIZE; i++)
+		cache.insert(id_key(i), i);
+
+	const int conversions = id_key::conversions;
+
+	SECTION("Lookups never build a key")
+	{
+		for(int i = 0; i < 2 * MAX_SIZE; i++)
+		{
+			CHECK(cache.contains(i) == (i < MAX_SIZE));
+			CHECK(cache.count(i) == (i < MAX_SIZE ? 1U : 0U));
+			CHECK((cache.find(i) != cache.end()) == (i < MAX_SIZE));
+		}
+
+		CHECK(cache.at(3) == 3);
+		CHECK(cache.lookup(4) == 4);
+		CHECK_THROWS_AS(cache.at(MAX_SIZE), std::out_of_range);
+
+		CHECK(id_key::conversions == conversions);
+		CHECK(cache.hit_count() == 3 * MAX_SIZE);
+		CHECK(cache.miss_count() == 3 * MAX_SIZE);
+	}
+
+	SECTION("Erasing never builds a key")
+	{
+		CHECK(cache.erase(5) == 1);
+		CHECK(cache.erase(5) == 0);
+		CHECK_FALSE(cache.contains(5));
+
+		CHECK(id_key::conversions == conversions);
+		CHECK(cache.size() == MAX_SIZE - 1);
+		CHECK(cache.entry_invalidation_count() == 1);
+	}
+
+	SECTION("Iterators are still erased by position")
+	{
+		cache.erase(cache.begin());
+		CHECK(cache.size() == MAX_SIZE - 1);
+	}
+}
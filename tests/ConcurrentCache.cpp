@@ -0,0 +1,261 @@
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Cache/ConcurrentCache.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Stats/Concurrent.h"
+
+#include "catch2/catch.hpp"
+
+TEST_CASE("Concurrent cache: API", "[concurrent][api]")
+{
+	constexpr size_t MAX_SIZE = 128;
+	ConcurrentCache<std::string, int, Policy::LRU> cache(MAX_SIZE, 5);
+
+	SECTION("Segment count is rounded up to a power of two")
+	{
+		CHECK(cache.segment_count() == 8);
+		CHECK(cache.max_size() == MAX_SIZE);
+	}
+
+	SECTION("Inserted items can be found")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			CHECK(cache.insert(std::to_string(i), (int)i));
+
+		CHECK(cache.size() == MAX_SIZE);
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			CHECK(cache.lookup(std::to_string(i)) == (int)i);
+
+		CHECK(cache.hit_count() == MAX_SIZE);
+		CHECK(cache.miss_count() == 0);
+	}
+
+	SECTION("Missing keys are reported as misses")
+	{
+		int value = -1;
+
+		CHECK_FALSE(cache.contains("key"));
+		CHECK_FALSE(cache.try_get("key", value));
+		CHECK_THROWS_AS(cache.at("key"), std::out_of_range);
+
+		CHECK(value == -1);
+		CHECK(cache.count("key") == 0);
+		CHECK(cache.miss_count() == 4);
+		CHECK(cache.hit_count() == 0);
+	}
+
+	SECTION("insert() does not replace existing values")
+	{
+		CHECK(cache.insert("key", 1));
+		CHECK_FALSE(cache.insert("key", 2));
+
+		int value = 0;
+		CHECK(cache.try_get("key", value));
+		CHECK(value == 1);
+	}
+
+	SECTION("insert_or_assign() replaces existing values")
+	{
+		CHECK(cache.insert_or_assign("key", 1));
+		CHECK_FALSE(cache.insert_or_assign("key", 2));
+
+		CHECK(cache.at("key") == 2);
+		CHECK(cache.size() == 1);
+	}
+
+	SECTION("get_or_insert_with() only calls the factory on a miss")
+	{
+		int calls = 0;
+		auto factory = [&calls]() { return ++calls; };
+
+		CHECK(cache.get_or_insert_with("key", factory) == 1);
+		CHECK(cache.get_or_insert_with("key", factory) == 1);
+
+		CHECK(calls == 1);
+		CHECK(cache.hit_count() == 1);
+		CHECK(cache.miss_count() == 1);
+	}
+
+	SECTION("Size never exceeds max_size()")
+	{
+		for(size_t i = 1; i <= 10 * MAX_SIZE; i++)
+		{
+			cache.insert(std::to_string(i), (int)i);
+			REQUIRE(cache.size() <= cache.max_size());
+		}
+
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.evicted_count() == 9 * MAX_SIZE);
+	}
+
+	SECTION("erase() removes the key")
+	{
+		cache.insert("key", 1);
+		cache.contains("key");
+
+		CHECK(cache.erase("key") == 1);
+		CHECK(cache.erase("key") == 0);
+		CHECK(cache.empty());
+		CHECK(cache.entry_invalidation_count() == 1);
+	}
+
+	SECTION("clear() empties every segment")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.contains(std::to_string(i));
+
+		cache.clear();
+
+		CHECK(cache.size() == 0);
+		CHECK(cache.empty());
+		CHECK_FALSE(cache.contains("1"));
+		CHECK(cache.cache_invalidation_count() == 1);
+
+		// The policy must have been cleared as well
+		for(size_t i = 1; i <= 2 * MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		CHECK(cache.size() == MAX_SIZE);
+	}
+}
+
+TEST_CASE("Concurrent cache: Buffered reads", "[concurrent][policy]")
+{
+	constexpr size_t MAX_SIZE = 16;
+	ConcurrentCache<int, int, Policy::LRU> cache(MAX_SIZE, 4);
+
+	for(int i = 0; i < (int)MAX_SIZE; i++)
+		cache.insert(i, i);
+
+	SECTION("Pending reads are applied before the next write")
+	{
+		// Without the read, key 0 would be the least recently used one
+		CHECK(cache.contains(0));
+		cache.insert(100, 100);
+
+		CHECK(cache.contains(0));
+		CHECK_FALSE(cache.contains(1));
+	}
+
+	SECTION("drain_buffers() applies pending reads")
+	{
+		for(int i = 0; i < (int)MAX_SIZE / 2; i++)
+			cache.contains(i);
+
+		cache.drain_buffers();
+
+		for(int i = 0; i < (int)MAX_SIZE / 2; i++)
+			cache.insert(100 + i, i);
+
+		for(int i = 0; i < (int)MAX_SIZE / 2; i++)
+		{
+			CHECK(cache.contains(i));
+			CHECK_FALSE(cache.contains((int)MAX_SIZE / 2 + i));
+		}
+	}
+
+	SECTION("Reads are dropped, never blocked, when the buffers are full")
+	{
+		for(int round = 0; round < 100; round++)
+			for(int i = 0; i < (int)MAX_SIZE; i++)
+				REQUIRE(cache.contains(i));
+
+		CHECK(cache.hit_count() == 100 * MAX_SIZE);
+		CHECK(cache.size() == MAX_SIZE);
+	}
+}
+
+TEST_CASE("Concurrent cache: Concurrent access", "[concurrent][thread]")
+{
+	constexpr size_t MAX_SIZE = 512;
+	constexpr int THREADS = 4;
+	constexpr int ITEMS = 4000;
+
+	ConcurrentCache<int, int, Policy::LRU> cache(MAX_SIZE);
+	std::vector<std::thread> threads;
+	std::atomic<int> inserted{0};
+	std::atomic<int> wrong_values{0};
+
+	for(int t = 0; t < THREADS; t++)
+	{
+		threads.emplace_back([&cache, &inserted, &wrong_values, t]()
+		{
+			for(int i = 0; i < ITEMS; i++)
+			{
+				// Mostly reads, with some writes evicting entries other
+				// threads may have just read
+				if(i % 8 == 0 && cache.insert(t * ITEMS + i, i)) inserted++;
+				if(i % 64 == 0) cache.erase(t * ITEMS + i / 2);
+
+				int value = 0;
+				if(cache.try_get(t * ITEMS + i / 2, value) && value != i / 2)
+					wrong_values++;
+
+				cache.contains(i);
+			}
+		});
+	}
+
+	for(auto& thread : threads)
+		thread.join();
+
+	cache.drain_buffers();
+
+	CHECK(wrong_values == 0);
+	CHECK(cache.size() <= MAX_SIZE);
+	CHECK(cache.access_count() == 2 * THREADS * ITEMS);
+	CHECK(cache.evicted_count() + cache.entry_invalidation_count() + cache.size() == (size_t)inserted);
+}
+
+TEST_CASE("Concurrent statistics", "[concurrent][stats]")
+{
+	constexpr int THREADS = 4;
+	constexpr int EVENTS = 10000;
+
+	Stats::Concurrent<int, int> stats;
+	std::vector<std::thread> threads;
+
+	for(int t = 0; t < THREADS; t++)
+	{
+		threads.emplace_back([&stats]()
+		{
+			for(int i = 0; i < EVENTS; i++)
+			{
+				stats.hit(i, i);
+				if(i % 2 == 0) stats.miss(i);
+				if(i % 4 == 0) stats.evict(i, i);
+			}
+		});
+	}
+
+	for(auto& thread : threads)
+		thread.join();
+
+	SECTION("Counters are summed over all threads")
+	{
+		CHECK(stats.hit_count() == THREADS * EVENTS);
+		CHECK(stats.miss_count() == THREADS * EVENTS / 2);
+		CHECK(stats.evicted_count() == THREADS * EVENTS / 4);
+		CHECK(stats.entry_invalidation_count() == 0);
+	}
+
+	SECTION("Copies keep the counters")
+	{
+		Stats::Concurrent<int, int> copy(stats);
+		stats.clear();
+
+		CHECK(copy.hit_count() == THREADS * EVENTS);
+		CHECK(copy.cache_invalidation_count() == 0);
+
+		copy = stats;
+		CHECK(copy.cache_invalidation_count() == 1);
+	}
+}
@@ -0,0 +1,279 @@
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#include "Cache/Cache.h"
+#include "Cache/ShardedCache.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/detail/timing_wheel.h"
+
+#include "catch2/catch.hpp"
+
+using namespace std::chrono_literals;
+
+// Clock that only moves when told to
+struct FakeClock
+{
+	using duration   = std::chrono::milliseconds;
+	using rep        = duration::rep;
+	using period     = duration::period;
+	using time_point = std::chrono::time_point<FakeClock>;
+
+	static constexpr bool is_steady = true;
+	static duration current;
+
+	static time_point now() noexcept { return time_point(current); }
+	static void advance(duration d) noexcept { current += d; }
+};
+
+FakeClock::duration FakeClock::current{ 1000000 };
+
+using ExpiringCache = Cache<std::string, int, Policy::LRU, NullLock, Stats::Basic, std::unordered_map, UnitWeigher, FakeClock>;
+
+TEST_CASE("Cache expiration: time to live", "[cache][ttl]")
+{
+	constexpr size_t MAX_SIZE = 128;
+	ExpiringCache cache(MAX_SIZE);
+
+	SECTION("Entries never expire by default")
+	{
+		cache.insert("key", 1);
+		FakeClock::advance(24h);
+
+		CHECK(cache.contains("key") == true);
+		CHECK(cache.expired_count() == 0);
+	}
+
+	SECTION("Entries expire after the default time to live")
+	{
+		cache.set_default_ttl(30s);
+		CHECK(cache.default_ttl() == 30s);
+
+		cache.insert("key", 1);
+
+		FakeClock::advance(29s);
+		CHECK(cache.contains("key") == true);
+
+		FakeClock::advance(1s);
+		CHECK(cache.contains("key") == false);
+		CHECK(cache.find("key") == cache.end());
+
+		CHECK(cache.size() == 0);
+		CHECK(cache.expired_count() == 1);
+		CHECK(cache.evicted_count() == 0);
+		CHECK(cache.entry_invalidation_count() == 0);
+		CHECK(cache.hit_count() == 1);
+		CHECK(cache.miss_count() == 2);
+	}
+
+	SECTION("Entries can have their own time to live")
+	{
+		cache.set_default_ttl(30s);
+
+		cache.insert("short", 1, 5s);
+		cache.insert("long", 2, 60s);
+		cache.insert("default", 3);
+
+		FakeClock::advance(10s);
+		CHECK(cache.contains("short") == false);
+		CHECK(cache.contains("default") == true);
+
+		FakeClock::advance(30s);
+		CHECK(cache.contains("default") == false);
+		CHECK(cache.contains("long") == true);
+
+		FakeClock::advance(30s);
+		CHECK(cache.contains("long") == false);
+	}
+
+	SECTION("set_ttl() changes the time to live of an existing entry")
+	{
+		cache.insert("key", 1, 5s);
+
+		CHECK(cache.set_ttl("key", 10s) == true);
+		CHECK(cache.set_ttl("missing", 10s) == false);
+
+		FakeClock::advance(6s);
+		CHECK(cache.contains("key") == true);
+
+		CHECK(cache.set_ttl("key", 0s) == true);
+		FakeClock::advance(1h);
+		CHECK(cache.contains("key") == true);
+	}
+
+	SECTION("at() throws for expired entries")
+	{
+		cache.insert("key", 1, 1s);
+		CHECK(cache.at("key") == 1);
+
+		FakeClock::advance(1s);
+		CHECK_THROWS_AS(cache.at("key"), std::out_of_range);
+	}
+
+	SECTION("Expired entries are replaced on insertion")
+	{
+		cache.insert("key", 1, 1s);
+		FakeClock::advance(1s);
+
+		auto pair = cache.insert("key", 2);
+		CHECK(pair.second == true);
+		CHECK(cache.at("key") == 2);
+
+		CHECK(cache.emplace("other", 3).second == true);
+		cache.set_ttl("other", 1s);
+		FakeClock::advance(1s);
+		CHECK(cache.emplace("other", 4).second == true);
+		CHECK(cache.at("other") == 4);
+
+		cache.set_ttl("key", 1s);
+		FakeClock::advance(1s);
+		CHECK(cache.get_or_insert_with("key", []() { return 5; }) == 5);
+		CHECK(cache.expired_count() == 3);
+	}
+
+	SECTION("insert_or_assign() restarts the default time to live")
+	{
+		cache.set_default_ttl(10s);
+		cache.insert("key", 1);
+
+		FakeClock::advance(8s);
+		cache.insert_or_assign("key", 2);
+
+		FakeClock::advance(8s);
+		CHECK(cache.contains("key") == true);
+	}
+
+	SECTION("Erased entries do not keep their time to live")
+	{
+		cache.insert("key", 1, 1s);
+		cache.erase("key");
+		cache.insert("key", 2);
+
+		FakeClock::advance(2s);
+		CHECK(cache.contains("key") == true);
+	}
+
+	SECTION("Expired entries are reclaimed before evicting live ones")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i, i <= 10 ? 1s : 1h);
+
+		FakeClock::advance(2s);
+
+		for(size_t i = 1; i <= 10; i++)
+			cache.insert("new " + std::to_string(i), (int)i);
+
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.expired_count() == 10);
+		CHECK(cache.evicted_count() == 0);
+	}
+
+	SECTION("purge_expired() removes all expired entries")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i, std::chrono::milliseconds(i * 100));
+
+		FakeClock::advance(6400ms);
+
+		CHECK(cache.purge_expired() == MAX_SIZE / 2);
+		CHECK(cache.size() == MAX_SIZE / 2);
+		CHECK(cache.expired_count() == MAX_SIZE / 2);
+
+		// After a long time, the wheel is rebuilt instead of ticking through it
+		FakeClock::advance(100h);
+		CHECK(cache.purge_expired() == MAX_SIZE / 2);
+		CHECK(cache.empty());
+	}
+
+	SECTION("Copies keep the time to live of their entries")
+	{
+		cache.insert("key", 1, 10s);
+
+		auto copy = cache;
+		cache.clear();
+
+		FakeClock::advance(5s);
+		CHECK(copy.contains("key") == true);
+
+		FakeClock::advance(5s);
+		CHECK(copy.contains("key") == false);
+	}
+
+	SECTION("Sharded caches expire entries too")
+	{
+		ShardedCache<std::string, int, Policy::LRU, NullLock, Stats::Basic, std::unordered_map, UnitWeigher, FakeClock> sharded(MAX_SIZE, 4);
+		sharded.set_default_ttl(1s);
+
+		for(size_t i = 1; i <= 16; i++)
+			sharded.insert(std::to_string(i), (int)i);
+
+		FakeClock::advance(1s);
+		CHECK(sharded.purge_expired() == 16);
+		CHECK(sharded.expired_count() == 16);
+		CHECK(sharded.empty());
+	}
+}
+
+TEST_CASE("Cache expiration: timing wheel", "[ttl][wheel]")
+{
+	using wheel_type = detail::timing_wheel<int, FakeClock>;
+	using time_point = FakeClock::time_point;
+
+	std::mt19937 gen(1234);
+
+	// Deadlines from a few milliseconds to several days away, so that keys
+	// are spread over many levels of the wheel
+	std::uniform_int_distribution<int> exponent(0, 29);
+	const auto random_ttl = [&]()
+	{
+		const auto max = std::int64_t{1} << exponent(gen);
+		return FakeClock::duration(std::uniform_int_distribution<std::int64_t>(1, max)(gen));
+	};
+
+	wheel_type wheel;
+	std::map<int, time_point> deadlines;
+	time_point now = FakeClock::now();
+
+	for(int round = 0; round < 2000; round++)
+	{
+		const int key = std::uniform_int_distribution<int>(0, 499)(gen);
+
+		switch(round % 4)
+		{
+			case 0:
+			case 1:
+				deadlines[key] = now + random_ttl();
+				wheel.schedule(key, deadlines[key], now);
+				break;
+
+			case 2:
+				deadlines.erase(key);
+				wheel.cancel(key);
+				break;
+
+			default:
+			{
+				now += random_ttl();
+
+				std::set<int> expected;
+				for(const auto& p : deadlines)
+					if(p.second <= now) expected.insert(p.first);
+
+				std::set<int> expired;
+				wheel.advance(now, [&](int k) { expired.insert(k); });
+
+				REQUIRE(expired == expected);
+
+				for(int k : expired)
+					deadlines.erase(k);
+
+				REQUIRE(wheel.size() == deadlines.size());
+				break;
+			}
+		}
+	}
+}
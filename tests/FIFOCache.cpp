@@ -75,4 +75,44 @@ TEST_CASE("Cache w/ FIFO replacement policy: FIFO behaviour", "[cache][behaviour
 		CHECK(cache.contains("1") == false);
 		CHECK(cache.evicted_count() == 1);
 	}
+
+	SECTION("Erasing an item keeps the order of the rest")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		CHECK(cache.erase("2") == 1);
+		CHECK(cache.erase("64") == 1);
+
+		cache.insert("asdf", 42);
+		cache.insert("qwer", 42);
+		CHECK(cache.evicted_count() == 0);
+
+		cache.insert("zxcv", 42);
+		CHECK(cache.contains("1") == false);
+		CHECK(cache.contains("3") == true);
+
+		cache.insert("uiop", 42);
+		CHECK(cache.contains("3") == false);
+		CHECK(cache.contains("4") == true);
+		CHECK(cache.evicted_count() == 2);
+	}
+
+	SECTION("Copies keep the order of the original")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		auto copy = cache;
+		cache.clear();
+
+		copy.insert("asdf", 42);
+		CHECK(copy.contains("1") == false);
+
+		copy.erase("3");
+		copy.insert("qwer", 42);
+		copy.insert("zxcv", 42);
+		CHECK(copy.contains("2") == false);
+		CHECK(copy.contains("4") == true);
+	}
 }
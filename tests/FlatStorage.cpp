@@ -0,0 +1,310 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "Cache/Cache.h"
+#include "Cache/Policy/FIFO.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Policy/WTinyLFU.h"
+#include "Cache/Storage/Flat.h"
+#include "Cache/Storage/String.h"
+
+#include "catch2/catch.hpp"
+
+// All keys collide in the same group, to exercise probing and tombstones
+struct BadHash
+{
+	size_t operator()(int) const noexcept { return 0; }
+};
+
+TEST_CASE("Flat storage: Basic operations", "[flat][storage]")
+{
+	Storage::Flat<std::string, int> map;
+
+	CHECK(map.empty());
+	CHECK(map.begin() == map.end());
+	CHECK(map.find("key") == map.end());
+
+	SECTION("Inserted items can be found")
+	{
+		for(int i = 0; i < 1000; i++)
+			REQUIRE(map.emplace(std::to_string(i), i).second == true);
+
+		CHECK(map.size() == 1000);
+
+		for(int i = 0; i < 1000; i++)
+		{
+			auto it = map.find(std::to_string(i));
+			REQUIRE(it != map.end());
+			CHECK(it->second == i);
+		}
+
+		CHECK(map.count("1000") == 0);
+		CHECK_THROWS_AS(map.at("1000"), std::out_of_range);
+	}
+
+	SECTION("Inserting an existing key does not overwrite it")
+	{
+		map.insert({ "key", 1 });
+		auto pair = map.emplace("key", 2);
+
+		CHECK(pair.second == false);
+		CHECK(pair.first->second == 1);
+		CHECK(map.size() == 1);
+	}
+
+	SECTION("Erased items are no longer found")
+	{
+		for(int i = 0; i < 100; i++)
+			map[std::to_string(i)] = i;
+
+		for(int i = 0; i < 100; i += 2)
+			CHECK(map.erase(std::to_string(i)) == 1);
+
+		CHECK(map.size() == 50);
+		CHECK(map.erase("0") == 0);
+
+		for(int i = 0; i < 100; i++)
+			CHECK(map.count(std::to_string(i)) == (size_t)(i % 2));
+	}
+
+	SECTION("Iteration visits every item exactly once")
+	{
+		for(int i = 0; i < 100; i++)
+			map[std::to_string(i)] = i;
+
+		int sum = 0;
+		size_t count = 0;
+		for(const auto& p : map)
+		{
+			sum += p.second;
+			count++;
+		}
+
+		CHECK(count == 100);
+		CHECK(sum == 99 * 100 / 2);
+	}
+
+	SECTION("erase(iterator) returns the next item")
+	{
+		for(int i = 0; i < 100; i++)
+			map[std::to_string(i)] = i;
+
+		for(auto it = map.begin(); it != map.end();)
+			it = (it->second % 3 == 0 ? map.erase(it) : std::next(it));
+
+		CHECK(map.size() == 66);
+	}
+
+	SECTION("Copies are independent")
+	{
+		map["a"] = 1;
+
+		auto copy = map;
+		copy["b"] = 2;
+		map.erase("a");
+
+		CHECK(copy.size() == 2);
+		CHECK(copy.at("a") == 1);
+		CHECK(map.empty());
+	}
+}
+
+TEST_CASE("Flat storage: Capacity", "[flat][storage]")
+{
+	SECTION("reserve() allocates enough slots upfront")
+	{
+		Storage::Flat<int, int> map;
+		map.reserve(1000);
+
+		const auto capacity = map.capacity();
+		CHECK(capacity >= 1000);
+
+		for(int i = 0; i < 1000; i++)
+			map[i] = i;
+
+		CHECK(map.capacity() == capacity);
+	}
+
+	SECTION("Tombstones do not make the table grow")
+	{
+		Storage::Flat<int, int, BadHash> map(16);
+		const auto capacity = map.capacity();
+
+		for(int i = 0; i < 10000; i++)
+		{
+			map[i] = i;
+			if(i >= 8) map.erase(i - 8);
+
+			REQUIRE(map.size() == (i >= 8 ? 8U : (size_t)i + 1));
+		}
+
+		CHECK(map.capacity() == capacity);
+
+		for(int i = 10000 - 8; i < 10000; i++)
+			CHECK(map.at(i) == i);
+	}
+
+	SECTION("Values are destroyed")
+	{
+		auto value = std::make_shared<int>(42);
+
+		{
+			Storage::Flat<int, std::shared_ptr<int>> map;
+			for(int i = 0; i < 100; i++)
+				map[i] = value;
+
+			map.erase(0);
+			CHECK(value.use_count() == 100);
+		}
+
+		CHECK(value.use_count() == 1);
+	}
+}
+
+TEST_CASE("Flat storage: Cache integration", "[flat][cache]")
+{
+	constexpr size_t MAX_SIZE = 100;
+
+	SECTION("Bounded caches are sized once")
+	{
+		Cache<int, int, Policy::LRU, NullLock, Stats::Basic, Storage::Flat> cache(MAX_SIZE);
+
+		for(int i = 0; i < 10 * (int)MAX_SIZE; i++)
+		{
+			cache.insert(i, i);
+			REQUIRE(cache.size() <= MAX_SIZE);
+		}
+
+		CHECK(cache.evicted_count() == 9 * MAX_SIZE);
+
+		for(int i = 9 * (int)MAX_SIZE; i < 10 * (int)MAX_SIZE; i++)
+			CHECK(cache.contains(i));
+	}
+
+	SECTION("Flat and node-based storage behave the same")
+	{
+		Cache<int, std::string, Policy::FIFO> reference(MAX_SIZE);
+		Cache<int, std::string, Policy::FIFO, NullLock, Stats::Basic, Storage::Flat> flat(MAX_SIZE);
+
+		for(int i = 0; i < 1000; i++)
+		{
+			const int key = (i * 7919) % 300;
+
+			reference.insert(key, std::to_string(i));
+			flat.insert(key, std::to_string(i));
+
+			if(i % 5 == 0)
+			{
+				reference.erase(key / 2);
+				flat.erase(key / 2);
+			}
+		}
+
+		REQUIRE(flat.size() == reference.size());
+
+		for(const auto& p : reference)
+		{
+			REQUIRE(flat.contains(p.first));
+			CHECK(flat.at(p.first) == p.second);
+		}
+	}
+
+	SECTION("Rejected insertions leave the storage untouched")
+	{
+		Cache<int, int, Policy::WTinyLFU, NullLock, Stats::Basic, Storage::Flat> cache(MAX_SIZE, Policy::WTinyLFU<int>(0.0f));
+
+		for(int i = 0; i < 1000; i++)
+			cache.emplace(i, i);
+
+		CHECK(cache.size() == MAX_SIZE);
+	}
+
+	SECTION("get_or_insert_with() leaves no trace if the factory throws")
+	{
+		Cache<int, int, Policy::LRU, NullLock, Stats::Basic, Storage::Flat> cache(MAX_SIZE);
+
+		CHECK_THROWS(cache.get_or_insert_with(1, []() -> int { throw std::runtime_error("error"); }));
+		CHECK(cache.size() == 0);
+		CHECK(cache.begin() == cache.end());
+
+		CHECK(cache.get_or_insert_with(1, []() { return 42; }) == 42);
+		CHECK(cache.size() == 1);
+	}
+
+	SECTION("std::erase_if() works with flat storage")
+	{
+		Cache<int, int, Policy::LRU, NullLock, Stats::Basic, Storage::Flat> cache(MAX_SIZE);
+
+		for(int i = 0; i < (int)MAX_SIZE; i++)
+			cache[i] = i;
+
+		std::erase_if(cache, [](const std::pair<const int, int>& p) { return p.second % 2 == 0; });
+		CHECK(cache.size() == MAX_SIZE / 2);
+	}
+}
+
+TEST_CASE("Flat storage: Transparent lookups", "[flat][transparent]")
+{
+	Storage::FlatStringMap<std::string, int> map;
+	map.try_emplace("a long key that does not fit in the small string buffer", 1);
+	map.try_emplace("short", 2);
+
+	SECTION("C strings and std::string get the same hash")
+	{
+		Storage::string_hash hash;
+		CHECK(hash("short") == hash(std::string("short")));
+		CHECK(hash("short") != hash("shorT"));
+		CHECK(hash("") == hash(std::string()));
+	}
+
+	SECTION("Keys can be looked up with C strings")
+	{
+		CHECK(map.count("short") == 1);
+		CHECK(map.count("missing") == 0);
+		CHECK(map.find("a long key that does not fit in the small string buffer")->second == 1);
+		CHECK(map.find("missing") == map.end());
+
+		CHECK(map.erase("short") == 1);
+		CHECK(map.erase("short") == 0);
+		CHECK(map.size() == 1);
+	}
+
+	SECTION("Caches with transparent storage take C strings")
+	{
+		Cache<std::string, int, Policy::LRU, NullLock, Stats::Basic, Storage::FlatStringMap> cache(2);
+		cache.insert("first", 1);
+		cache.insert("second", 2);
+
+		CHECK(cache.contains("first"));
+		cache.insert("third", 3);
+
+		// "first" was touched through a C string, so "second" was evicted
+		CHECK(cache.at("first") == 1);
+		CHECK_FALSE(cache.contains("second"));
+		CHECK(cache.miss_count() == 1);
+	}
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+	SECTION("Caches with StringMap storage take string views")
+	{
+		// Before C++20, std::unordered_map can only find a std::string
+		Cache<std::string, int, Policy::LRU, NullLock, Stats::Basic, Storage::StringMap> cache(2);
+		cache.insert("first", 1);
+		cache.insert("second", 2);
+
+		const std::string key = "first key";
+		const std::string_view first(key.data(), 5);
+
+		CHECK(cache.contains(first));
+		CHECK(cache.count(std::string_view("missing")) == 0);
+		cache.insert("third", 3);
+
+		CHECK(cache.at(first) == 1);
+		CHECK(cache.find(std::string_view("second")) == cache.end());
+		CHECK(cache.erase(first) == 1);
+		CHECK(cache.size() == 1);
+	}
+#endif
+}
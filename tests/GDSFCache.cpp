@@ -0,0 +1,120 @@
+#include <string>
+
+#include "Cache/Cache.h"
+#include "Cache/Policy/GDSF.h"
+
+#include "catch2/catch.hpp"
+
+namespace
+{
+	struct StringWeigher
+	{
+		size_t operator()(const std::string&, const std::string& value) const noexcept { return value.size(); }
+	};
+
+	using WeightedCache = Cache<std::string, std::string, Policy::GDSF, NullLock, Stats::Basic, std::unordered_map, StringWeigher>;
+}
+
+TEST_CASE("Cache w/ GDSF replacement policy: GDSF behaviour", "[cache][behaviour][gdsf]")
+{
+	SECTION("Heavy items are evicted before light ones")
+	{
+		WeightedCache cache(1000);
+
+		cache.insert("light 1", std::string(10, 'x'));
+		cache.insert("heavy", std::string(500, 'x'));
+		cache.insert("light 2", std::string(10, 'x'));
+		cache.insert("medium", std::string(400, 'x'));
+
+		cache.insert("new", std::string(100, 'x'));
+		CHECK(cache.contains("heavy") == false);
+		CHECK(cache.contains("light 1") == true);
+		CHECK(cache.contains("light 2") == true);
+		CHECK(cache.contains("medium") == true);
+		CHECK(cache.evicted_count() == 1);
+	}
+
+	SECTION("Frequently used items are kept even if they are heavy")
+	{
+		WeightedCache cache(1000);
+
+		cache.insert("heavy", std::string(200, 'x'));
+		for(int i = 0; i < 100; i++)
+			cache.contains("heavy");
+
+		for(size_t i = 1; i <= 100; i++)
+			cache.insert(std::to_string(i), std::string(50, 'x'));
+
+		CHECK(cache.contains("heavy") == true);
+	}
+
+	SECTION("Assigning a value of a different weight keeps the frequency of the item")
+	{
+		WeightedCache cache(1000);
+
+		cache.insert("heavy", std::string(200, 'x'));
+		for(int i = 0; i < 100; i++)
+			cache.contains("heavy");
+
+		cache.insert_or_assign("heavy", std::string(300, 'x'));
+
+		for(size_t i = 1; i <= 100; i++)
+			cache.insert(std::to_string(i), std::string(50, 'x'));
+
+		CHECK(cache.contains("heavy") == true);
+		CHECK(cache.weight() <= 1000);
+	}
+
+	SECTION("With equal weights, the least frequently used item is evicted")
+	{
+		constexpr size_t MAX_SIZE = 128;
+		Cache<std::string, int, Policy::GDSF> cache(MAX_SIZE);
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			if(i != 64) cache.contains(std::to_string(i));
+
+		cache.insert("asdf", 42);
+		CHECK(cache.contains("64") == false);
+		CHECK(cache.evicted_count() == 1);
+	}
+
+	SECTION("Old items age out")
+	{
+		constexpr size_t MAX_SIZE = 16;
+		Cache<std::string, int, Policy::GDSF> cache(MAX_SIZE);
+
+		// Once popular item, never used again
+		cache.insert("old", 0);
+		for(int i = 0; i < 10; i++)
+			cache.contains("old");
+
+		// New items are used a couple of times each
+		for(size_t i = 1; i <= 50 * MAX_SIZE; i++)
+		{
+			cache.insert(std::to_string(i), (int)i);
+			cache.contains(std::to_string(i));
+		}
+
+		CHECK(cache.contains("old") == false);
+	}
+
+	SECTION("Copies keep the priorities of the original")
+	{
+		WeightedCache cache(1000);
+
+		cache.insert("light", std::string(10, 'x'));
+		cache.insert("heavy", std::string(500, 'x'));
+		cache.insert("medium", std::string(400, 'x'));
+
+		auto copy = cache;
+		cache.clear();
+
+		copy.insert("new", std::string(100, 'x'));
+		CHECK(copy.contains("heavy") == false);
+		CHECK(copy.contains("light") == true);
+		CHECK(copy.contains("medium") == true);
+	}
+}
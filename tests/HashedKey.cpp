@@ -0,0 +1,150 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Cache/Cache.h"
+#include "Cache/HashedKey.h"
+#include "Cache/ShardedCache.h"
+#include "Cache/Policy/ARC.h"
+#include "Cache/Policy/FIFO.h"
+#include "Cache/Policy/GDSF.h"
+#include "Cache/Policy/LFU.h"
+#include "Cache/Policy/LIFO.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Policy/MRU.h"
+#include "Cache/Policy/Random.h"
+#include "Cache/Policy/WTinyLFU.h"
+#include "Cache/Storage/Flat.h"
+
+#include "catch2/catch.hpp"
+
+template<template<typename> class Template>
+struct wrapper
+{
+	template<typename Args>
+	using apply = Template<Args>;
+};
+
+// Counts how many times a key is hashed
+struct counting_hash
+{
+	static int calls;
+
+	size_t operator()(const std::string& str) const
+	{
+		calls++;
+		return std::hash<std::string>{}(str);
+	}
+};
+
+int counting_hash::calls = 0;
+
+using key_type = HashedKey<std::string, counting_hash>;
+
+std::vector<key_type> make_keys(int count)
+{
+	std::vector<key_type> keys;
+	for(int i = 0; i < count; i++)
+		keys.emplace_back(std::string(200, 'k') + std::to_string(i));
+
+	return keys;
+}
+
+// Inserts twice as many keys as the cache holds, looking up and erasing some
+template<typename CacheType>
+void exercise(CacheType& cache, const std::vector<key_type>& keys)
+{
+	for(size_t i = 0; i < keys.size(); i++)
+	{
+		cache.insert(keys[i], (int)i);
+		cache.contains(keys[i / 2]);
+		cache.count(keys[i / 3]);
+
+		if(i % 7 == 0) cache.erase(keys[i / 4]);
+	}
+}
+
+TEMPLATE_TEST_CASE("Hashed keys: Keys are hashed only once", "[hashed]",
+	wrapper<Policy::ARC>, wrapper<Policy::FIFO>, wrapper<Policy::GDSF>, wrapper<Policy::LFU>, wrapper<Policy::LIFO>,
+	wrapper<Policy::LRU>, wrapper<Policy::MRU>, wrapper<Policy::Random>, wrapper<Policy::WTinyLFU>)
+{
+	constexpr size_t MAX_SIZE = 64;
+	const auto keys = make_keys(2 * MAX_SIZE);
+
+	counting_hash::calls = 0;
+
+	SECTION("Node-based storage")
+	{
+		Cache<key_type, int, TestType::template apply> cache(MAX_SIZE);
+		exercise(cache, keys);
+
+		CHECK(cache.evicted_count() > 0);
+		CHECK(counting_hash::calls == 0);
+	}
+
+	SECTION("Flat storage")
+	{
+		Cache<key_type, int, TestType::template apply, NullLock, Stats::Basic, Storage::Flat> cache(MAX_SIZE);
+		exercise(cache, keys);
+
+		CHECK(cache.evicted_count() > 0);
+		CHECK(counting_hash::calls == 0);
+	}
+
+	SECTION("Sharded cache")
+	{
+		ShardedCache<key_type, int, TestType::template apply> cache(MAX_SIZE, 4);
+		exercise(cache, keys);
+
+		CHECK(cache.evicted_count() > 0);
+		CHECK(counting_hash::calls == 0);
+	}
+}
+
+TEST_CASE("Hashed keys: API", "[hashed]")
+{
+	SECTION("Keys are hashed when they are created")
+	{
+		counting_hash::calls = 0;
+
+		key_type key(std::string("key"));
+		key_type copy = key;
+
+		CHECK(counting_hash::calls == 1);
+		CHECK(copy == key);
+		CHECK(std::hash<key_type>{}(copy) == std::hash<std::string>{}("key"));
+		CHECK(key.key() == "key");
+	}
+
+	SECTION("Keys are compared by value")
+	{
+		CHECK(key_type(std::string("a")) == key_type(std::string("a")));
+		CHECK(key_type(std::string("a")) != key_type(std::string("b")));
+		CHECK(key_type(std::string("a")) < key_type(std::string("b")));
+
+		// A hash given explicitly is trusted as it is
+		CHECK(key_type(std::string("a"), 1) != key_type(std::string("a"), 2));
+	}
+
+	SECTION("Snapshots save the key and hash it again when loaded")
+	{
+		const auto keys = make_keys(10);
+
+		Cache<key_type, int, Policy::LRU> cache(10);
+		for(size_t i = 0; i < keys.size(); i++)
+			cache.insert(keys[i], (int)i);
+
+		std::stringstream snapshot;
+		cache.save(snapshot);
+
+		counting_hash::calls = 0;
+
+		Cache<key_type, int, Policy::LRU> loaded(10);
+		loaded.load(snapshot);
+
+		CHECK(counting_hash::calls == 10);
+
+		for(size_t i = 0; i < keys.size(); i++)
+			CHECK(loaded.at(keys[i]) == (int)i);
+	}
+}
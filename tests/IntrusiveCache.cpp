@@ -0,0 +1,187 @@
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "Cache/Cache.h"
+#include "Cache/IntrusiveCache.h"
+#include "Cache/Policy/FIFO.h"
+#include "Cache/Policy/Intrusive.h"
+#include "Cache/Policy/LIFO.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Policy/MRU.h"
+
+#include "catch2/catch.hpp"
+
+// Key whose hash throws for negative values
+struct ThrowingKey
+{
+	int value;
+
+	bool operator==(const ThrowingKey& other) const { return value == other.value; }
+};
+
+namespace std
+{
+	template<> struct hash<ThrowingKey>
+	{
+		size_t operator()(const ThrowingKey& key) const
+		{
+			if(key.value < 0) throw std::invalid_argument("negative key");
+			return std::hash<int>{}(key.value);
+		}
+	};
+}
+
+template<template<typename> class Reference, typename Intrusive>
+struct policy_pair
+{
+	template<typename Key>
+	using reference = Reference<Key>;
+	using intrusive = Intrusive;
+};
+
+TEMPLATE_TEST_CASE("Intrusive cache: Same behavior as Cache", "[intrusive][policy]",
+	(policy_pair<Policy::FIFO, Policy::Intrusive::FIFO>),
+	(policy_pair<Policy::LIFO, Policy::Intrusive::LIFO>),
+	(policy_pair<Policy::LRU,  Policy::Intrusive::LRU >),
+	(policy_pair<Policy::MRU,  Policy::Intrusive::MRU >))
+{
+	constexpr size_t MAX_SIZE = 64;
+
+	Cache<int, std::string, TestType::template reference> reference(MAX_SIZE);
+	IntrusiveCache<int, std::string, typename TestType::intrusive> intrusive(MAX_SIZE);
+
+	for(int i = 0; i < 5000; i++)
+	{
+		const int key = (i * 7919) % 257;
+
+		switch(i % 4)
+		{
+			case 0:
+			case 1:
+				reference.insert(key, std::to_string(i));
+				intrusive.insert(key, std::to_string(i));
+				break;
+
+			case 2:
+				REQUIRE(intrusive.contains(key) == reference.contains(key));
+				break;
+
+			case 3:
+				REQUIRE(intrusive.erase(key / 2) == reference.erase(key / 2));
+				break;
+		}
+
+		REQUIRE(intrusive.size() == reference.size());
+	}
+
+	CHECK(intrusive.hit_count() == reference.hit_count());
+	CHECK(intrusive.miss_count() == reference.miss_count());
+	CHECK(intrusive.evicted_count() == reference.evicted_count());
+	CHECK(intrusive.entry_invalidation_count() == reference.entry_invalidation_count());
+
+	for(const auto& p : reference)
+	{
+		REQUIRE(intrusive.contains(p.first));
+		CHECK(intrusive.at(p.first) == p.second);
+	}
+}
+
+TEST_CASE("Intrusive cache: API", "[intrusive][api]")
+{
+	constexpr size_t MAX_SIZE = 16;
+	IntrusiveCache<std::string, int> cache(MAX_SIZE);
+
+	SECTION("Unbounded caches grow as needed")
+	{
+		IntrusiveCache<int, int> unbounded(0);
+
+		for(int i = 0; i < 10000; i++)
+			unbounded[i] = i;
+
+		CHECK(unbounded.size() == 10000);
+		CHECK(unbounded.evicted_count() == 0);
+
+		for(int i = 0; i < 10000; i++)
+			REQUIRE(unbounded.at(i) == i);
+	}
+
+	SECTION("emplace() constructs items in-place")
+	{
+		IntrusiveCache<int, std::string> strings(MAX_SIZE);
+
+		CHECK(strings.emplace(1, "aaaaa").second == true);
+		CHECK(strings.emplace(1, "bbbbb").second == false);
+		CHECK(strings.at(1) == "aaaaa");
+	}
+
+	SECTION("Iteration visits every item exactly once")
+	{
+		for(int i = 0; i < (int)MAX_SIZE; i++)
+			cache.insert(std::to_string(i), i);
+
+		int sum = 0;
+		size_t count = 0;
+		for(const auto& p : cache)
+		{
+			sum += p.second;
+			count++;
+		}
+
+		CHECK(count == MAX_SIZE);
+		CHECK(sum == (MAX_SIZE - 1) * MAX_SIZE / 2);
+	}
+
+	SECTION("erase(iterator) returns the next item")
+	{
+		for(int i = 0; i < (int)MAX_SIZE; i++)
+			cache.insert(std::to_string(i), i);
+
+		for(auto it = cache.begin(); it != cache.end();)
+			it = (it->second % 2 == 0 ? cache.erase(it) : std::next(it));
+
+		CHECK(cache.size() == MAX_SIZE / 2);
+		CHECK(cache.entry_invalidation_count() == MAX_SIZE / 2);
+	}
+
+	SECTION("clear() releases every entry")
+	{
+		auto value = std::make_shared<int>(42);
+		IntrusiveCache<int, std::shared_ptr<int>> pointers(MAX_SIZE);
+
+		for(int i = 0; i < 100; i++)
+			pointers.insert(i, value);
+
+		CHECK(value.use_count() == MAX_SIZE + 1);
+
+		pointers.clear();
+
+		CHECK(value.use_count() == 1);
+		CHECK(pointers.empty());
+		CHECK(pointers.cache_invalidation_count() == 1);
+
+		pointers[1] = value;
+		CHECK(pointers.size() == 1);
+	}
+
+	SECTION("emplace() releases the entry if hashing its key throws")
+	{
+		auto value = std::make_shared<int>(42);
+		IntrusiveCache<ThrowingKey, std::shared_ptr<int>> pointers(MAX_SIZE);
+
+		for(int i = 0; i < (int)MAX_SIZE; i++)
+			pointers.emplace(ThrowingKey{ i }, value);
+
+		CHECK_THROWS_AS(pointers.emplace(ThrowingKey{ -1 }, value), std::invalid_argument);
+		CHECK(value.use_count() == MAX_SIZE + 1);
+		CHECK(pointers.size() == MAX_SIZE);
+		CHECK(pointers.evicted_count() == 0);
+	}
+
+	SECTION("at() throws if the key is not found")
+	{
+		CHECK_THROWS_AS(cache.at("key"), std::out_of_range);
+		CHECK(cache.find("key") == cache.end());
+	}
+}
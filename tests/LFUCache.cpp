@@ -86,3 +86,127 @@ TEST_CASE("Cache w/ LFU replacement policy: LFU behaviour", "[cache][behaviour][
 		CHECK(cache.evicted_count() == 1);
 	}
 }
+
+TEST_CASE("Cache w/ LFU replacement policy: ties", "[cache][behaviour][lfu]")
+{
+	constexpr size_t MAX_SIZE = 128;
+	Cache<std::string, int, Policy::LFU> cache(MAX_SIZE);
+
+	SECTION("Among keys with the same frequency, the oldest one is replaced")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		cache.insert("asdf", 42);
+		CHECK(cache.contains("1") == false);
+
+		cache.insert("qwer", 42);
+		CHECK(cache.contains("2") == false);
+		CHECK(cache.evicted_count() == 2);
+	}
+
+	SECTION("Copied caches keep the frequency of each key")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		for(size_t i = 2; i <= MAX_SIZE; i++)
+			REQUIRE(cache.contains(std::to_string(i)) == true);
+
+		auto copy = cache;
+		copy.insert("asdf", 42);
+
+		CHECK(copy.contains("1") == false);
+		CHECK(copy.contains("2") == true);
+		CHECK(cache.contains("1") == true);
+	}
+}
+
+TEST_CASE("Cache w/ LFU replacement policy: weights", "[cache][behaviour][lfu][weight]")
+{
+	struct StringWeigher
+	{
+		size_t operator()(const std::string&, const std::string& value) const noexcept { return value.size(); }
+	};
+
+	Cache<std::string, std::string, Policy::LFU, NullLock, Stats::Basic, std::unordered_map, StringWeigher> cache(1000);
+
+	SECTION("Assigning a value of a different weight keeps the frequency of the key")
+	{
+		cache.insert("hot", std::string(100, 'x'));
+		for(int i = 0; i < 10; i++)
+			REQUIRE(cache.contains("hot") == true);
+
+		for(size_t i = 1; i <= 9; i++)
+			cache.insert(std::to_string(i), std::string(100, 'x'));
+
+		cache.insert_or_assign("hot", std::string(200, 'x'));
+		CHECK(cache.weight() == 1000);
+		CHECK(cache.evicted_count() == 1);
+
+		for(size_t i = 2; i <= 9; i++)
+			REQUIRE(cache.contains(std::to_string(i)) == true);
+
+		cache.insert("new", std::string(100, 'x'));
+		CHECK(cache.contains("hot") == true);
+	}
+
+	SECTION("An entry that grows heavier never evicts itself")
+	{
+		cache.insert("cold", std::string(100, 'x'));
+
+		for(size_t i = 1; i <= 9; i++)
+		{
+			cache.insert(std::to_string(i), std::string(100, 'x'));
+			REQUIRE(cache.contains(std::to_string(i)) == true);
+		}
+
+		auto pair = cache.insert_or_assign("cold", std::string(500, 'x'));
+		CHECK(pair.first->second.size() == 500);
+		CHECK(cache.at("cold").size() == 500);
+		CHECK(cache.weight() <= 1000);
+	}
+}
+
+TEST_CASE("Cache w/ LFU replacement policy: aging", "[cache][behaviour][lfu]")
+{
+	constexpr size_t MAX_SIZE = 4;
+
+	auto fill = [](auto& cache)
+	{
+		cache.insert("hot", 0);
+		for(int i = 0; i < 100; i++)
+			REQUIRE(cache.contains("hot"));
+
+		cache.insert("a", 1);
+		cache.insert("b", 2);
+		cache.insert("c", 3);
+
+		for(int round = 0; round < 20; round++)
+			for(const char* key : { "a", "b", "c", "a", "b", "c", "a", "b", "c" })
+				REQUIRE(cache.contains(key));
+
+		cache.insert("new", 4);
+	};
+
+	SECTION("Without aging, formerly hot keys are never replaced")
+	{
+		Cache<std::string, int, Policy::LFU> cache(MAX_SIZE);
+		fill(cache);
+
+		CHECK(cache.contains("hot") == true);
+		CHECK(cache.contains("new") == true);
+	}
+
+	SECTION("With aging, formerly hot keys are eventually replaced")
+	{
+		Cache<std::string, int, Policy::LFU> cache(MAX_SIZE, Policy::LFU<std::string>(MAX_SIZE * 2));
+		fill(cache);
+
+		CHECK(cache.contains("hot") == false);
+		CHECK(cache.contains("a") == true);
+		CHECK(cache.contains("b") == true);
+		CHECK(cache.contains("c") == true);
+		CHECK(cache.contains("new") == true);
+	}
+}
@@ -75,4 +75,43 @@ TEST_CASE("Cache w/ LIFO replacement policy: LIFO behaviour", "[cache][behaviour
 		CHECK(cache.contains("128") == false);
 		CHECK(cache.evicted_count() == 1);
 	}
+
+	SECTION("Erasing an item keeps the order of the rest")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		CHECK(cache.erase("2") == 1);
+		CHECK(cache.erase(std::to_string(MAX_SIZE)) == 1);
+
+		cache.insert("asdf", 42);
+		cache.insert("qwer", 42);
+		CHECK(cache.evicted_count() == 0);
+
+		cache.insert("zxcv", 42);
+		CHECK(cache.contains("qwer") == false);
+		CHECK(cache.contains(std::to_string(MAX_SIZE - 1)) == true);
+		CHECK(cache.evicted_count() == 1);
+	}
+
+	SECTION("Copies keep the order of the original")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		auto copy = cache;
+		cache.clear();
+
+		copy.insert("asdf", 42);
+		CHECK(copy.contains(std::to_string(MAX_SIZE)) == false);
+
+		copy.erase("asdf");
+		copy.erase(std::to_string(MAX_SIZE - 1));
+		copy.insert("a", 1);
+		copy.insert("b", 2);
+		copy.insert("c", 3);
+		CHECK(copy.contains("a") == true);
+		CHECK(copy.contains("b") == false);
+		CHECK(copy.contains(std::to_string(MAX_SIZE - 2)) == true);
+	}
 }
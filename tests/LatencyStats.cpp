@@ -0,0 +1,158 @@
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Cache/Cache.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Stats/Latency.h"
+#include "Cache/Stats/None.h"
+
+#include "catch2/catch.hpp"
+
+TEST_CASE("Latency statistics: histogram", "[latency][histogram]")
+{
+	detail::log_linear_histogram histogram;
+
+	SECTION("Empty histograms report zero")
+	{
+		CHECK(histogram.count() == 0);
+		CHECK(histogram.percentile(0.5) == 0);
+	}
+
+	SECTION("Small values are exact")
+	{
+		for(std::uint64_t i = 0; i < 16; i++)
+			histogram.record(i);
+
+		CHECK(histogram.count() == 16);
+		CHECK(histogram.percentile(0.0) == 0);
+		CHECK(histogram.percentile(0.5) == 7);
+		CHECK(histogram.percentile(1.0) == 15);
+	}
+
+	SECTION("Percentiles are within the relative error of the buckets")
+	{
+		constexpr std::uint64_t COUNT = 100000;
+
+		for(std::uint64_t i = 1; i <= COUNT; i++)
+			histogram.record(i);
+
+		for(double quantile : { 0.5, 0.9, 0.99, 0.999, 1.0 })
+		{
+			const double exact = quantile * COUNT;
+			const double reported = static_cast<double>(histogram.percentile(quantile));
+
+			CHECK(reported >= exact);
+			CHECK(reported <= exact * 1.0625);
+		}
+	}
+
+	SECTION("Huge values fall in the last bucket")
+	{
+		histogram.record(UINT64_MAX);
+		histogram.record(std::uint64_t{1} << 60);
+
+		CHECK(histogram.count() == 2);
+		CHECK(histogram.percentile(1.0) >= (std::uint64_t{1} << 48) - 1);
+	}
+
+	SECTION("Values can be recorded from many threads at once")
+	{
+		std::vector<std::thread> threads;
+
+		for(int t = 0; t < 4; t++)
+		{
+			threads.emplace_back([&histogram]()
+			{
+				for(std::uint64_t i = 0; i < 10000; i++)
+					histogram.record(i);
+			});
+		}
+
+		for(auto& thread : threads)
+			thread.join();
+
+		CHECK(histogram.count() == 40000);
+	}
+}
+
+TEST_CASE("Latency statistics: Cache hooks", "[latency][cache]")
+{
+	using Stats::operation;
+
+	constexpr size_t MAX_SIZE = 16;
+	Cache<int, int, Policy::LRU, std::mutex, Stats::Latency> cache(MAX_SIZE);
+
+	SECTION("Every operation is timed")
+	{
+		for(int i = 0; i < (int)MAX_SIZE * 2; i++)
+			cache.insert(i, i);
+
+		for(int i = 0; i < (int)MAX_SIZE * 2; i++)
+			cache.contains(i);
+
+		CHECK(cache.stats().latency_count(operation::insert) == MAX_SIZE * 2);
+		CHECK(cache.stats().latency_count(operation::evict) == MAX_SIZE);
+		CHECK(cache.stats().latency_count(operation::hit) == MAX_SIZE);
+		CHECK(cache.stats().latency_count(operation::miss) == MAX_SIZE);
+		CHECK(cache.stats().latency_count(operation::lock) == MAX_SIZE * 4);
+
+		// The counters of Stats::Basic are kept as well
+		CHECK(cache.hit_count() == MAX_SIZE);
+		CHECK(cache.miss_count() == MAX_SIZE);
+		CHECK(cache.evicted_count() == MAX_SIZE);
+	}
+
+	SECTION("Lookups are timed as hits or misses")
+	{
+		cache.insert(1, 1);
+
+		CHECK(cache.find(1) != cache.end());
+		CHECK(cache.find(2) == cache.end());
+		CHECK(cache.count(1) == 1);
+		CHECK(cache.at(1) == 1);
+		CHECK_THROWS_AS(cache.at(2), std::out_of_range);
+
+		CHECK(cache.stats().latency_count(operation::hit) == 3);
+		CHECK(cache.stats().latency_count(operation::miss) == 2);
+	}
+
+	SECTION("Percentiles are ordered")
+	{
+		for(int i = 0; i < 1000; i++)
+		{
+			cache.insert(i, i);
+			cache.contains(i / 2);
+		}
+
+		for(auto op : { operation::hit, operation::miss, operation::insert, operation::evict, operation::lock })
+		{
+			CHECK(cache.stats().percentile(op, 0.5) <= cache.stats().percentile(op, 0.99));
+			CHECK(cache.stats().percentile(op, 0.99) <= cache.stats().percentile(op, 0.999));
+		}
+	}
+
+	SECTION("Copies keep their histograms")
+	{
+		cache.insert(1, 1);
+		auto copy = cache;
+
+		CHECK(copy.stats().latency_count(operation::insert) == 1);
+	}
+}
+
+TEST_CASE("Latency statistics: Disabled hooks", "[latency][none]")
+{
+	// Providers without latency() are never handed a timed lock
+	STATIC_REQUIRE_FALSE(detail::measures_latency<Stats::None<int, int>>::value);
+	STATIC_REQUIRE_FALSE(detail::measures_latency<Stats::Basic<int, int>>::value);
+	STATIC_REQUIRE(detail::measures_latency<Stats::Latency<int, int>>::value);
+
+	Cache<int, int, Policy::LRU, NullLock, Stats::None> cache(4);
+	cache.insert(1, 1);
+
+	CHECK(cache.contains(1));
+}
@@ -0,0 +1,218 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "Cache/MappedCache.h"
+
+#include "catch2/catch.hpp"
+
+struct point
+{
+	std::int32_t x;
+	std::int32_t y;
+};
+
+TEST_CASE("Mapped cache: API", "[mapped][api]")
+{
+	constexpr size_t MAX_SIZE = 128;
+	MappedCache<std::uint64_t, point> cache(MAX_SIZE);
+
+	SECTION("Inserted items can be found")
+	{
+		for(std::uint64_t i = 1; i <= MAX_SIZE; i++)
+			CHECK(cache.insert(i, point{ (int)i, -(int)i }).second);
+
+		CHECK(cache.size() == MAX_SIZE);
+
+		for(std::uint64_t i = 1; i <= MAX_SIZE; i++)
+		{
+			CHECK(cache.lookup(i).x == (int)i);
+			CHECK(cache.lookup(i).y == -(int)i);
+		}
+
+		CHECK_THROWS_AS(cache.at(0), std::out_of_range);
+	}
+
+	SECTION("Existing keys are not overwritten by insert()")
+	{
+		cache.insert(1, point{ 1, 1 });
+
+		CHECK_FALSE(cache.insert(1, point{ 2, 2 }).second);
+		CHECK(cache.at(1).x == 1);
+
+		CHECK_FALSE(cache.insert_or_assign(1, point{ 3, 3 }).second);
+		CHECK(cache.at(1).x == 3);
+	}
+
+	SECTION("Size never exceeds max_size()")
+	{
+		for(std::uint64_t i = 1; i <= 10 * MAX_SIZE; i++)
+		{
+			cache.insert(i, point{});
+			REQUIRE(cache.size() <= cache.max_size());
+		}
+
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.evicted_count() == 9 * MAX_SIZE);
+	}
+
+	SECTION("Iteration visits every entry once")
+	{
+		for(std::uint64_t i = 1; i <= MAX_SIZE; i++)
+			cache[i].x = (int)i;
+
+		std::uint64_t sum = 0;
+		for(const auto& entry : cache)
+		{
+			CHECK(entry.second.x == (int)entry.first);
+			sum += entry.first;
+		}
+
+		CHECK(sum == MAX_SIZE * (MAX_SIZE + 1) / 2);
+	}
+
+	SECTION("clear() empties the cache")
+	{
+		for(std::uint64_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(i, point{});
+
+		cache.clear();
+
+		CHECK(cache.empty());
+		CHECK(cache.begin() == cache.end());
+		CHECK_FALSE(cache.contains(1));
+		CHECK(cache.cache_invalidation_count() == 1);
+	}
+
+	SECTION("A maximum size of 0 is rejected")
+	{
+		using cache_type = MappedCache<std::uint64_t, point>;
+		CHECK_THROWS_AS(cache_type(0), std::invalid_argument);
+	}
+}
+
+TEST_CASE("Mapped cache: Erasing entries", "[mapped][erase]")
+{
+	// Erasing moves entries around, so check against a reference map that
+	// lookups still find every entry after many random insertions and erasures
+	constexpr size_t MAX_SIZE = 1000;
+	MappedCache<std::uint32_t, std::uint32_t> cache(MAX_SIZE);
+	std::unordered_map<std::uint32_t, std::uint32_t> reference;
+
+	std::mt19937 gen(42);
+	std::uniform_int_distribution<std::uint32_t> keys(0, 2 * MAX_SIZE);
+
+	for(int i = 0; i < 20000; i++)
+	{
+		const std::uint32_t key = keys(gen);
+
+		if(reference.size() < MAX_SIZE && gen() % 2 == 0)
+		{
+			cache.insert(key, key * 3);
+			reference.emplace(key, key * 3);
+		}
+		else
+			REQUIRE(cache.erase(key) == reference.erase(key));
+	}
+
+	CHECK(cache.size() == reference.size());
+	CHECK(cache.evicted_count() == 0);
+
+	for(const auto& entry : reference)
+		REQUIRE(cache.at(entry.first) == entry.second);
+
+	SECTION("Erasing while iterating removes every matching entry")
+	{
+		for(auto it = cache.begin(); it != cache.end();)
+		{
+			if(it->first % 2 == 0)
+				it = cache.erase(it);
+			else
+				++it;
+		}
+
+		for(const auto& entry : reference)
+			CHECK(cache.contains(entry.first) == (entry.first % 2 != 0));
+	}
+}
+
+TEST_CASE("Mapped cache: CLOCK replacement", "[mapped][clock]")
+{
+	constexpr size_t MAX_SIZE = 64;
+	MappedCache<int, int> cache(MAX_SIZE);
+
+	SECTION("Entries that keep being read are never evicted")
+	{
+		for(int i = 0; i < 100 * (int)MAX_SIZE; i++)
+		{
+			cache.insert(i, i);
+			REQUIRE(cache.contains(0));
+		}
+	}
+
+	SECTION("Entries that are never read are evicted first")
+	{
+		for(int i = 0; i < (int)MAX_SIZE; i++)
+			cache.insert(i, i);
+
+		for(int i = 0; i < (int)MAX_SIZE / 2; i++)
+			cache.contains(i);
+
+		for(int i = 0; i < (int)MAX_SIZE / 2; i++)
+			cache.insert(1000 + i, i);
+
+		for(int i = 0; i < (int)MAX_SIZE / 2; i++)
+			CHECK(cache.contains(i));
+	}
+}
+
+TEST_CASE("Mapped cache: File-backed caches", "[mapped][file]")
+{
+	constexpr size_t MAX_SIZE = 256;
+	const std::string path = "mapped_cache_test.bin";
+	std::remove(path.c_str());
+
+	{
+		MappedCache<std::uint64_t, point> cache(path, MAX_SIZE);
+
+		for(std::uint64_t i = 0; i < 2 * MAX_SIZE; i++)
+			cache.insert(i, point{ (int)i, 0 });
+
+		cache.erase(2 * MAX_SIZE - 1);
+		cache.sync();
+	}
+
+	SECTION("Entries survive reopening the file")
+	{
+		MappedCache<std::uint64_t, point> cache(path, MAX_SIZE);
+
+		CHECK(cache.size() == MAX_SIZE - 1);
+		CHECK_FALSE(cache.contains(2 * MAX_SIZE - 1));
+
+		for(const auto& entry : cache)
+			CHECK(entry.second.x == (int)entry.first);
+
+		// Evictions carry on from where the previous run left them
+		cache.insert(12345, point{});
+		cache.insert(54321, point{});
+		CHECK(cache.size() == MAX_SIZE);
+	}
+
+	SECTION("Files of other caches are rejected")
+	{
+		using other_size = MappedCache<std::uint64_t, point>;
+		using other_type = MappedCache<std::uint64_t, std::uint32_t>;
+
+		CHECK_THROWS_AS(other_size(path, MAX_SIZE / 2), std::runtime_error);
+		CHECK_THROWS_AS(other_type(path, MAX_SIZE), std::runtime_error);
+
+		std::ofstream(path) << "garbage";
+		CHECK_THROWS_AS(other_size(path, MAX_SIZE), std::runtime_error);
+	}
+
+	std::remove(path.c_str());
+}
@@ -0,0 +1,124 @@
+#include <set>
+#include <string>
+
+#include "Cache/Cache.h"
+#include "Cache/Policy/Random.h"
+
+#include "catch2/catch.hpp"
+
+TEST_CASE("Cache w/ Random replacement policy: Random behaviour", "[cache][behaviour][random]")
+{
+	constexpr size_t MAX_SIZE = 128;
+	Cache<std::string, int, Policy::Random> cache(MAX_SIZE);
+
+	SECTION("Replaced item is one of the cached ones")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		REQUIRE(cache.size() == cache.max_size());
+		REQUIRE(cache.evicted_count() == 0);
+
+		cache.insert("asdf", 42);
+		CHECK(cache.contains("asdf") == true);
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.evicted_count() == 1);
+
+		size_t missing = 0;
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			if(!cache.contains(std::to_string(i))) missing++;
+
+		CHECK(missing == 1);
+	}
+
+	SECTION("Erased items are never picked as candidates")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		// Erase every odd key, then fill the cache back with new ones. Every
+		// eviction must pick one of the remaining keys, so the size of the
+		// cache never changes and no stale candidate crashes the cache.
+		for(size_t i = 1; i <= MAX_SIZE; i += 2)
+			CHECK(cache.erase(std::to_string(i)) == 1);
+
+		for(size_t i = 1; i <= 4 * MAX_SIZE; i++)
+		{
+			cache.insert("new" + std::to_string(i), (int)i);
+			REQUIRE(cache.size() == std::min(MAX_SIZE / 2 + i, MAX_SIZE));
+		}
+
+		CHECK(cache.evicted_count() == 4 * MAX_SIZE - MAX_SIZE / 2);
+	}
+
+	SECTION("Evictions are spread over all items")
+	{
+		std::set<std::string> evicted;
+		Cache<std::string, int, Policy::Random> seeded(MAX_SIZE, Policy::Random<std::string>(42));
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			seeded.insert(std::to_string(i), (int)i);
+
+		// With a uniform choice, an item survives each eviction with a chance
+		// of 127/128, so the chance that any of the 128 original items
+		// survives 4096 evictions is about 128 * e^-32. The seed keeps the
+		// test deterministic anyway.
+		for(size_t i = 1; i <= 32 * MAX_SIZE; i++)
+			seeded.insert("new" + std::to_string(i), (int)i);
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			if(!seeded.contains(std::to_string(i))) evicted.insert(std::to_string(i));
+
+		CHECK(evicted.size() == MAX_SIZE);
+	}
+}
+
+TEST_CASE("Random replacement policy: seeding", "[policy][random]")
+{
+	SECTION("Policies with the same seed pick the same candidates")
+	{
+		Policy::Random<int> a(42), b(42);
+
+		for(int i = 0; i < 1000; i++)
+		{
+			a.insert(i);
+			b.insert(i);
+		}
+
+		for(int i = 0; i < 500; i++)
+		{
+			const int candidate = a.replace_candidate();
+			REQUIRE(b.replace_candidate() == candidate);
+
+			a.erase(candidate);
+			b.erase(candidate);
+		}
+	}
+
+	SECTION("Erasing keeps every other key")
+	{
+		Policy::Random<int> policy(1);
+		std::set<int> keys;
+
+		for(int i = 0; i < 100; i++)
+		{
+			policy.insert(i);
+			keys.insert(i);
+		}
+
+		for(int i = 0; i < 100; i += 3)
+		{
+			policy.erase(i);
+			keys.erase(i);
+		}
+
+		while(!keys.empty())
+		{
+			const int candidate = policy.replace_candidate();
+			REQUIRE(keys.count(candidate) == 1);
+
+			keys.erase(candidate);
+			policy.erase(candidate);
+		}
+	}
+}
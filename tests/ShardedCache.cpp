@@ -0,0 +1,160 @@
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Cache/ShardedCache.h"
+#include "Cache/Policy/LRU.h"
+
+#include "catch2/catch.hpp"
+
+TEST_CASE("Sharded cache: capacity", "[sharded][init]")
+{
+	SECTION("max_size() is split across all shards")
+	{
+		constexpr size_t MAX_SIZE = 130;
+		ShardedCache<std::string, int, Policy::LRU> cache(MAX_SIZE, 8);
+
+		REQUIRE(cache.shard_count() == 8);
+		CHECK(cache.max_size() == MAX_SIZE);
+
+		size_t total = 0;
+		for(size_t i = 0; i < cache.shard_count(); i++)
+			total += cache.shard(i).max_size();
+
+		CHECK(total == MAX_SIZE);
+	}
+
+	SECTION("Shard count is rounded up to a power of two")
+	{
+		ShardedCache<std::string, int, Policy::LRU> cache(128, 5);
+		CHECK(cache.shard_count() == 8);
+	}
+
+	SECTION("There are never more shards than entries")
+	{
+		ShardedCache<std::string, int, Policy::LRU> cache(6, 64);
+		CHECK(cache.shard_count() == 4);
+	}
+
+	SECTION("Unbounded sharded caches have unbounded shards")
+	{
+		ShardedCache<std::string, int, Policy::LRU> cache(0, 4);
+
+		for(size_t i = 0; i < cache.shard_count(); i++)
+			CHECK(cache.shard(i).max_size() == std::numeric_limits<size_t>::max());
+	}
+}
+
+TEST_CASE("Sharded cache: API", "[sharded][api]")
+{
+	constexpr size_t MAX_SIZE = 128;
+	ShardedCache<std::string, int, Policy::LRU> cache(MAX_SIZE, 4);
+
+	SECTION("Inserted items can be found")
+	{
+		ShardedCache<std::string, int, Policy::LRU> unbounded(0, 4);
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			unbounded.insert(std::to_string(i), (int)i);
+
+		CHECK(unbounded.size() == MAX_SIZE);
+
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			CHECK(unbounded.lookup(std::to_string(i)) == (int)i);
+	}
+
+	SECTION("Keys are always routed to the same shard")
+	{
+		cache["key"] = 42;
+
+		CHECK(cache.shard_for("key").contains("key"));
+		CHECK(cache.at("key") == 42);
+		CHECK(cache.count("key") == 1);
+	}
+
+	SECTION("Size never exceeds max_size()")
+	{
+		for(size_t i = 1; i <= 10 * MAX_SIZE; i++)
+		{
+			cache.insert(std::to_string(i), (int)i);
+			REQUIRE(cache.size() <= cache.max_size());
+		}
+
+		CHECK(cache.evicted_count() == 10 * MAX_SIZE - cache.size());
+	}
+
+	SECTION("emplace() constructs items in-place")
+	{
+		ShardedCache<int, std::string, Policy::LRU> strings(MAX_SIZE, 4);
+		strings.emplace(1, 5, 'a');
+
+		CHECK(strings.at(1) == "aaaaa");
+	}
+
+	SECTION("erase() removes the key from its shard")
+	{
+		cache.insert("key", 1);
+
+		CHECK(cache.erase("key") == 1);
+		CHECK(cache.erase("key") == 0);
+		CHECK(cache.empty());
+		CHECK(cache.entry_invalidation_count() == 1);
+	}
+
+	SECTION("clear() empties every shard")
+	{
+		for(size_t i = 1; i <= MAX_SIZE; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		cache.clear();
+
+		CHECK(cache.size() == 0);
+		CHECK(cache.empty());
+		CHECK(cache.cache_invalidation_count() == 1);
+	}
+
+	SECTION("Statistics are aggregated over all shards")
+	{
+		for(size_t i = 1; i <= 16; i++)
+			cache.insert(std::to_string(i), (int)i);
+
+		for(size_t i = 1; i <= 32; i++)
+			cache.contains(std::to_string(i));
+
+		CHECK(cache.hit_count() == 16);
+		CHECK(cache.miss_count() == 16);
+		CHECK(cache.access_count() == 32);
+		CHECK(cache.hit_ratio() == 0.5f);
+		CHECK(cache.utilization() == 16.0f / MAX_SIZE);
+	}
+}
+
+TEST_CASE("Sharded cache: Concurrent access", "[sharded][thread]")
+{
+	constexpr size_t MAX_SIZE = 1024;
+	constexpr int THREADS = 4;
+	constexpr int ITEMS = 2000;
+
+	ShardedCache<int, int, Policy::LRU, std::mutex> cache(MAX_SIZE, 8);
+	std::vector<std::thread> threads;
+
+	for(int t = 0; t < THREADS; t++)
+	{
+		threads.emplace_back([&cache, t]()
+		{
+			for(int i = 0; i < ITEMS; i++)
+			{
+				cache.insert(t * ITEMS + i, i);
+				cache.contains(t * ITEMS + i / 2);
+			}
+		});
+	}
+
+	for(auto& thread : threads)
+		thread.join();
+
+	CHECK(cache.size() == MAX_SIZE);
+	CHECK(cache.access_count() == THREADS * ITEMS);
+	CHECK(cache.evicted_count() == THREADS * ITEMS - MAX_SIZE);
+}
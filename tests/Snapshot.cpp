@@ -0,0 +1,321 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "Cache/Cache.h"
+#include "Cache/Policy/ARC.h"
+#include "Cache/Policy/FIFO.h"
+#include "Cache/Policy/GDSF.h"
+#include "Cache/Policy/LFU.h"
+#include "Cache/Policy/LIFO.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Policy/MRU.h"
+#include "Cache/Policy/WTinyLFU.h"
+
+#include "catch2/catch.hpp"
+
+using namespace std::chrono_literals;
+
+template<template<typename> class Template>
+struct wrapper
+{
+	template<typename Args>
+	using apply = Template<Args>;
+};
+
+// Clock that only moves when told to
+struct FakeClock
+{
+	using duration   = std::chrono::milliseconds;
+	using rep        = duration::rep;
+	using period     = duration::period;
+	using time_point = std::chrono::time_point<FakeClock>;
+
+	static constexpr bool is_steady = true;
+	static duration current;
+
+	static time_point now() noexcept { return time_point(current); }
+	static void advance(duration d) noexcept { current += d; }
+};
+
+FakeClock::duration FakeClock::current{ 1000000 };
+
+// Stores integers as decimal text, to check that custom serializers are used
+struct TextSerializer
+{
+	static void write(std::ostream& os, const int& value) { os << value << ' '; }
+	static int read(std::istream& is) { int value = 0; is >> value; is.get(); return value; }
+};
+
+struct StringWeigher
+{
+	size_t operator()(const std::string&, const std::string& value) const noexcept { return value.size(); }
+};
+
+template<typename CacheType>
+std::map<int, int> contents(const CacheType& cache)
+{
+	return std::map<int, int>(cache.begin(), cache.end());
+}
+
+// Policies whose state is saved along with the entries: after loading a
+// snapshot, the cache must evict exactly the same keys as the original one
+TEMPLATE_TEST_CASE("Cache snapshots: Policy state", "[cache][snapshot]", wrapper<Policy::FIFO>, wrapper<Policy::LFU>, wrapper<Policy::LIFO>, wrapper<Policy::LRU>, wrapper<Policy::MRU>)
+{
+	constexpr size_t MAX_SIZE = 64;
+	Cache<int, int, TestType::template apply> cache(MAX_SIZE);
+
+	// Some keys are looked up several times, so that their position (or
+	// frequency) differs from their insertion order
+	for(int i = 0; i < 2 * (int)MAX_SIZE; i++)
+	{
+		cache.insert(i, i * 10);
+
+		for(int j = 0; j < i % 4; j++)
+			cache.contains(i - j);
+	}
+
+	std::stringstream snapshot;
+	cache.save(snapshot);
+
+	Cache<int, int, TestType::template apply> loaded(MAX_SIZE);
+	loaded.load(snapshot);
+
+	// Lookups would change the state of the policy, so compare the contents
+	// of both caches by iterating over them
+	CHECK(contents(loaded) == contents(cache));
+
+	for(int i = 1000; i < 1000 + 2 * (int)MAX_SIZE; i++)
+	{
+		cache.insert(i, i);
+		loaded.insert(i, i);
+
+		REQUIRE(contents(loaded) == contents(cache));
+	}
+}
+
+// The rest of the policies are rebuilt by inserting the keys again
+TEMPLATE_TEST_CASE("Cache snapshots: Other policies", "[cache][snapshot]", wrapper<Policy::ARC>, wrapper<Policy::GDSF>, wrapper<Policy::Random>, wrapper<Policy::WTinyLFU>)
+{
+	constexpr size_t MAX_SIZE = 64;
+	Cache<int, int, TestType::template apply> cache(MAX_SIZE);
+
+	for(int i = 0; i < (int)MAX_SIZE; i++)
+		cache.insert(i, -i);
+
+	std::stringstream snapshot;
+	cache.save(snapshot);
+
+	Cache<int, int, TestType::template apply> loaded(MAX_SIZE);
+	loaded.load(snapshot);
+
+	REQUIRE(loaded.size() == MAX_SIZE);
+
+	for(int i = 0; i < (int)MAX_SIZE; i++)
+		CHECK(loaded.at(i) == -i);
+
+	// The policy must know about every loaded key
+	for(int i = 0; i < 4 * (int)MAX_SIZE; i++)
+	{
+		loaded.get_or_insert_with(1000 + i, []() { return 0; });
+		REQUIRE(loaded.size() <= MAX_SIZE);
+	}
+}
+
+// Frequencies are dumped in ascending order. Any other order would leave the
+// frequency buckets of the policy unsorted, so the snapshot is rejected.
+TEST_CASE("Cache snapshots: Out of order LFU frequencies", "[cache][snapshot]")
+{
+	constexpr size_t MAX_SIZE = 8;
+
+	// The header of an empty snapshot, followed by two entries
+	std::stringstream empty;
+	Cache<int, int, Policy::LFU>(MAX_SIZE).save(empty);
+
+	std::string data = empty.str();
+	data.resize(data.size() - sizeof(std::uint64_t));
+
+	std::stringstream records;
+	Serializer<std::uint64_t>::write(records, 2);
+
+	for(const auto& entry : { std::make_pair(1, 5), std::make_pair(2, 1) })
+	{
+		Serializer<std::uint64_t>::write(records, static_cast<std::uint64_t>(entry.second)); // Frequency
+		Serializer<std::int64_t>::write(records, 0);                                        // No TTL
+		Serializer<int>::write(records, entry.first);
+		Serializer<int>::write(records, entry.first * 10);
+	}
+
+	Cache<int, int, Policy::LFU> loaded(MAX_SIZE);
+	loaded.insert(42, 420);
+
+	std::stringstream snapshot(data + records.str());
+	CHECK_THROWS_AS(loaded.load(snapshot), std::runtime_error);
+	CHECK(loaded.empty());
+
+	// The cache is still usable
+	for(int i = 0; i < 2 * (int)MAX_SIZE; i++)
+		loaded.insert(i, i);
+
+	CHECK(loaded.size() == MAX_SIZE);
+}
+
+TEST_CASE("Cache snapshots: API", "[cache][snapshot]")
+{
+	constexpr size_t MAX_SIZE = 32;
+	Cache<std::string, std::string, Policy::LRU> cache(MAX_SIZE);
+
+	for(int i = 0; i < (int)MAX_SIZE; i++)
+		cache.insert("key" + std::to_string(i), std::string((size_t)i, 'x'));
+
+	SECTION("Strings are saved and loaded")
+	{
+		std::stringstream snapshot;
+		cache.save(snapshot);
+
+		Cache<std::string, std::string, Policy::LRU> loaded(MAX_SIZE);
+		loaded.insert("old", std::string("value"));
+		loaded.load(snapshot);
+
+		CHECK(loaded.size() == MAX_SIZE);
+		CHECK_FALSE(loaded.contains("old"));
+
+		for(int i = 0; i < (int)MAX_SIZE; i++)
+			CHECK(loaded.at("key" + std::to_string(i)) == std::string((size_t)i, 'x'));
+
+		// Loading is not an insertion, an eviction nor an invalidation
+		CHECK(loaded.evicted_count() == 0);
+		CHECK(loaded.cache_invalidation_count() == 0);
+	}
+
+	SECTION("Snapshots can be saved to and loaded from files")
+	{
+		const std::string path = "snapshot_test.bin";
+
+		// Saving replaces any existing file
+		std::ofstream(path) << "garbage";
+		cache.save(path);
+
+		Cache<std::string, std::string, Policy::LRU> loaded(MAX_SIZE);
+		loaded.load(path);
+
+		CHECK(loaded.size() == MAX_SIZE);
+		CHECK(std::ifstream(path + ".tmp").good() == false);
+
+		std::remove(path.c_str());
+		CHECK_THROWS_AS(loaded.load(path), std::runtime_error);
+	}
+
+	SECTION("Snapshots bigger than the cache keep the newest entries")
+	{
+		std::stringstream snapshot;
+		cache.save(snapshot);
+
+		Cache<std::string, std::string, Policy::LRU> smaller(MAX_SIZE / 2);
+		smaller.load(snapshot);
+
+		CHECK(smaller.size() == MAX_SIZE / 2);
+
+		for(int i = MAX_SIZE / 2; i < (int)MAX_SIZE; i++)
+			CHECK(smaller.contains("key" + std::to_string(i)));
+	}
+
+	SECTION("Invalid snapshots throw and leave the cache empty")
+	{
+		std::stringstream snapshot;
+		cache.save(snapshot);
+
+		const std::string data = snapshot.str();
+		Cache<std::string, std::string, Policy::LRU> loaded(MAX_SIZE);
+
+		std::stringstream truncated(data.substr(0, data.size() / 2));
+		CHECK_THROWS_AS(loaded.load(truncated), std::runtime_error);
+		CHECK(loaded.empty());
+
+		std::stringstream garbage("this is not a snapshot");
+		CHECK_THROWS_AS(loaded.load(garbage), std::runtime_error);
+		CHECK(loaded.empty());
+
+		// The cache is still usable
+		loaded.insert("key", std::string("value"));
+		CHECK(loaded.at("key") == "value");
+	}
+
+	SECTION("Corrupt entry counts throw instead of reserving the storage")
+	{
+		// The header of an empty snapshot, with a count of 2^62 entries
+		std::stringstream empty;
+		Cache<int, int, Policy::LRU>(MAX_SIZE).save(empty);
+
+		std::string data = empty.str();
+		data.resize(data.size() - sizeof(std::uint64_t));
+
+		std::stringstream header;
+		Serializer<std::uint64_t>::write(header, std::uint64_t(1) << 62);
+		data += header.str();
+
+		Cache<int, int, Policy::LRU> unbounded(0);
+		std::stringstream corrupt(data);
+		CHECK_THROWS_AS(unbounded.load(corrupt), std::runtime_error);
+		CHECK(unbounded.empty());
+
+		Cache<std::string, std::string, Policy::LRU, NullLock, Stats::Basic, std::unordered_map, StringWeigher> weighted(std::size_t(1) << 40);
+		corrupt.str(data);
+		corrupt.clear();
+		CHECK_THROWS_AS(weighted.load(corrupt), std::runtime_error);
+		CHECK(weighted.empty());
+	}
+}
+
+TEST_CASE("Cache snapshots: Custom serializers", "[cache][snapshot]")
+{
+	Cache<int, int, Policy::LRU> cache(16);
+
+	for(int i = 0; i < 16; i++)
+		cache.insert(i, i * i);
+
+	std::stringstream snapshot;
+	cache.save<TextSerializer, TextSerializer>(snapshot);
+
+	CHECK(snapshot.str().find("225 ") != std::string::npos);
+
+	Cache<int, int, Policy::LRU> loaded(16);
+	loaded.load<TextSerializer, TextSerializer>(snapshot);
+
+	for(int i = 0; i < 16; i++)
+		CHECK(loaded.at(i) == i * i);
+}
+
+TEST_CASE("Cache snapshots: Time to live", "[cache][snapshot][ttl]")
+{
+	using ExpiringCache = Cache<int, int, Policy::LRU, NullLock, Stats::Basic, std::unordered_map, UnitWeigher, FakeClock>;
+
+	ExpiringCache cache(16);
+	cache.insert(1, 1);
+	cache.insert(2, 2, 10s);
+	cache.insert(3, 3, 1s);
+
+	FakeClock::advance(5s);
+
+	std::stringstream snapshot;
+	cache.save(snapshot);
+
+	ExpiringCache loaded(16);
+	loaded.load(snapshot);
+
+	// Entries that had expired when the snapshot was taken are not loaded,
+	// and the rest keep their remaining time to live
+	CHECK(loaded.size() == 2);
+	CHECK(loaded.contains(1));
+	CHECK(loaded.contains(2));
+
+	FakeClock::advance(5s);
+
+	CHECK(loaded.contains(1));
+	CHECK_FALSE(loaded.contains(2));
+}
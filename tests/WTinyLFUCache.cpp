@@ -0,0 +1,184 @@
+#include <string>
+
+#include "Cache/Cache.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Policy/WTinyLFU.h"
+#include "Cache/detail/frequency_sketch.h"
+
+#include "catch2/catch.hpp"
+
+TEST_CASE("Cache w/ W-TinyLFU replacement policy: W-TinyLFU behaviour", "[cache][behaviour][wtinylfu]")
+{
+	constexpr size_t MAX_SIZE = 128;
+	constexpr size_t HOT_KEYS = 64;
+
+	auto access_hot_keys = [](auto& cache)
+	{
+		for(int round = 0; round < 8; round++)
+			for(size_t i = 0; i < HOT_KEYS; i++)
+				if(!cache.contains("hot " + std::to_string(i)))
+					cache.insert("hot " + std::to_string(i), (int)i);
+	};
+
+	auto scan = [](auto& cache)
+	{
+		for(size_t i = 0; i < 20 * MAX_SIZE; i++)
+			if(!cache.contains("scan " + std::to_string(i)))
+				cache.insert("scan " + std::to_string(i), (int)i);
+	};
+
+	auto count_hot_keys = [](auto& cache)
+	{
+		size_t count = 0;
+		for(size_t i = 0; i < HOT_KEYS; i++)
+			count += cache.count("hot " + std::to_string(i));
+
+		return count;
+	};
+
+	SECTION("A scan flushes the working set of a LRU cache")
+	{
+		Cache<std::string, int, Policy::LRU> cache(MAX_SIZE);
+		access_hot_keys(cache);
+		scan(cache);
+
+		CHECK(count_hot_keys(cache) == 0);
+	}
+
+	SECTION("A scan does not flush the working set of a W-TinyLFU cache")
+	{
+		Cache<std::string, int, Policy::WTinyLFU> cache(MAX_SIZE);
+		access_hot_keys(cache);
+		scan(cache);
+
+		CHECK(count_hot_keys(cache) >= HOT_KEYS * 9 / 10);
+	}
+
+	SECTION("A scan does not flush the working set of a weighted W-TinyLFU cache")
+	{
+		// The window and the protected segment are sized in entries, not bytes
+		struct byte_weigher
+		{
+			size_t operator()(const std::string&, int) const noexcept { return 10; }
+		};
+
+		Cache<std::string, int, Policy::WTinyLFU, NullLock, Stats::Basic, std::unordered_map, byte_weigher> cache(10 * MAX_SIZE);
+		access_hot_keys(cache);
+		scan(cache);
+
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(count_hot_keys(cache) >= HOT_KEYS * 9 / 10);
+	}
+
+	SECTION("New keys are admitted into the window")
+	{
+		Cache<std::string, int, Policy::WTinyLFU> cache(MAX_SIZE);
+		access_hot_keys(cache);
+
+		for(size_t i = 0; i < MAX_SIZE; i++)
+		{
+			auto result = cache.insert("new " + std::to_string(i), (int)i);
+
+			CHECK(result.second == true);
+			CHECK(cache.contains("new " + std::to_string(i)));
+		}
+
+		CHECK(cache.size() == MAX_SIZE);
+	}
+}
+
+TEST_CASE("Cache w/ W-TinyLFU replacement policy: admission", "[cache][behaviour][wtinylfu]")
+{
+	constexpr size_t MAX_SIZE = 16;
+	Cache<std::string, int, Policy::WTinyLFU> cache(MAX_SIZE, Policy::WTinyLFU<std::string>(0.0f));
+
+	for(size_t i = 0; i < MAX_SIZE; i++)
+		cache.insert(std::to_string(i), (int)i);
+
+	for(int round = 0; round < 4; round++)
+		for(size_t i = 0; i < MAX_SIZE; i++)
+			REQUIRE(cache.contains(std::to_string(i)));
+
+	SECTION("insert() of an unpopular key is rejected")
+	{
+		auto result = cache.insert("cold", 42);
+
+		CHECK(result.first == cache.end());
+		CHECK(result.second == false);
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.evicted_count() == 0);
+		CHECK(cache.count("cold") == 0);
+	}
+
+	SECTION("emplace() of an unpopular key is rejected")
+	{
+		auto result = cache.emplace("cold", 42);
+
+		CHECK(result.first == cache.end());
+		CHECK(result.second == false);
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.evicted_count() == 0);
+		CHECK(cache.count("cold") == 0);
+	}
+
+	SECTION("Rejected keys are admitted once they become popular")
+	{
+		bool admitted = false;
+		for(int i = 0; i < 16 && !admitted; i++)
+			admitted = cache.insert("warm", 42).second;
+
+		CHECK(admitted == true);
+		CHECK(cache.count("warm") == 1);
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.evicted_count() == 1);
+	}
+
+	SECTION("operator[] always admits the key")
+	{
+		cache["cold"] = 42;
+
+		CHECK(cache.count("cold") == 1);
+		CHECK(cache.size() == MAX_SIZE);
+		CHECK(cache.evicted_count() == 1);
+	}
+}
+
+TEST_CASE("Cache w/ W-TinyLFU replacement policy: frequency sketch", "[cache][wtinylfu]")
+{
+	SECTION("The sketch grows as the cache fills up")
+	{
+		Cache<int, int, Policy::WTinyLFU> cache(size_t{1} << 40);
+		CHECK(cache.size() == 0);
+
+		for(int i = 0; i < 1000; i++)
+			cache.insert(i, i);
+
+		CHECK(cache.size() == 1000);
+		CHECK(cache.contains(999));
+	}
+
+	SECTION("Sketches are sized by keys, up to a fixed limit")
+	{
+		detail::frequency_sketch sketch;
+		CHECK(sketch.capacity() == 0);
+		CHECK(sketch.frequency(42) == 0);
+
+		sketch.ensure_capacity(1000);
+		CHECK(sketch.capacity() == 1024);
+
+		sketch.increment(42);
+		sketch.increment(42);
+		CHECK(sketch.frequency(42) == 2);
+
+		sketch.ensure_capacity(1000);
+		CHECK(sketch.frequency(42) == 2);
+
+		// Growing the sketch keeps the estimates
+		sketch.ensure_capacity(5000);
+		CHECK(sketch.capacity() == 8192);
+		CHECK(sketch.frequency(42) == 2);
+
+		sketch.ensure_capacity(size_t{1} << 40);
+		CHECK(sketch.capacity() == size_t{1} << 17);
+	}
+}
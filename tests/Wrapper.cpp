@@ -1,9 +1,65 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 #include "Cache/Cache.h"
 #include "Cache/Wrapper.h"
 #include "Cache/Policy/LRU.h"
+#include "Cache/Stats/Basic.h"
 
 #include "catch2/catch.hpp"
 
+namespace
+{
+	// Counts how many times it is copied
+	struct copy_counter
+	{
+		static int copies;
+
+		int value = 0;
+
+		copy_counter() = default;
+		copy_counter(const copy_counter& other) : value(other.value) { copies++; }
+		copy_counter& operator=(const copy_counter& other) { value = other.value; copies++; return *this; }
+	};
+
+	int copy_counter::copies = 0;
+
+	// Hashes `keys` into `buckets` buckets (a power of two), using either the
+	// lowest or the highest bits of the hash, and returns how many are empty
+	// and how many keys the fullest one has
+	template<typename Key>
+	std::pair<size_t, size_t> bucket_load(const std::vector<Key>& keys, unsigned bits, bool high_bits)
+	{
+		std::vector<size_t> buckets(size_t{1} << bits);
+
+		for(const auto& key : keys)
+		{
+			const std::uint64_t hash = std::hash<Key>{}(key);
+			buckets[high_bits ? (hash >> (64 - bits)) : (hash & (buckets.size() - 1))]++;
+		}
+
+		return { static_cast<size_t>(std::count(buckets.begin(), buckets.end(), 0U)), *std::max_element(buckets.begin(), buckets.end()) };
+	}
+}
+
+namespace std
+{
+	template<> struct hash<copy_counter>
+	{
+		size_t operator()(const copy_counter& c) const { return std::hash<int>{}(c.value); }
+	};
+}
+
 TEST_CASE("Function Wrapper", "[cache][wrapper]")
 {
 	int call_count = 0;
@@ -30,3 +86,388 @@ TEST_CASE("Function Wrapper", "[cache][wrapper]")
 		CHECK(call_count == 1);
 	}
 }
+
+TEST_CASE("Function wrapper: Per-instance caches", "[cache][wrapper]")
+{
+	int call_count = 0;
+	auto square = [&call_count](long x) { call_count++; return x * x; };
+
+	SECTION("Every call to wrap() gets its own cache")
+	{
+		auto small = wrap<Policy::LRU>(square, 1U);
+		auto big = wrap<Policy::LRU>(square, 10U);
+
+		small(1);
+		small(2);
+		big(1);
+		big(2);
+		CHECK(call_count == 4);
+
+		CHECK(small.cache().max_size() == 1);
+		CHECK(small.cache().size() == 1);
+		CHECK(big.cache().max_size() == 10);
+		CHECK(big.cache().size() == 2);
+	}
+
+	SECTION("Copies of a wrapped function share its cache")
+	{
+		auto cached = wrap<Policy::LRU>(square, 10U);
+		auto copy = cached;
+
+		CHECK(cached(3) == 9);
+		CHECK(copy(3) == 9);
+		CHECK(call_count == 1);
+		CHECK(&copy.cache() == &cached.cache());
+	}
+
+	SECTION("Arguments are stored as the parameter types of the function")
+	{
+		auto cached = wrap<Policy::LRU>(square, 10U);
+
+		CHECK(cached(3) == 9);
+		CHECK(cached(3L) == 9);
+		CHECK(cached(short{3}) == 9);
+		CHECK(call_count == 1);
+		CHECK(cached.cache().contains(std::make_tuple(3L)));
+	}
+
+	SECTION("clear() empties the cache")
+	{
+		auto cached = wrap<Policy::LRU>(square, 10U);
+
+		cached(3);
+		cached.clear();
+		CHECK(cached.cache().empty());
+
+		cached(3);
+		CHECK(call_count == 2);
+	}
+
+	SECTION("Statistics can be enabled and read")
+	{
+		auto cached = wrap<Policy::LRU, NullLock, Stats::Basic>(square, 10U);
+
+		cached(1);
+		cached(1);
+		cached(2);
+
+		CHECK(cached.stats().hit_count() == 1);
+		CHECK(cached.stats().miss_count() == 2);
+	}
+
+	SECTION("Functions taking references cache copies of their arguments")
+	{
+		auto length = [&call_count](const std::string& str) { call_count++; return str.size(); };
+		auto cached = wrap<Policy::LRU>(length, 10U);
+
+		std::string str = "key";
+		CHECK(cached(str) == 3);
+		str = "another key";
+		CHECK(cached(std::string("key")) == 3);
+		CHECK(cached("key") == 3);
+		CHECK(call_count == 1);
+	}
+
+	SECTION("Generic lambdas can be wrapped with an explicit signature")
+	{
+		auto generic = [&call_count](auto x) { call_count++; return x * x; };
+		auto cached = wrap<Policy::LRU, NullLock, Stats::None, long(long)>(generic, 10U);
+
+		CHECK(cached(3) == 9);
+		CHECK(cached(short{3}) == 9);
+		CHECK(call_count == 1);
+		CHECK(cached.cache().contains(std::make_tuple(3L)));
+
+		auto single_flight = wrap_single_flight<Policy::LRU, std::mutex, Stats::None, long(long)>(generic, 10U);
+		CHECK(single_flight(4) == 16);
+		CHECK(single_flight(4) == 16);
+		CHECK(call_count == 2);
+	}
+
+	SECTION("Function objects with overloaded operator() are called with the explicit signature")
+	{
+		struct overloaded
+		{
+			std::string operator()(int) const { return "int"; }
+			std::string operator()(const std::string&) const { return "string"; }
+		};
+
+		auto by_int = wrap<Policy::LRU, NullLock, Stats::None, std::string(int)>(overloaded{}, 10U);
+		auto by_string = wrap<Policy::LRU, NullLock, Stats::None, std::string(const std::string&)>(overloaded{}, 10U);
+
+		CHECK(by_int(1) == "int");
+		CHECK(by_string("1") == "string");
+		CHECK(by_string.cache().contains(std::make_tuple(std::string("1"))));
+	}
+}
+
+TEST_CASE("Single-flight function wrapper", "[cache][wrapper][thread]")
+{
+	constexpr int THREADS = 8;
+
+	std::atomic<int> call_count{0};
+	auto slow_fn = [&call_count](int a)
+	{
+		call_count++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		if(a < 0) throw std::invalid_argument("negative");
+		return 2 * a;
+	};
+
+	auto slow_fn_cached = wrap_single_flight<Policy::LRU>(slow_fn, 10U);
+
+	SECTION("Concurrent misses of the same arguments call the function once")
+	{
+		std::vector<std::thread> threads;
+		std::vector<int> results(THREADS);
+
+		for(int i = 0; i < THREADS; i++)
+			threads.emplace_back([&, i]() { results[static_cast<size_t>(i)] = slow_fn_cached(21); });
+
+		for(auto& thread : threads)
+			thread.join();
+
+		CHECK(call_count == 1);
+		for(int result : results)
+			CHECK(result == 42);
+
+		CHECK(slow_fn_cached(21) == 42);
+		CHECK(call_count == 1);
+	}
+
+	SECTION("Exceptions are propagated to every waiting caller")
+	{
+		std::vector<std::thread> threads;
+		std::atomic<int> exceptions{0};
+
+		for(int i = 0; i < THREADS; i++)
+		{
+			threads.emplace_back([&]()
+			{
+				try { slow_fn_cached(-1); }
+				catch(const std::invalid_argument&) { exceptions++; }
+			});
+		}
+
+		for(auto& thread : threads)
+			thread.join();
+
+		CHECK(exceptions == THREADS);
+	}
+
+	SECTION("Hits are copied before other threads can evict them")
+	{
+		// Copying a result after releasing the lock races with its eviction
+		// by another thread, which ThreadSanitizer reports
+		auto long_string = wrap_single_flight<Policy::LRU>([](int a) { return std::string(256, static_cast<char>('a' + a)); }, 2U);
+
+		std::vector<std::thread> threads;
+		std::atomic<int> mismatches{0};
+
+		for(int i = 0; i < THREADS; i++)
+		{
+			threads.emplace_back([&, i]()
+			{
+				for(int j = 0; j < 1000; j++)
+				{
+					const int a = (i + j) % 4;
+					if(long_string(a) != std::string(256, static_cast<char>('a' + a)))
+						mismatches++;
+				}
+			});
+		}
+
+		for(auto& thread : threads)
+			thread.join();
+
+		CHECK(mismatches == 0);
+	}
+}
+
+TEST_CASE("Asynchronous function wrapper", "[cache][wrapper][thread]")
+{
+	// The wrapped function returns futures that the test completes by hand
+	std::mutex mutex;
+	std::deque<std::promise<int>> promises;
+
+	auto start = [&](int x)
+	{
+		if(x < 0) throw std::invalid_argument("negative");
+
+		std::lock_guard<std::mutex> lock(mutex);
+		promises.emplace_back();
+		return promises.back().get_future();
+	};
+
+	auto cached = async_wrap<Policy::LRU>(start, 10U);
+
+	SECTION("Misses return a pending future, shared by later calls")
+	{
+		auto first = cached(1);
+		auto second = cached(1);
+
+		REQUIRE(promises.size() == 1);
+		CHECK(first.wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+
+		promises[0].set_value(42);
+		CHECK(first.get() == 42);
+		CHECK(second.get() == 42);
+	}
+
+	SECTION("Hits return a ready future")
+	{
+		cached(1);
+		promises[0].set_value(42);
+
+		auto hit = cached(1);
+		CHECK(hit.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+		CHECK(hit.get() == 42);
+		CHECK(promises.size() == 1);
+	}
+
+	SECTION("Failed computations are not cached")
+	{
+		auto failed = cached(1);
+		promises[0].set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+		CHECK_THROWS_AS(failed.get(), std::runtime_error);
+
+		auto retried = cached(1);
+		REQUIRE(promises.size() == 2);
+
+		promises[1].set_value(42);
+		CHECK(retried.get() == 42);
+		CHECK(cached(1).get() == 42);
+		CHECK(promises.size() == 2);
+	}
+
+	SECTION("Exceptions thrown by the function itself are propagated")
+	{
+		CHECK_THROWS_AS(cached(-1), std::invalid_argument);
+		CHECK(cached.cache().empty());
+	}
+
+	SECTION("Generic lambdas can be wrapped with an explicit signature")
+	{
+		auto generic = [&start](auto x) { return start(static_cast<int>(x)); };
+		auto explicit_cached = async_wrap<Policy::LRU, std::mutex, Stats::None, std::future<int>(int)>(generic, 10U);
+
+		auto first = explicit_cached(1);
+		auto second = explicit_cached(1);
+		REQUIRE(promises.size() == 1);
+
+		promises[0].set_value(42);
+		CHECK(first.get() == 42);
+		CHECK(second.get() == 42);
+	}
+
+	SECTION("Concurrent misses of the same arguments call the function once")
+	{
+		constexpr int THREADS = 8;
+
+		std::vector<std::thread> threads;
+		std::vector<std::shared_future<int>> results(THREADS);
+
+		for(int i = 0; i < THREADS; i++)
+			threads.emplace_back([&, i]() { results[static_cast<size_t>(i)] = cached(7); });
+
+		for(auto& thread : threads)
+			thread.join();
+
+		REQUIRE(promises.size() == 1);
+		promises[0].set_value(49);
+
+		for(auto& result : results)
+			CHECK(result.get() == 49);
+	}
+
+	SECTION("Hits are copied before other threads can evict them")
+	{
+		// Checking whether a cached future failed and copying it after
+		// releasing the lock races with its eviction (see ThreadSanitizer)
+		auto ready = async_wrap<Policy::LRU>([](int x)
+		{
+			std::promise<int> promise;
+			promise.set_value(2 * x);
+			return promise.get_future();
+		}, 2U);
+
+		constexpr int THREADS = 8;
+
+		std::vector<std::thread> threads;
+		std::atomic<int> mismatches{0};
+
+		for(int i = 0; i < THREADS; i++)
+		{
+			threads.emplace_back([&, i]()
+			{
+				for(int j = 0; j < 1000; j++)
+				{
+					const int x = (i * j) % 3;
+					if(ready(x).get() != 2 * x)
+						mismatches++;
+				}
+			});
+		}
+
+		for(auto& thread : threads)
+			thread.join();
+
+		CHECK(mismatches == 0);
+	}
+}
+
+TEST_CASE("Tuple hash", "[cache][wrapper][hash]")
+{
+	SECTION("Equal tuples have equal hashes")
+	{
+		using Key = std::tuple<std::string, int, double>;
+		const Key a(std::string("key"), 1, 2.5);
+		const Key b(std::string("key"), 1, 2.5);
+
+		CHECK(std::hash<Key>{}(a) == std::hash<Key>{}(b));
+	}
+
+	SECTION("The order of the elements matters")
+	{
+		CHECK(std::hash<std::tuple<int, int>>{}(std::make_tuple(1, 2)) != std::hash<std::tuple<int, int>>{}(std::make_tuple(2, 1)));
+		CHECK(std::hash<std::tuple<int, int>>{}(std::make_tuple(0, 0)) != std::hash<std::tuple<int, int, int>>{}(std::make_tuple(0, 0, 0)));
+	}
+
+	SECTION("Elements are not copied")
+	{
+		const auto tuple = std::make_tuple(copy_counter(), std::string(1000, 'a'));
+		copy_counter::copies = 0;
+
+		std::hash<std::tuple<copy_counter, std::string>>{}(tuple);
+		CHECK(copy_counter::copies == 0);
+	}
+
+	SECTION("Tuples of integers can be hashed at compile time")
+	{
+		constexpr size_t hash = std::hash<std::tuple<int, long, char>>{}(std::make_tuple(1, 2L, 'c'));
+		CHECK(hash == std::hash<std::tuple<int, long, char>>{}(std::make_tuple(1, 2L, 'c')));
+	}
+
+	SECTION("Grids of small integers are spread over all buckets")
+	{
+		// 2^16 keys into 2^16 buckets: with a random hash, about 1/e of the
+		// buckets are empty and the fullest one has less than 10 keys
+		constexpr unsigned BITS = 16;
+		std::vector<std::tuple<int, int>> keys;
+
+		for(int i = 0; i < 256; i++)
+			for(int j = 0; j < 256; j++)
+				keys.emplace_back(i, j);
+
+		for(bool high_bits : { false, true })
+		{
+			const auto load = bucket_load(keys, BITS, high_bits);
+			const double empty = static_cast<double>(load.first) / static_cast<double>(size_t{1} << BITS);
+
+			CHECK(empty > 0.35);
+			CHECK(empty < 0.39);
+			CHECK(load.second < 10);
+		}
+	}
+}
@@ -0,0 +1,310 @@
+#include <algorithm> // std::find, std::none_of, std::transform
+#include <cctype>    // std::tolower
+#include <chrono>    // std::chrono
+#include <cstdint>   // std::uint64_t
+#include <cstdlib>   // std::strtoull
+#include <exception> // std::exception
+#include <iomanip>   // std::setw
+#include <iostream>  // std::cout
+#include <stdexcept> // std::invalid_argument
+#include <string>    // std::string
+#include <vector>    // std::vector
+
+#include "Cache/Cache.h"
+#include "Cache/Policy/ARC.h"
+#include "Cache/Policy/FIFO.h"
+#include "Cache/Policy/GDSF.h"
+#include "Cache/Policy/LFU.h"
+#include "Cache/Policy/LIFO.h"
+#include "Cache/Policy/LRU.h"
+#include "Cache/Policy/MRU.h"
+#include "Cache/Policy/Random.h"
+#include "Cache/Policy/WTinyLFU.h"
+#include "Cache/detail/hash.h"
+#include "Cache/detail/mapped_file.h"
+
+// Replays a key trace through a cache of every requested policy and capacity,
+// and reports the hit ratio, number of evictions and throughput of each one.
+// Every request is a lookup, and every miss inserts the key into the cache.
+//
+// The trace is memory-mapped and streamed once per run, so traces much bigger
+// than the available memory can be replayed. Supported formats:
+//
+//  - text:   one key per line. With --field, only the given field of every
+//            line (split on --separator) is used as the key. Keys are hashed
+//            to 64 bits, which makes collisions negligible for any real trace.
+//  - binary: fixed-width records of --record-size bytes, with the key stored
+//            as a little-endian integer of --key-size bytes at --key-offset.
+//  - oracle: libCacheSim's oracleGeneral format, which is the binary format
+//            with 24-byte records and a 64-bit key at offset 4.
+
+namespace
+{
+	const char* const USAGE =
+		"Usage: trace_replay [options] <trace>\n"
+		"\n"
+		"Options:\n"
+		"  --format text|binary|oracle  Trace format (default: text)\n"
+		"  --capacities N,N,...         Cache capacities, in entries (default: 1000,10000,100000)\n"
+		"  --policies P,P,...           Policies to replay (default: all of them)\n"
+		"  --field N                    Text: zero-based field used as the key (default: whole line)\n"
+		"  --separator C                Text: field separator (default: ',')\n"
+		"  --record-size N              Binary: size of every record, in bytes (default: 8)\n"
+		"  --key-offset N               Binary: offset of the key within a record (default: 0)\n"
+		"  --key-size N                 Binary: size of the key, from 1 to 8 bytes (default: 8)\n"
+		"\n"
+		"Policies: ARC, FIFO, GDSF, LFU, LIFO, LRU, MRU, Random, WTinyLFU\n";
+
+	const std::vector<std::string> POLICIES = { "ARC", "FIFO", "GDSF", "LFU", "LIFO", "LRU", "MRU", "Random", "WTinyLFU" };
+
+	enum class format { text, binary };
+
+	struct options
+	{
+		format trace_format = format::text;
+		std::vector<std::size_t> capacities = { 1000, 10000, 100000 };
+		std::vector<std::string> policies = POLICIES;
+		long field = -1;
+		char separator = ',';
+		std::size_t record_size = 8;
+		std::size_t key_offset = 0;
+		std::size_t key_size = 8;
+		std::string path;
+	};
+
+	std::vector<std::string> split(const std::string& str, char separator)
+	{
+		std::vector<std::string> parts;
+		std::size_t start = 0;
+
+		for(std::size_t end; (end = str.find(separator, start)) != std::string::npos; start = end + 1)
+			parts.push_back(str.substr(start, end - start));
+
+		parts.push_back(str.substr(start));
+		return parts;
+	}
+
+	std::size_t to_size(const std::string& str)
+	{
+		char* end = nullptr;
+		const unsigned long long value = std::strtoull(str.c_str(), &end, 10);
+
+		if(str.empty() || *end != '\0')
+			throw std::invalid_argument("Invalid number: '" + str + "'");
+
+		return static_cast<std::size_t>(value);
+	}
+
+	std::string to_lower(std::string str)
+	{
+		std::transform(str.begin(), str.end(), str.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		return str;
+	}
+
+	options parse_options(int argc, char** argv)
+	{
+		options opts;
+
+		for(int i = 1; i < argc; i++)
+		{
+			const std::string arg = argv[i];
+
+			if(arg.compare(0, 2, "--") != 0)
+			{
+				if(!opts.path.empty()) throw std::invalid_argument("More than one trace given");
+				opts.path = arg;
+				continue;
+			}
+
+			if(i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+			const std::string value = argv[++i];
+
+			if(arg == "--format")
+			{
+				const std::string fmt = to_lower(value);
+
+				if(fmt == "text")
+					opts.trace_format = format::text;
+				else if(fmt == "binary")
+					opts.trace_format = format::binary;
+				else if(fmt == "oracle")
+				{
+					opts.trace_format = format::binary;
+					opts.record_size = 24;
+					opts.key_offset = 4;
+					opts.key_size = 8;
+				}
+				else
+					throw std::invalid_argument("Unknown format: '" + value + "'");
+			}
+			else if(arg == "--capacities")
+			{
+				opts.capacities.clear();
+				for(const auto& capacity : split(value, ','))
+					opts.capacities.push_back(to_size(capacity));
+			}
+			else if(arg == "--policies")     opts.policies = split(value, ',');
+			else if(arg == "--field")        opts.field = static_cast<long>(to_size(value));
+			else if(arg == "--separator")    opts.separator = value.empty() ? ',' : value[0];
+			else if(arg == "--record-size")  opts.record_size = to_size(value);
+			else if(arg == "--key-offset")   opts.key_offset = to_size(value);
+			else if(arg == "--key-size")     opts.key_size = to_size(value);
+			else throw std::invalid_argument("Unknown option: " + arg);
+		}
+
+		if(opts.path.empty())
+			throw std::invalid_argument("No trace given");
+
+		for(const auto& policy : opts.policies)
+		{
+			if(std::none_of(POLICIES.begin(), POLICIES.end(), [&](const std::string& p) { return to_lower(p) == to_lower(policy); }))
+				throw std::invalid_argument("Unknown policy: '" + policy + "'");
+		}
+
+		if(opts.key_size == 0 || opts.key_size > 8 || opts.key_offset + opts.key_size > opts.record_size)
+			throw std::invalid_argument("The key must be between 1 and 8 bytes long and fit in a record");
+
+		return opts;
+	}
+
+	// FNV-1a, followed by a final mix so that short keys differing in their
+	// last character do not end up with similar hashes
+	std::uint64_t hash_key(const char* first, const char* last) noexcept
+	{
+		std::uint64_t hash = 0xCBF29CE484222325ULL;
+
+		for(; first != last; ++first)
+			hash = (hash ^ static_cast<unsigned char>(*first)) * 0x100000001B3ULL;
+
+		return detail::mix(hash);
+	}
+
+	// Calls fn(key) for every request in the trace
+	template<typename Fn>
+	void for_each_key(const detail::mapped_file& trace, const options& opts, Fn&& fn)
+	{
+		const char* it = trace.begin();
+		const char* const end = trace.end();
+
+		if(opts.trace_format == format::binary)
+		{
+			for(; static_cast<std::size_t>(end - it) >= opts.record_size; it += opts.record_size)
+			{
+				std::uint64_t key = 0;
+				for(std::size_t i = opts.key_size; i-- > 0;)
+					key = (key << 8) | static_cast<unsigned char>(it[opts.key_offset + i]);
+
+				fn(key);
+			}
+
+			return;
+		}
+
+		while(it != end)
+		{
+			const char* eol = std::find(it, end, '\n');
+			const char* first = it;
+			const char* last = (eol != it && eol[-1] == '\r') ? eol - 1 : eol;
+
+			for(long field = 0; field < opts.field && first != last; field++)
+			{
+				first = std::find(first, last, opts.separator);
+				if(first != last) ++first;
+			}
+
+			if(opts.field >= 0)
+				last = std::find(first, last, opts.separator);
+
+			if(first != last)
+				fn(hash_key(first, last));
+
+			it = (eol == end) ? end : eol + 1;
+		}
+	}
+
+	struct result
+	{
+		std::uint64_t requests;
+		std::uint64_t hits;
+		std::uint64_t evictions;
+		double seconds;
+	};
+
+	template<template<typename> class CachePolicy>
+	result replay(const detail::mapped_file& trace, const options& opts, std::size_t capacity)
+	{
+		Cache<std::uint64_t, bool, CachePolicy> cache(capacity);
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for_each_key(trace, opts, [&cache](std::uint64_t key)
+		{
+			if(!cache.contains(key))
+				cache.insert(key, true);
+		});
+
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		return { cache.hit_count() + cache.miss_count(), cache.hit_count(), cache.evicted_count(), elapsed.count() };
+	}
+
+	result replay(const std::string& policy, const detail::mapped_file& trace, const options& opts, std::size_t capacity)
+	{
+		const std::string name = to_lower(policy);
+
+		if(name == "arc")      return replay<Policy::ARC>     (trace, opts, capacity);
+		if(name == "fifo")     return replay<Policy::FIFO>    (trace, opts, capacity);
+		if(name == "gdsf")     return replay<Policy::GDSF>    (trace, opts, capacity);
+		if(name == "lfu")      return replay<Policy::LFU>     (trace, opts, capacity);
+		if(name == "lifo")     return replay<Policy::LIFO>    (trace, opts, capacity);
+		if(name == "lru")      return replay<Policy::LRU>     (trace, opts, capacity);
+		if(name == "mru")      return replay<Policy::MRU>     (trace, opts, capacity);
+		if(name == "random")   return replay<Policy::Random>  (trace, opts, capacity);
+		if(name == "wtinylfu") return replay<Policy::WTinyLFU>(trace, opts, capacity);
+
+		throw std::invalid_argument("Unknown policy: '" + policy + "'");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		const options opts = parse_options(argc, argv);
+		const detail::mapped_file trace(opts.path);
+
+		std::cout << std::setw(10) << "policy"
+			<< std::setw(12) << "capacity"
+			<< std::setw(14) << "requests"
+			<< std::setw(12) << "hit ratio"
+			<< std::setw(14) << "evictions"
+			<< std::setw(14) << "ops/s" << std::endl;
+
+		for(std::size_t capacity : opts.capacities)
+		{
+			for(const auto& policy : opts.policies)
+			{
+				const result res = replay(policy, trace, opts, capacity);
+				const double hit_ratio = res.requests == 0 ? 0.0 : static_cast<double>(res.hits) / static_cast<double>(res.requests);
+				const double ops = res.seconds > 0.0 ? static_cast<double>(res.requests) / res.seconds : 0.0;
+
+				std::cout << std::setw(10) << policy
+					<< std::setw(12) << capacity
+					<< std::setw(14) << res.requests
+					<< std::setw(12) << std::fixed << std::setprecision(4) << hit_ratio
+					<< std::setw(14) << res.evictions
+					<< std::setw(14) << static_cast<std::uint64_t>(ops) << std::endl;
+			}
+		}
+	}
+	catch(const std::invalid_argument& e)
+	{
+		std::cerr << "Error: " << e.what() << "\n\n" << USAGE;
+		return 1;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+}